@@ -0,0 +1,200 @@
+#include "adjoint.h"
+#include "particle.h"
+
+AdjointSolver::AdjointSolver(Manifold* _m, Integrator* _integrator, int _interval)
+	: jacobian(_m)
+{
+	m = _m;
+	integrator = _integrator;
+	interval = (_interval > 0) ? _interval : 1;
+	nParams = jacobian.getNParameters();
+	paramGradient.assign(nParams, 0.0);
+	recomputed = 0;
+	int i;
+	for(i = 0; i < 8; i++)
+		gradient[i] = 0.0;
+}
+
+AdjointSolver::~AdjointSolver()
+{
+}
+
+void AdjointSolver::forward(Point p, vector4 u, double T)
+{
+	steps.clear();
+	checkpointPos.clear();
+	checkpointVel.clear();
+
+	Particle particle(m, p, u);
+	particle.setIntegrator(integrator);
+	checkpointPos.push_back(p);
+	checkpointVel.push_back(u);
+	while(particle.getProperTime() < T)
+	{
+		if(particle.getProperTime() + integrator->getStepSize() > T) particle.propagate(T - particle.getProperTime());
+		else particle.propagate();
+		steps.push_back(integrator->getLastStep());
+		if(steps.size() % interval == 0)
+		{
+			checkpointPos.push_back(particle.getPos());
+			checkpointVel.push_back(particle.getVel());
+		}
+	}
+	finalPos = particle.getPos();
+	finalVel = particle.getVel();
+}
+
+Point AdjointSolver::getFinalPos()
+{
+	return finalPos;
+}
+
+vector4 AdjointSolver::getFinalVel()
+{
+	return finalVel;
+}
+
+int AdjointSolver::getNSteps()
+{
+	return steps.size();
+}
+
+int AdjointSolver::getNCheckpoints()
+{
+	return checkpointPos.size();
+}
+
+void AdjointSolver::adjointDerivative(const double* z, double* dz)
+{
+	//lambda_x' = d_k Gamma(u,u) . lambda_u, lambda_u' = -lambda_x + 2 Gamma(., u) . lambda_u, mu' = d_p Gamma(u,u) . lambda_u
+	int i, k;
+	for(k = 0; k < 4; k++)
+	{
+		dz[k] = 0.0;
+		dz[k + 4] = -z[k];
+		for(i = 0; i < 4; i++)
+		{
+			dz[k] += z[i + 4]*jacobian.dGamma[k][i];
+			dz[k + 4] += 2*z[i + 4]*jacobian.gammaU[i][k];
+		}
+	}
+	for(k = 0; k < nParams; k++)
+	{
+		dz[k + 8] = 0.0;
+		for(i = 0; i < 4; i++)
+			dz[k + 8] += z[i + 4]*jacobian.dGammaParam[4*k + i];
+	}
+}
+
+void AdjointSolver::backwardStep(Point p0, vector4 u0, Point p1, vector4 u1, double h, double* z)
+{
+	int n = 8 + nParams;
+	int i;
+	std::vector<double> k1(n), k2(n), k3(n), k4(n), w(n);
+
+	//the state in the middle of the step
+	Particle mid(m, p0, u0);
+	mid.setIntegrator(integrator);
+	mid.propagate(h/2);
+	Point pm = mid.getPos();
+	vector4 um = mid.getVel();
+	if(pm.getCoordSystem() != p0.getCoordSystem())
+	{
+		um = m->convertVectorTo(um, pm, p0.getCoordSystem());
+		pm = m->convertPointTo(pm, p0.getCoordSystem());
+	}
+
+	jacobian.compute(m, p1, u1);
+	adjointDerivative(z, &k1[0]);
+	jacobian.compute(m, pm, um);
+	for(i = 0; i < n; i++)
+		w[i] = z[i] - h/2*k1[i];
+	adjointDerivative(&w[0], &k2[0]);
+	for(i = 0; i < n; i++)
+		w[i] = z[i] - h/2*k2[i];
+	adjointDerivative(&w[0], &k3[0]);
+	jacobian.compute(m, p0, u0);
+	for(i = 0; i < n; i++)
+		w[i] = z[i] - h*k3[i];
+	adjointDerivative(&w[0], &k4[0]);
+	for(i = 0; i < n; i++)
+		z[i] -= h/6*(k1[i] + 2*k2[i] + 2*k3[i] + k4[i]);
+}
+
+void AdjointSolver::backward(const double* dLoss)
+{
+	int n = 8 + nParams;
+	int nSteps = steps.size();
+	int i, j, k;
+	std::vector<double> z(n, 0.0);
+	for(i = 0; i < 8; i++)
+		z[i] = dLoss[i];
+	recomputed = 0;
+
+	int segment;
+	for(segment = (nSteps - 1)/interval; segment >= 0 && nSteps > 0; segment--)
+	{
+		//the states of the segment are recomputed from its checkpoint with the same steps
+		int first = segment*interval;
+		int last = (first + interval < nSteps) ? first + interval : nSteps;
+		std::vector<Point> pos;
+		std::vector<vector4> vel;
+		Particle particle(m, checkpointPos[segment], checkpointVel[segment]);
+		particle.setIntegrator(integrator);
+		pos.push_back(particle.getPos());
+		vel.push_back(particle.getVel());
+		for(i = first; i < last; i++)
+		{
+			particle.propagate(steps[i]);
+			pos.push_back(particle.getPos());
+			vel.push_back(particle.getVel());
+			recomputed++;
+		}
+
+		for(i = last - 1; i >= first; i--)
+		{
+			Point p0 = pos[i - first], p1 = pos[i - first + 1];
+			vector4 u0 = vel[i - first], u1 = vel[i - first + 1];
+			int chart = p0.getCoordSystem();
+			if(p1.getCoordSystem() != chart)
+			{
+				//the particle changed the coordinate system after the step - lambda transformed with the transposed Jacobian
+				u1 = m->convertVectorTo(u1, p1, chart);
+				p1 = m->convertPointTo(p1, chart);
+				double J[8][8], lambda[8];
+				stateConversionJacobian(m, p1, u1, pos[i - first + 1].getCoordSystem(), J);
+				for(j = 0; j < 8; j++)
+				{
+					lambda[j] = 0.0;
+					for(k = 0; k < 8; k++)
+						lambda[j] += J[k][j]*z[k];
+				}
+				for(j = 0; j < 8; j++)
+					z[j] = lambda[j];
+			}
+			backwardStep(p0, u0, p1, u1, steps[i], &z[0]);
+		}
+	}
+
+	for(i = 0; i < 8; i++)
+		gradient[i] = z[i];
+	for(i = 0; i < nParams; i++)
+		paramGradient[i] = z[8 + i];
+}
+
+double AdjointSolver::getGradient(int i)
+{
+	if(i < 0 || i >= 8) throw "AdjointSolver: Index out of bounds.";
+	return gradient[i];
+}
+
+double AdjointSolver::getParameterGradient(int k)
+{
+	if(k < 0 || k >= nParams) throw "AdjointSolver: Index out of bounds.";
+	return paramGradient[k];
+}
+
+int AdjointSolver::getRecomputedSteps()
+{
+	return recomputed;
+}
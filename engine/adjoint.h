@@ -0,0 +1,102 @@
+#ifndef __ADJOINT_H__
+#define __ADJOINT_H__
+
+/*! \file adjoint.h
+ * \brief Gradients of functions of the final state of a geodesic by the adjoint method
+ */
+
+#include "variational.h"
+#include <vector>
+
+/*! \class AdjointSolver
+ * \brief Computes the gradient of a loss depending on the final state of a geodesic with respect to the initial state and the
+ *        parameters of the manifold
+ *
+ * The geodesic is integrated forward by a Particle with the given integrator, keeping the step sizes and a checkpoint of the
+ * state every few steps. The adjoint state (lambda - the gradient of the loss with respect to the current state, mu - with
+ * respect to the parameters) is then integrated backward, from the gradient with respect to the final state, with the
+ * Runge-Kutta 4 method on the steps of the forward run:
+ *
+ * lambda' = -A^T lambda, mu' = -B^T lambda
+ *
+ * where A and B are the derivatives of the geodesic equation with respect to the state and to the parameters
+ * (GeodesicLinearization). The states between the checkpoints are recomputed one segment at a time, so the memory is
+ * proportional to the number of the checkpoints plus the interval between them. Unlike the forward sensitivities
+ * (VariationalParticle), which carry a column for every initial component and parameter, the adjoint carries a single row,
+ * so its cost does not grow with the number of the initial components whose gradient is needed. The cost does grow with the
+ * number of the parameters of the manifold: the metrics have no automatic differentiation, so B is taken by central
+ * differences - 2 evaluations of the Christoffel symbols per parameter at every stage, as in VariationalParticle.
+ *
+ * The states are indexed with the coordinates first: 0-3 - x^i, 4-7 - u^(i-4).
+ */
+class AdjointSolver
+{
+	Manifold* m;
+	Integrator* integrator;
+	GeodesicLinearization jacobian;
+	int nParams;
+	int interval;
+
+	std::vector<double> steps;				///< Step sizes of the forward run
+	std::vector<Point> checkpointPos;		///< Positions at the checkpoints
+	std::vector<vector4> checkpointVel;	///< 4-velocities at the checkpoints
+	Point finalPos;
+	vector4 finalVel;
+
+	double gradient[8];
+	std::vector<double> paramGradient;
+	int recomputed;
+
+	AdjointSolver(const AdjointSolver&);
+	AdjointSolver& operator=(const AdjointSolver&);
+
+	//! Derivative of the adjoint state (8 + nParams components) with the Jacobian computed at a state
+	void adjointDerivative(const double* z, double* dz);
+	//! A step of the adjoint state backward from the end of a forward step to its beginning
+	/*! \param p0 The position at the beginning (in the coordinate system of the step)
+	 *  \param u0 The 4-velocity at the beginning
+	 *  \param p1 The position at the end (converted to the coordinate system of the step)
+	 *  \param u1 The 4-velocity at the end
+	 *  \param h The step size
+	 *  \param z The adjoint state at the end, replaced with the one at the beginning
+	 */
+	void backwardStep(Point p0, vector4 u0, Point p1, vector4 u1, double h, double* z);
+public:
+	//! Constructor
+	/*! \param _m The manifold - it must support clone() if it has parameters
+	 *  \param _integrator The integrator of the forward run (it is used for the recomputation too)
+	 *  \param _interval Number of the steps between the checkpoints
+	 */
+	AdjointSolver(Manifold* _m, Integrator* _integrator, int _interval = 32);
+	//! Destructor
+	~AdjointSolver();
+
+	//! Integrates the geodesic forward, keeping the checkpoints
+	/*! \param p The initial position
+	 *  \param u The initial 4-velocity
+	 *  \param T The proper time of the integration (the last step is shortened to end exactly at it)
+	 */
+	void forward(Point p, vector4 u, double T);
+	//! Returns the final position of the forward run
+	Point getFinalPos();
+	//! Returns the final 4-velocity of the forward run
+	vector4 getFinalVel();
+	//! Returns the number of the steps of the forward run
+	int getNSteps();
+	//! Returns the number of the kept checkpoints
+	int getNCheckpoints();
+
+	//! Integrates the adjoint state backward
+	/*! \param dLoss The gradient of the loss with respect to the final state (coordinates first, in the coordinate system of
+	 *         getFinalPos())
+	 */
+	void backward(const double* dLoss);
+	//! Returns the gradient of the loss with respect to a component of the initial state (in its coordinate system)
+	double getGradient(int i);
+	//! Returns the gradient of the loss with respect to a parameter of the manifold
+	double getParameterGradient(int k);
+	//! Returns the number of the steps recomputed in the last backward run
+	int getRecomputedSteps();
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "autointegrator.h"
+
+/*******************************************************************************
+ *
+ *  AutoIntegrator class implementation
+ *
+ *******************************************************************************/
+
+const double AutoIntegrator::stabilityBorder = 3.25;
+const int AutoIntegrator::switchSteps = 15;
+
+AutoIntegrator::AutoIntegrator(double maxErr, double stepSize, double minStep, double maxStep)
+	: Integrator(stepSize), dp(maxErr, stepSize, minStep, maxStep), rosenbrock(maxErr, stepSize, minStep, maxStep)
+{
+	stiff = false;
+	stiffSteps = quietSteps = switches = 0;
+	lastEq = NULL;
+}
+
+AutoIntegrator::~AutoIntegrator()
+{
+}
+
+void AutoIntegrator::toggle()
+{
+	stiff = !stiff;
+	stiffSteps = quietSteps = 0;
+	switches++;
+}
+
+StateVector AutoIntegrator::next(StateVector state, DiffEq* equation, double step)
+{
+	//a new trajectory
+	if(lastEq != equation || lastState != state)
+	{
+		stiff = false;
+		stiffSteps = quietSteps = switches = 0;
+	}
+	
+	Integrator* active;
+	if(stiff)
+		active = &rosenbrock;
+	else
+		active = &dp;
+	active -> setStepSize(stepSize);
+	StateVector result = active -> next(state, equation, step);
+	stepSize = active -> getStepSize();
+	lastStep = active -> getLastStep();
+	lastError = active -> getLastError();
+	lastRejections = active -> getLastRejections();
+	
+	//the test of Hairer and Wanner (DOPRI5) - the switch needs many stiff steps, with few interruptions
+	if(!stiff)
+	{
+		if(dp.getStiffness() > stabilityBorder)
+		{
+			quietSteps = 0;
+			if(++stiffSteps >= switchSteps) toggle();
+		}
+		else if(++quietSteps >= 6)
+			stiffSteps = 0;
+	}
+	else
+	{
+		if(rosenbrock.getStiffness() < stabilityBorder)
+		{
+			if(++stiffSteps >= switchSteps) toggle();
+		}
+		else
+			stiffSteps = 0;
+	}
+	
+	lastState = result;
+	lastEq = equation;
+	return result;
+}
+
+bool AutoIntegrator::isStiff()
+{
+	return stiff;
+}
+
+int AutoIntegrator::getSwitches()
+{
+	return switches;
+}
+
+DiffEq* AutoIntegrator::getLastEquation()
+{
+	return lastState.size() ? lastEq : NULL;
+}
+
+void AutoIntegrator::setLastEquation(DiffEq* eq)
+{
+	lastEq = eq;
+	dp.setLastEquation(eq);
+	rosenbrock.setLastEquation(eq);
+}
+
+void AutoIntegrator::saveState(StateWriter& w)
+{
+	Integrator::saveState(w);
+	w.putInt(stiff ? 1 : 0);
+	w.putInt(stiffSteps);
+	w.putInt(quietSteps);
+	w.putInt(switches);
+	w.putInt(lastState.size());
+	if(lastState.size()) w.putDoubles(&lastState[0], lastState.size());
+	dp.saveState(w);
+	rosenbrock.saveState(w);
+}
+
+void AutoIntegrator::loadState(StateReader& r)
+{
+	Integrator::loadState(r);
+	stiff = (r.getInt() != 0);
+	stiffSteps = r.getInt();
+	quietSteps = r.getInt();
+	switches = r.getInt();
+	int n = r.getInt();
+	if(n < 0 || (uint64_t)n*sizeof(double) > r.remaining()) throw "AutoIntegrator: Invalid state.";
+	lastState.resize(n);
+	if(n) r.getDoubles(&lastState[0], n);
+	dp.loadState(r);
+	rosenbrock.loadState(r);
+	lastEq = NULL;
+}
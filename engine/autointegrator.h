@@ -0,0 +1,67 @@
+#ifndef __AUTOINTEGRATOR__
+#define __AUTOINTEGRATOR__
+
+/*! \file autointegrator.h
+ * \brief Integrator switching between an explicit and an implicit method
+ */
+ 
+#include "dpintegrator.h"
+#include "rosenbrockintegrator.h"
+
+/*! \class AutoIntegrator
+ * \brief Class switching between the Dormand-Prince and the Rosenbrock integrator depending on the stiffness of the equation.
+ *
+ * The steps are made by DPIntegrator until its stiffness estimate (DPIntegrator::getStiffness) stays near the border of
+ * its stability region for \a switchSteps accepted steps, then by RosenbrockIntegrator until the step times the spectral
+ * radius of the Jacobian stays inside the stability region of the explicit method for as many steps. A new trajectory -
+ * a state which is not the result of the last step, or another equation - starts with the explicit method again, so one
+ * integrator can be shared by the particles traced in turn (like in Renderer).
+ */
+class AutoIntegrator : public Integrator
+{
+	DPIntegrator dp;
+	RosenbrockIntegrator rosenbrock;
+	bool stiff;			///< The implicit method is in use
+	int stiffSteps;		///< Steps in a row indicating stiffness (in the explicit mode) or its end (in the implicit one)
+	int quietSteps;		///< Steps in a row not indicating it since the last indicating one (explicit mode)
+	int switches;		///< Switches of the method in the current trajectory
+	
+	StateVector lastState;
+	DiffEq* lastEq;
+	
+	//! Switches to the other method, passing on the step size
+	void toggle();
+public:
+	static const double stabilityBorder;	///< h |lambda| at the border of the stability region of the explicit method
+	static const int switchSteps;			///< Steps needed to switch the method
+	
+	//! Constructor
+	/*! The parameters are passed to both integrators.
+	 *  \param maxErr The error margin - if the error is larger than this margin, the step size is decreased.
+	 *  \param stepSize Default step size
+	 *  \param minStep Minimal step size
+	 *  \param maxStep Maximal step size
+	 */
+	AutoIntegrator(double maxErr = 0.000001, double stepSize = 0.01, double minStep = 0.0001, double maxStep = 0.1);
+	//! Destructor
+	~AutoIntegrator();
+	//! Function calculating the next state
+	/*! \param state Current state
+	 *  \param equation The differential equation to be used
+	 *  \param step Step size. If 0 (default), the default step size is used.
+	 */
+	StateVector next(StateVector state, DiffEq* equation, double step = 0.0);
+	
+	//! Returns true if the implicit method is in use
+	bool isStiff();
+	//! Returns the number of switches of the method in the current trajectory
+	int getSwitches();
+	
+	DiffEq* getLastEquation();
+	void setLastEquation(DiffEq*);
+	//! Serializes the internal state, including the states of both integrators
+	void saveState(StateWriter&);
+	void loadState(StateReader&);
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef __BOUNDEDQUEUE_H__
+#define __BOUNDEDQUEUE_H__
+
+/*! \file boundedqueue.h
+ * \brief Bounded lock-free multi-producer multi-consumer queue
+ */
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*! \class BoundedQueue
+ * \brief Fixed-size lock-free queue for many producers and consumers
+ *
+ * The algorithm of D. Vyukov: every cell carries a sequence number, which tells whether it is free for the producer or full for
+ * the consumer at the current position. Producers and consumers claim positions with a compare-and-swap of their own counter,
+ * so they never touch the same cache line unless the queue is almost empty or full. \a push and \a pop never block - they fail
+ * if the queue is full or empty, and the caller decides whether to wait.
+ * The elements of one producer are popped in the order in which they were pushed.
+ */
+template<class T> class BoundedQueue
+{
+	struct Cell
+	{
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	//the counters are kept on separate cache lines, so that the producers and the consumers don't slow each other down
+	Cell* buffer;
+	size_t mask;
+	char pad1[64];
+	std::atomic<size_t> enqueuePos;
+	char pad2[64];
+	std::atomic<size_t> dequeuePos;
+	char pad3[64];
+
+	BoundedQueue(const BoundedQueue&);
+	BoundedQueue& operator=(const BoundedQueue&);
+public:
+	//! Constructor
+	/*! \param capacity The number of elements (rounded up to a power of 2)
+	 */
+	BoundedQueue(size_t capacity)
+	{
+		if(capacity < 2) capacity = 2;
+		size_t n = 1;
+		while(n < capacity) n <<= 1;
+		buffer = new Cell[n];
+		mask = n - 1;
+		size_t i;
+		for(i = 0; i < n; i++)
+			buffer[i].seq.store(i, std::memory_order_relaxed);
+		enqueuePos.store(0, std::memory_order_relaxed);
+		dequeuePos.store(0, std::memory_order_relaxed);
+	}
+	//! Destructor
+	~BoundedQueue()
+	{
+		delete[] buffer;
+	}
+
+	//! Adds an element
+	/*! \return false if the queue is full
+	 */
+	bool push(const T& value)
+	{
+		Cell* cell;
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			cell = &buffer[pos & mask];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if(diff == 0)
+			{
+				if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			else if(diff < 0) return false;
+			else pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+		cell->data = value;
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	//! Removes the oldest element
+	/*! \return false if the queue is empty
+	 */
+	bool pop(T& value)
+	{
+		Cell* cell;
+		size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			cell = &buffer[pos & mask];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+			if(diff == 0)
+			{
+				if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			else if(diff < 0) return false;
+			else pos = dequeuePos.load(std::memory_order_relaxed);
+		}
+		value = cell->data;
+		cell->seq.store(pos + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	//! Returns the approximate number of the elements (exact only if no thread is pushing or popping)
+	size_t size()
+	{
+		size_t in = enqueuePos.load(std::memory_order_relaxed);
+		size_t out = dequeuePos.load(std::memory_order_relaxed);
+		return (in > out) ? in - out : 0;
+	}
+	//! Returns the capacity
+	size_t capacity()
+	{
+		return mask + 1;
+	}
+};
+
+#endif
@@ -0,0 +1,289 @@
+#include "classifier.h"
+#include "particle.h"
+#include <math.h>
+
+/*
+ * Helper functions
+ */
+
+static double evalPoly(double c[5], double r)
+{
+	return (((c[4]*r + c[3])*r + c[2])*r + c[1])*r + c[0];
+}
+
+//magnitude of the terms of the polynomial - the scale for deciding whether a value is zero
+static double polyScale(double c[5], double r)
+{
+	return (((fabs(c[4])*r + fabs(c[3]))*r + fabs(c[2]))*r + fabs(c[1]))*r + fabs(c[0]);
+}
+
+//real roots of A x^3 + B x^2 + C x + D = 0, returns the number of roots
+static int solveCubic(double A, double B, double C, double D, double x[3])
+{
+	int n, i, k;
+
+	if(A == 0.0)
+	{
+		if(B == 0.0)
+		{
+			if(C == 0.0) return 0;
+			x[0] = -D/C;
+			return 1;
+		}
+		double disc = C*C - 4*B*D;
+		if(disc < 0.0) return 0;
+		x[0] = (-C - sqrt(disc))/(2*B);
+		x[1] = (-C + sqrt(disc))/(2*B);
+		return 2;
+	}
+
+	double b = B/A, c = C/A, d = D/A;
+	double q = (3*c - b*b)/9;
+	double r = (9*b*c - 27*d - 2*b*b*b)/54;
+	double disc = q*q*q + r*r;
+
+	if(disc > 0.0)
+	{
+		double s = cbrt(r + sqrt(disc));
+		double t = cbrt(r - sqrt(disc));
+		x[0] = s + t - b/3;
+		n = 1;
+	}
+	else
+	{
+		double theta = (q == 0.0) ? 0.0 : acos(r/sqrt(-q*q*q));
+		for(i=0; i<3; i++)
+			x[i] = 2*sqrt(-q)*cos((theta + 2*M_PI*i)/3) - b/3;
+		n = 3;
+	}
+
+	//polish the roots with Newton's method
+	for(i=0; i<n; i++)
+		for(k=0; k<3; k++)
+		{
+			double f = ((A*x[i] + B)*x[i] + C)*x[i] + D;
+			double df = (3*A*x[i] + 2*B)*x[i] + C;
+			if(df == 0.0) break;
+			x[i] -= f/df;
+		}
+
+	return n;
+}
+
+/*
+ * GeodesicClassifier
+ */
+
+GeodesicClassifier::GeodesicClassifier(SchwManifold* _m)
+{
+	m = _m;
+	schw = _m;
+	kerr = NULL;
+	tolerance = 1e-9;
+}
+
+GeodesicClassifier::GeodesicClassifier(KerrManifold* _m)
+{
+	m = _m;
+	schw = NULL;
+	kerr = _m;
+	tolerance = 1e-9;
+}
+
+GeodesicClassifier::~GeodesicClassifier()
+{
+}
+
+void GeodesicClassifier::getParameters(double& M, double& a)
+{
+	if(kerr)
+	{
+		M = kerr->getMass();
+		a = kerr->getAngMomentum();
+	}
+	else
+	{
+		M = schw->getMass();
+		a = 0.0;
+	}
+}
+
+double GeodesicClassifier::getHorizonRadius()
+{
+	if(kerr) return kerr->getHorizonRadius();
+	return schw->getHorizonRadius();
+}
+
+void GeodesicClassifier::setTolerance(double tol)
+{
+	tolerance = tol;
+}
+
+double GeodesicClassifier::getTolerance()
+{
+	return tolerance;
+}
+
+void GeodesicClassifier::constantsOfMotion(Point p, vector4 u, double& E, double& L, double& Q, double& mu2)
+{
+	double M, a;
+	getParameters(M, a);
+
+	//the Schwarzschild metric is the Kerr metric with a = 0, so the Kerr EF expressions cover both
+	vector4 v = m->convertVectorTo(u, p, EF);
+	Point pos = m->convertPointTo(p, EF);
+
+	double r = pos[1];
+	double s2 = sin(pos[2])*sin(pos[2]);
+	double c2 = cos(pos[2])*cos(pos[2]);
+	double rho2 = r*r + a*a*c2;
+
+	double g_uu = 1.0 - 2*M*r/rho2;
+	double g_ur = -1.0;
+	double g_uphi = 2*M*r*a*s2/rho2;
+	double g_rphi = a*s2;
+	double g_tt = -rho2;
+	double g_phiphi = -(r*r + a*a + 2*M*r*a*a*s2/rho2)*s2;
+
+	E = g_uu*v[0] + g_ur*v[1] + g_uphi*v[3];
+	L = -(g_uphi*v[0] + g_rphi*v[1] + g_phiphi*v[3]);
+	double pt = g_tt*v[2];
+	mu2 = g_uu*v[0]*v[0] + 2*g_ur*v[0]*v[1] + 2*g_uphi*v[0]*v[3] + 2*g_rphi*v[1]*v[3] + g_tt*v[2]*v[2] + g_phiphi*v[3]*v[3];
+	Q = pt*pt + c2*(a*a*(mu2 - E*E) + L*L/s2);
+}
+
+void GeodesicClassifier::radialPotential(Point p, vector4 u, double c[5])
+{
+	double M, a;
+	getParameters(M, a);
+
+	double E, L, Q, mu2;
+	constantsOfMotion(p, u, E, L, Q, mu2);
+	double K = (L - a*E)*(L - a*E) + Q;
+
+	c[4] = E*E - mu2;
+	c[3] = 2*M*mu2;
+	c[2] = a*a*(E*E - mu2) - L*L - Q;
+	c[1] = 2*M*K;
+	c[0] = -a*a*Q;
+}
+
+int GeodesicClassifier::regionClear(double c[5], double r1, double r2, bool includeR1)
+{
+	double roots[3];
+	int i, n;
+	int result = 1;
+
+	n = solveCubic(4*c[4], 3*c[3], 2*c[2], c[1], roots);
+	for(i=0; i<=n; i++)
+	{
+		double r;
+		if(i < n)
+		{
+			r = roots[i];
+			if(r <= r1 || r >= r2) continue;
+			//only the minima are interesting
+			if((12*c[4]*r + 6*c[3])*r + 2*c[2] < 0.0) continue;
+		}
+		else
+		{
+			if(!includeR1) continue;
+			r = r1;
+		}
+
+		double R = evalPoly(c, r);
+		double scale = tolerance*polyScale(c, r);
+		if(R < -scale) return 0;
+		if(R <= scale) result = -1;
+	}
+
+	return result;
+}
+
+GeodesicClassifier::Fate GeodesicClassifier::classify(Point p, vector4 u)
+{
+	double M, a;
+	getParameters(M, a);
+
+	double c[5];
+	radialPotential(p, u, c);
+
+	double rH = getHorizonRadius();
+	Point pos = m->convertPointTo(p, EF);
+	double r0 = pos[1];
+
+	if(r0 <= rH) return (rH > 0.0) ? Captured : Undetermined;
+
+	//direction of the radial motion - at a turning point it is given by the slope of R
+	double dir = m->convertVectorTo(u, p, EF)[1];
+	if(dir == 0.0)
+		dir = ((4*c[4]*r0 + 3*c[3])*r0 + 2*c[2])*r0 + c[1];
+	if(dir == 0.0) return Undetermined;
+
+	//inner region - between the horizon and the particle (the value at the horizon counts)
+	int inner = regionClear(c, rH, r0, true);
+	if(rH == 0.0 && inner == 1) inner = -1;	//no horizon - nothing to be captured by
+
+	//outer region - between the particle and infinity, R must grow to infinity
+	int outer;
+	if(c[4] > tolerance*fabs(c[2])/(r0*r0)) outer = regionClear(c, r0, HUGE_VAL, false);
+	else if(c[4] < -tolerance*fabs(c[2])/(r0*r0)) outer = 0;
+	else outer = -1;
+
+	if(dir < 0.0)
+	{
+		if(inner == 1) return Captured;
+		if(inner == -1) return Undetermined;
+		//bounce at the inner turning point
+		if(outer == 1) return Escapes;
+		if(outer == -1) return Undetermined;
+		return Bound;
+	}
+	else
+	{
+		if(outer == 1) return Escapes;
+		if(outer == -1) return Undetermined;
+		//bounce at the outer turning point
+		if(inner == 1) return Captured;
+		if(inner == -1) return Undetermined;
+		return Bound;
+	}
+}
+
+/*
+ * FateCondition
+ */
+
+FateCondition::FateCondition(GeodesicClassifier* c)
+{
+	classifier = c;
+	rIn = rOut = 0.0;
+}
+
+FateCondition::~FateCondition()
+{
+}
+
+void FateCondition::setExcludedShell(double _rIn, double _rOut)
+{
+	rIn = _rIn;
+	rOut = _rOut;
+}
+
+int FateCondition::check(Particle* p)
+{
+	Point pos = p->getPos();
+	
+	//classified geodesics move monotonically in r only if they are not going to bounce
+	switch(classifier->classify(pos, p->getVel()))
+	{
+	case GeodesicClassifier::Captured:
+		if(rOut > rIn && (pos[1] > rIn || p->getVel()[1] > 0.0)) return NotStopped;
+		return Horizon;
+	case GeodesicClassifier::Escapes:
+		if(rOut > rIn && (pos[1] < rOut || p->getVel()[1] < 0.0)) return NotStopped;
+		return Escape;
+	default:
+		return NotStopped;
+	}
+}
@@ -0,0 +1,114 @@
+#ifndef __CLASSIFIER_H__
+#define __CLASSIFIER_H__
+
+/*! \file classifier.h
+ * \brief Analytic capture/escape classification of geodesics in Schwarzschild and Kerr spacetimes
+ */
+
+#include "geometry.h"
+#include "stopcondition.h"
+#include "schw.h"
+#include "kerr.h"
+
+/*! \class GeodesicClassifier
+ * \brief Class deciding the fate of a geodesic from its initial position and 4-velocity
+ *
+ * The classifier calculates the constants of motion (energy E, angular momentum L and Carter constant Q) and examines
+ * the radial potential R(r) = [E(r^2+a^2) - aL]^2 - delta*(mu^2 r^2 + (L-aE)^2 + Q), which is a polynomial of degree 4.
+ * The radial motion is allowed only where R(r) >= 0, so the geodesic is captured if there is no turning point between
+ * its position and the horizon (in the direction of motion, possibly after a bounce), and escapes if there is no turning point
+ * between its position and infinity. The minima of R are found analytically from the roots of R'(r).
+ *
+ * Geodesics too close to a critical one (e.g. photons with the impact parameter near 3*sqrt(3)M in Schwarzschild) are
+ * reported as undetermined and have to be integrated.
+ */
+class GeodesicClassifier
+{
+	Manifold* m;
+	SchwManifold* schw;
+	KerrManifold* kerr;
+	double tolerance;
+
+	//! Reads M and a from the manifold
+	void getParameters(double& M, double& a);
+	//! Checks whether R(r) > 0 in a region
+	/*! Examines the values of R in the local minima inside (r1, r2) and at \a r1 (if \a includeR1 is true).
+	 *  \return 1 if R is positive in the region, 0 if there is a turning point, -1 if this cannot be decided
+	 */
+	int regionClear(double c[5], double r1, double r2, bool includeR1);
+public:
+	//! The possible fates of a geodesic
+	enum Fate { Undetermined = 0, Captured, Escapes, Bound };
+
+	//! Constructor
+	/*! \param _m The Schwarzschild manifold
+	 */
+	GeodesicClassifier(SchwManifold* _m);
+	//! Constructor
+	/*! \param _m The Kerr manifold
+	 */
+	GeodesicClassifier(KerrManifold* _m);
+	//! Destructor
+	~GeodesicClassifier();
+
+	//! Classifies a geodesic
+	/*! Does not modify the state of the classifier, so it can be called from many threads at once.
+	 *  \param p Initial position (in any coordinate system of the manifold)
+	 *  \param u Initial 4-velocity or wave vector
+	 *  \return The fate of the geodesic
+	 */
+	Fate classify(Point p, vector4 u);
+
+	//! Calculates the constants of motion
+	/*! \param p Position
+	 *  \param u 4-velocity or wave vector
+	 *  \param E Receives the energy u_t
+	 *  \param L Receives the angular momentum -u_phi
+	 *  \param Q Receives the Carter constant
+	 *  \param mu2 Receives g(u, u) (1 for massive particles, 0 for photons)
+	 */
+	void constantsOfMotion(Point p, vector4 u, double& E, double& L, double& Q, double& mu2);
+	
+	//! Calculates the coefficients of the radial potential
+	/*! \param p Position
+	 *  \param u 4-velocity or wave vector
+	 *  \param c Array receiving the coefficients, R(r) = c[4] r^4 + c[3] r^3 + c[2] r^2 + c[1] r + c[0]
+	 */
+	void radialPotential(Point p, vector4 u, double c[5]);
+
+	//! Returns the radius of the outer horizon of the manifold
+	double getHorizonRadius();
+
+	//! Sets the relative tolerance below which a value of R is treated as zero (default 1e-9)
+	void setTolerance(double);
+	//! Returns the tolerance
+	double getTolerance();
+};
+
+/*! \class FateCondition
+ * \brief Stops the particle as soon as its fate can be decided by a GeodesicClassifier
+ *
+ * Captured geodesics are stopped with the reason StopCondition::Horizon, escaping ones with StopCondition::Escape.
+ * If something else can still happen to the geodesic on its way (e.g. it could cross a disk), a shell rIn < r < rOut
+ * can be excluded - the geodesic is then only stopped once it moves monotonically away from the shell.
+ */
+class FateCondition : public StopCondition
+{
+	GeodesicClassifier* classifier;
+	double rIn, rOut;
+public:
+	//! Constructor
+	/*! \param c The classifier to be used (not owned by the condition)
+	 */
+	FateCondition(GeodesicClassifier* c);
+	~FateCondition();
+	
+	//! Sets the excluded shell
+	/*! Captured geodesics are only stopped below \a _rIn, escaping ones above \a _rOut.
+	 */
+	void setExcludedShell(double _rIn, double _rOut);
+
+	int check(Particle* p);
+};
+
+#endif
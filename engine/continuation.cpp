@@ -0,0 +1,385 @@
+#include "continuation.h"
+#include <math.h>
+#include <string.h>
+
+//state of a particle in the layout of StateVector (interleaved position and 4-velocity)
+static void packState(Point p, vector4 u, double* x)
+{
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		x[2*i] = p[i];
+		x[2*i + 1] = u[i];
+	}
+}
+
+static void geodesicDerivative(Manifold* m, int chart, const double* x, double* f)
+{
+	Point p(chart, x[0], x[2], x[4], x[6]);
+	vector4 u(x[1], x[3], x[5], x[7]);
+	vector4 du = vector4() - m->getMetric(chart)->christoffel(u, u, p);
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		f[2*i] = u[i];
+		f[2*i + 1] = du[i];
+	}
+}
+
+/*******************************************************************************
+ *
+ *  ReferenceTrajectory class implementation
+ *
+ *******************************************************************************/
+
+ReferenceTrajectory::ReferenceTrajectory()
+{
+	manifold = NULL;
+}
+
+ReferenceTrajectory::~ReferenceTrajectory()
+{
+	clear();
+}
+
+void ReferenceTrajectory::add(Particle* p)
+{
+	ReferenceNode node;
+	Manifold* m = p->getManifold();
+	Point pos = p->getPos();
+	vector4 vel = p->getVel();
+	if(nodes.empty()) manifold = m->clone();
+
+	node.tau = p->getProperTime();
+	node.chart = pos.getCoordSystem();
+	packState(pos, vel, node.x);
+	geodesicDerivative(m, node.chart, node.x, node.f);
+
+	//the particle switches the coordinate system after the step - the end of the step is kept in the old one too
+	node.switched = !nodes.empty() && nodes.back().chart != node.chart;
+	if(node.switched)
+	{
+		int old = nodes.back().chart;
+		packState(m->convertPointTo(pos, old), m->convertVectorTo(vel, pos, old), node.xPrev);
+		geodesicDerivative(m, old, node.xPrev, node.fPrev);
+	}
+	else
+	{
+		memcpy(node.xPrev, node.x, sizeof(node.x));
+		memcpy(node.fPrev, node.f, sizeof(node.f));
+	}
+	nodes.push_back(node);
+}
+
+void ReferenceTrajectory::clear()
+{
+	nodes.clear();
+	delete manifold;
+	manifold = NULL;
+}
+
+int ReferenceTrajectory::getNNodes()
+{
+	return nodes.size();
+}
+
+const ReferenceNode& ReferenceTrajectory::getNode(int i)
+{
+	if(i < 0 || i >= (int)nodes.size()) throw "ReferenceTrajectory: Index out of bounds.";
+	return nodes[i];
+}
+
+Manifold* ReferenceTrajectory::getManifold()
+{
+	return manifold;
+}
+
+/*******************************************************************************
+ *
+ *  ContinuationSolver class implementation
+ *
+ *******************************************************************************/
+
+/*! \class ReplayParticle
+ * \brief Particle counting the evaluations of its equation
+ */
+class ReplayParticle : public Particle
+{
+	long* counter;
+public:
+	ReplayParticle(Manifold* m, Point p, vector4 u, long* _counter) : Particle(m, p, u), counter(_counter) {}
+	StateVector derivative(StateVector v)
+	{
+		(*counter)++;
+		return Particle::derivative(v);
+	}
+};
+
+//weights of the integral over [a, b] of the polynomial interpolating the values at t[0..n-1] (3-point Gauss-Legendre, exact up to degree 5)
+static void integrationWeights(const double* t, int n, double a, double b, double* w)
+{
+	static const double gx[3] = { -0.7745966692414834, 0.0, 0.7745966692414834 };
+	static const double gw[3] = { 5.0/9, 8.0/9, 5.0/9 };
+	int i, k, l;
+	for(k = 0; k < n; k++)
+		w[k] = 0.0;
+	for(i = 0; i < 3; i++)
+	{
+		double s = 0.5*(a + b) + 0.5*(b - a)*gx[i];
+		for(k = 0; k < n; k++)
+		{
+			double L = 1.0;
+			for(l = 0; l < n; l++)
+				if(l != k) L *= (s - t[l])/(t[k] - t[l]);
+			w[k] += 0.5*(b - a)*gw[i]*L;
+		}
+	}
+}
+
+/*! \struct AdamsPoint
+ * \brief A point of the history of the Adams method
+ */
+struct AdamsPoint
+{
+	double tau;
+	double x[8];	///< The reference state
+	double d[8];	///< The difference
+	double g[8];	///< Derivative of the difference
+};
+
+ContinuationSolver::ContinuationSolver(double _maxErr)
+{
+	maxErr = _maxErr;
+	fallbackNode = -1;
+	evaluations = 0;
+	steps = 0;
+}
+
+ContinuationSolver::~ContinuationSolver()
+{
+}
+
+void ContinuationSolver::difference(Manifold* m, int chart, const double* x, const double* fRef, const double* d, double* g)
+{
+	double y[8], f[8];
+	int k;
+	for(k = 0; k < 8; k++)
+		y[k] = x[k] + d[k];
+	evaluations++;
+	geodesicDerivative(m, chart, y, f);
+	for(k = 0; k < 8; k++)
+		g[k] = f[k] - fRef[k];
+}
+
+void ContinuationSolver::solve(ReferenceTrajectory& ref, Manifold* m, Point p, vector4 u)
+{
+	const int order = 4;
+	int n = ref.getNNodes();
+	if(n < 1) throw "ContinuationSolver: Empty reference trajectory.";
+	pos.assign(n, Point());
+	vel.assign(n, vector4());
+	fallbackNode = -1;
+	evaluations = 0;
+	steps = 0;
+
+	int i, j, k;
+	double y[8], dP[8], gP[8], t[order], w[order];
+	std::vector<AdamsPoint> history;
+	AdamsPoint next;
+
+	//the difference at the first node
+	const ReferenceNode& first = ref.getNode(0);
+	if(p.getCoordSystem() != first.chart)
+	{
+		u = m->convertVectorTo(u, p, first.chart);
+		p = m->convertPointTo(p, first.chart);
+	}
+	packState(p, u, y);
+	next.tau = first.tau;
+	for(k = 0; k < 8; k++)
+	{
+		next.x[k] = first.x[k];
+		next.d[k] = y[k] - first.x[k];
+	}
+	difference(m, first.chart, first.x, first.f, next.d, next.g);
+	history.push_back(next);
+	pos[0] = p;
+	vel[0] = u;
+
+	//the first steps, until there is enough history, are taken with the Dormand-Prince integrator
+	DPIntegrator dp(maxErr);
+	ReplayParticle start(m, p, u, &evaluations);
+	start.setIntegrator(&dp);
+	start.setProperTime(first.tau);
+
+	for(i = 0; i < n - 1; i++)
+	{
+		const ReferenceNode& a = ref.getNode(i);
+		const ReferenceNode& b = ref.getNode(i + 1);
+		AdamsPoint& last = history.back();
+		int q = history.size();
+		next.tau = b.tau;
+		memcpy(next.x, b.xPrev, sizeof(next.x));
+
+		if(q < order)
+		{
+			replayStep(&start, &dp, b.tau - start.getProperTime(), 0);
+			Point sp = start.getPos();
+			vector4 su = start.getVel();
+			packState(m->convertPointTo(sp, a.chart), m->convertVectorTo(su, sp, a.chart), y);
+			for(k = 0; k < 8; k++)
+				next.d[k] = y[k] - next.x[k];
+		}
+		else
+		{
+			//predictor - the polynomial through the history extrapolated over the step
+			for(j = 0; j < q; j++)
+				t[j] = history[j].tau - a.tau;
+			integrationWeights(t, q, 0.0, b.tau - a.tau, w);
+			for(k = 0; k < 8; k++)
+			{
+				dP[k] = last.d[k];
+				for(j = 0; j < q; j++)
+					dP[k] += w[j]*history[j].g[k];
+			}
+			difference(m, a.chart, b.xPrev, b.fPrev, dP, gP);
+
+			//corrector - the polynomial through the newest points and the predicted one
+			int c = order - 1;
+			for(j = 0; j < c; j++)
+				t[j] = history[q - c + j].tau - a.tau;
+			t[c] = b.tau - a.tau;
+			integrationWeights(t, c + 1, 0.0, b.tau - a.tau, w);
+			double err = 0.0;
+			for(k = 0; k < 8; k++)
+			{
+				next.d[k] = last.d[k] + w[c]*gP[k];
+				for(j = 0; j < c; j++)
+					next.d[k] += w[j]*history[q - c + j].g[k];
+				err += (next.d[k] - dP[k])*(next.d[k] - dP[k]);
+			}
+			//Milne's estimate
+			err = sqrt(err)*19.0/270;
+			if(err > maxErr)
+			{
+				//the parameters changed too much for the steps of the reference - the rest is integrated normally
+				replay(ref, m, i);
+				return;
+			}
+			steps++;
+		}
+		difference(m, a.chart, next.x, b.fPrev, next.d, next.g);
+
+		if(history.size() == order) history.erase(history.begin());
+		history.push_back(next);
+		for(k = 0; k < 8; k++)
+			y[k] = next.x[k] + next.d[k];
+		pos[i + 1] = Point(a.chart, y[0], y[2], y[4], y[6]);
+		vel[i + 1] = vector4(y[1], y[3], y[5], y[7]);
+
+		if(b.switched)
+		{
+			//the history is converted to the new coordinate system, the reference points with the reference manifold
+			Manifold* mRef = ref.getManifold();
+			if(!mRef)
+			{
+				replay(ref, m, i + 1);
+				return;
+			}
+			for(j = 0; j < (int)history.size(); j++)
+			{
+				AdamsPoint& h = history[j];
+				double f[8];
+				for(k = 0; k < 8; k++)
+					y[k] = h.x[k] + h.d[k];
+				Point py(a.chart, y[0], y[2], y[4], y[6]), px(a.chart, h.x[0], h.x[2], h.x[4], h.x[6]);
+				vector4 uy(y[1], y[3], y[5], y[7]), ux(h.x[1], h.x[3], h.x[5], h.x[7]);
+				packState(m->convertPointTo(py, b.chart), m->convertVectorTo(uy, py, b.chart), y);
+				if(j == (int)history.size() - 1)
+				{
+					memcpy(h.x, b.x, sizeof(h.x));
+					memcpy(f, b.f, sizeof(f));
+				}
+				else
+				{
+					packState(mRef->convertPointTo(px, b.chart), mRef->convertVectorTo(ux, px, b.chart), h.x);
+					geodesicDerivative(mRef, b.chart, h.x, f);
+					evaluations++;
+				}
+				for(k = 0; k < 8; k++)
+					h.d[k] = y[k] - h.x[k];
+				difference(m, b.chart, h.x, f, h.d, h.g);
+			}
+			for(k = 0; k < 8; k++)
+				y[k] = b.x[k] + history.back().d[k];
+			pos[i + 1] = Point(b.chart, y[0], y[2], y[4], y[6]);
+			vel[i + 1] = vector4(y[1], y[3], y[5], y[7]);
+		}
+	}
+}
+
+void ContinuationSolver::replay(ReferenceTrajectory& ref, Manifold* m, int first)
+{
+	fallbackNode = first;
+	DPIntegrator dp(maxErr);
+	ReplayParticle p(m, pos[first], vel[first], &evaluations);
+	p.setIntegrator(&dp);
+	p.setProperTime(ref.getNode(first).tau);
+
+	int i;
+	for(i = first; i < ref.getNNodes() - 1; i++)
+	{
+		replayStep(&p, &dp, ref.getNode(i + 1).tau - p.getProperTime(), 0);
+		pos[i + 1] = p.getPos();
+		vel[i + 1] = p.getVel();
+	}
+}
+
+void ContinuationSolver::replayStep(Particle* p, DPIntegrator* dp, double h, int depth)
+{
+	Point p0 = p->getPos();
+	vector4 u0 = p->getVel();
+	double tau0 = p->getProperTime();
+
+	p->propagate(h);
+	steps++;
+	//the acceptance test of DPIntegrator - the step it would predict is not smaller than 0.8 of this one
+	if(dp->getLastError() <= maxErr*pow(0.8, -4) || depth >= 16) return;
+
+	p->setPosVel(p0, u0);
+	p->setProperTime(tau0);
+	replayStep(p, dp, h/2, depth + 1);
+	replayStep(p, dp, h/2, depth + 1);
+}
+
+int ContinuationSolver::getNNodes()
+{
+	return pos.size();
+}
+
+Point ContinuationSolver::getPos(int i)
+{
+	if(i < 0 || i >= (int)pos.size()) throw "ContinuationSolver: Index out of bounds.";
+	return pos[i];
+}
+
+vector4 ContinuationSolver::getVel(int i)
+{
+	if(i < 0 || i >= (int)vel.size()) throw "ContinuationSolver: Index out of bounds.";
+	return vel[i];
+}
+
+int ContinuationSolver::getFallbackNode()
+{
+	return fallbackNode;
+}
+
+long ContinuationSolver::getEvaluations()
+{
+	return evaluations;
+}
+
+int ContinuationSolver::getSteps()
+{
+	return steps;
+}
@@ -0,0 +1,126 @@
+#ifndef __CONTINUATION_H__
+#define __CONTINUATION_H__
+
+/*! \file continuation.h
+ * \brief Cheap re-solving of geodesics after a small change of the parameters of the manifold
+ */
+
+#include "particle.h"
+#include "dpintegrator.h"
+#include <vector>
+
+/*! \struct ReferenceNode
+ * \brief The state of a reference trajectory after a step
+ */
+struct ReferenceNode
+{
+	double tau;			///< Proper time (affine parameter)
+	int chart;			///< Coordinate system
+	double x[8];		///< State (position and 4-velocity, interleaved like in Particle)
+	double f[8];		///< Derivative of the state
+	bool switched;		///< The coordinate system changed in the step ending here
+	double xPrev[8];	///< If switched - the state in the coordinate system of the step
+	double fPrev[8];	///< If switched - its derivative
+};
+
+/*! \class ReferenceTrajectory
+ * \brief A trajectory solved once, kept as a sequence of step nodes for re-solving it with changed parameters
+ *
+ * The state of the particle is added after every step (and once before the first one). The derivative at every node is
+ * calculated when it is added, which costs one evaluation of the geodesic equation per step. The trajectory keeps a copy of
+ * the manifold (Manifold::clone) with the parameters at the time of the first node, so the manifold of the particle can be
+ * changed afterwards.
+ */
+class ReferenceTrajectory
+{
+	std::vector<ReferenceNode> nodes;
+	Manifold* manifold;
+
+	ReferenceTrajectory(const ReferenceTrajectory&);
+	ReferenceTrajectory& operator=(const ReferenceTrajectory&);
+public:
+	//! Constructor - an empty trajectory
+	ReferenceTrajectory();
+	//! Destructor
+	~ReferenceTrajectory();
+
+	//! Adds the current state of a particle
+	/*! \param p The particle - a free one (moving along a geodesic)
+	 */
+	void add(Particle* p);
+	//! Removes all nodes
+	void clear();
+
+	//! Returns the number of the nodes
+	int getNNodes();
+	//! Returns a node
+	const ReferenceNode& getNode(int i);
+	//! Returns the copy of the manifold of the reference (NULL if there are no nodes or the manifold cannot be copied)
+	Manifold* getManifold();
+};
+
+/*! \class ContinuationSolver
+ * \brief Re-solves a reference trajectory on a manifold with slightly different parameters
+ *
+ * Instead of integrating the new trajectory y from scratch, the solver integrates only its difference from the reference
+ * x, d = y - x, which satisfies d' = f_new(x + d) - f_ref(x), on the nodes of the reference. The reference states and their
+ * derivatives are stored in the nodes, so only f_new is evaluated. The difference is integrated with the variable-step
+ * Adams-Bashforth-Moulton method of order 4 in the PECE mode - 2 evaluations per node, while a step of the Dormand-Prince
+ * integrator costs 6 or more. The local error (estimated from the difference of the predictor and the corrector) is
+ * proportional to the difference, not to the state, so the steps of the reference are accurate enough for it while the
+ * parameters change little. The first steps, until there is enough history for the method, are taken with the Dormand-Prince
+ * integrator.
+ *
+ * When the reference changes the coordinate system, the history of the method is converted to the new one (2 evaluations
+ * per history point). If a step misses the tolerance (the parameters changed too much), the rest of the trajectory is integrated
+ * normally, with the Dormand-Prince integrator taking the steps of the reference (halved if they miss the tolerance).
+ *
+ * The new trajectory is given at the proper times of all reference nodes. Stop conditions are not checked.
+ */
+class ContinuationSolver
+{
+	double maxErr;
+
+	std::vector<Point> pos;
+	std::vector<vector4> vel;
+	int fallbackNode;
+	long evaluations;
+	int steps;
+
+	//! Difference of the derivatives on the new and the reference manifold
+	void difference(Manifold* m, int chart, const double* x, const double* fRef, const double* d, double* g);
+	//! Continues from a node with the Dormand-Prince integrator
+	void replay(ReferenceTrajectory& ref, Manifold* m, int first);
+	//! Replays a single step, halving it if it misses the tolerance
+	void replayStep(Particle* p, DPIntegrator* dp, double h, int depth);
+public:
+	//! Constructor
+	/*! \param _maxErr Maximal error of a step (the same measure as in DPIntegrator)
+	 */
+	ContinuationSolver(double _maxErr = 1e-6);
+	//! Destructor
+	~ContinuationSolver();
+
+	//! Re-solves a trajectory
+	/*! \param ref The reference trajectory
+	 *  \param m The manifold with the new parameters (the same coordinate systems as the one of the reference)
+	 *  \param p The new initial position (it may differ slightly from the reference too)
+	 *  \param u The new initial 4-velocity
+	 */
+	void solve(ReferenceTrajectory& ref, Manifold* m, Point p, vector4 u);
+
+	//! Returns the number of the computed nodes (equal to the number of the reference nodes)
+	int getNNodes();
+	//! Returns the position at the proper time of a reference node
+	Point getPos(int i);
+	//! Returns the 4-velocity at the proper time of a reference node
+	vector4 getVel(int i);
+	//! Returns the node from which the trajectory was integrated normally (-1 - none)
+	int getFallbackNode();
+	//! Returns the number of the evaluations of the geodesic equation in the last solve
+	long getEvaluations();
+	//! Returns the number of the steps in the last solve
+	int getSteps();
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "counters.h"
+#include <vector>
+#include <mutex>
+
+/*
+ * Registry of the threads
+ */
+
+static std::mutex& registryMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+static std::vector<ThreadCounters*>& registry()
+{
+	static std::vector<ThreadCounters*> threads;
+	return threads;
+}
+
+//values of the threads which have already ended
+static CounterReport& retired()
+{
+	static CounterReport report;
+	return report;
+}
+
+thread_local ThreadCounters gThreadCounters;
+
+/*
+ * CounterReport
+ */
+
+CounterReport::CounterReport()
+{
+	int i;
+	for(i = 0; i < NCounters; i++)
+		values[i] = 0;
+	maxDPDepth = 0;
+}
+
+const char* CounterReport::name(int c)
+{
+	static const char* names[NCounters] = {
+		"derivative", "g hit", "g miss", "invg hit", "invg miss", "christoffel hit", "christoffel miss", "dg",
+		"point conversion", "vector conversion", "chart switch", "DP accepted", "DP rejected"
+	};
+	if(c < 0 || c >= NCounters) throw "CounterReport: Index out of bounds.";
+	return names[c];
+}
+
+void CounterReport::print(std::ostream& out)
+{
+	int i;
+	for(i = 0; i < NCounters; i++)
+		out << name(i) << ": " << values[i] << std::endl;
+	out << "DP max recursion depth: " << maxDPDepth << std::endl;
+
+	long g = values[GHit] + values[GMiss];
+	long gamma = values[ChristoffelHit] + values[ChristoffelMiss];
+	long dp = values[DPAccepted] + values[DPRejected];
+	if(g) out << "g hit rate: " << (double)values[GHit]/g << std::endl;
+	if(gamma) out << "christoffel hit rate: " << (double)values[ChristoffelHit]/gamma << std::endl;
+	if(dp) out << "DP rejection rate: " << (double)values[DPRejected]/dp << std::endl;
+}
+
+/*
+ * ThreadCounters
+ */
+
+ThreadCounters::ThreadCounters()
+{
+	int i;
+	for(i = 0; i < CounterReport::NCounters; i++)
+		values[i] = 0;
+	maxDPDepth = 0;
+	dpDepth = 0;
+
+	//the totals must outlive the thread-local counters, so they have to be constructed first
+	retired();
+	std::lock_guard<std::mutex> lock(registryMutex());
+	registry().push_back(this);
+}
+
+ThreadCounters::~ThreadCounters()
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	std::vector<ThreadCounters*>& threads = registry();
+	unsigned i;
+	for(i = 0; i < threads.size(); i++)
+		if(threads[i] == this)
+		{
+			threads.erase(threads.begin() + i);
+			break;
+		}
+
+	CounterReport& r = retired();
+	int j;
+	for(j = 0; j < CounterReport::NCounters; j++)
+		r.values[j] += values[j];
+	if(maxDPDepth > r.maxDPDepth) r.maxDPDepth = maxDPDepth;
+}
+
+/*
+ * Aggregation
+ */
+
+CounterReport collectCounters()
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	CounterReport result = retired();
+	std::vector<ThreadCounters*>& threads = registry();
+	unsigned i;
+	int j;
+	for(i = 0; i < threads.size(); i++)
+	{
+		for(j = 0; j < CounterReport::NCounters; j++)
+			result.values[j] += threads[i]->values[j].load(std::memory_order_relaxed);
+		long depth = threads[i]->maxDPDepth.load(std::memory_order_relaxed);
+		if(depth > result.maxDPDepth) result.maxDPDepth = depth;
+	}
+	return result;
+}
+
+void resetCounters()
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	retired() = CounterReport();
+	std::vector<ThreadCounters*>& threads = registry();
+	unsigned i;
+	int j;
+	for(i = 0; i < threads.size(); i++)
+	{
+		for(j = 0; j < CounterReport::NCounters; j++)
+			threads[i]->values[j].store(0, std::memory_order_relaxed);
+		threads[i]->maxDPDepth.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,106 @@
+#ifndef __COUNTERS_H__
+#define __COUNTERS_H__
+
+/*! \file counters.h
+ * \brief Optional counters of the hot paths of the engine
+ *
+ * The counters are compiled in only if GR_COUNTERS is defined (e.g. make CXXFLAGS="-std=c++11 -O2 -DGR_COUNTERS").
+ * Otherwise the GR_COUNT macros expand to nothing and the instrumentation costs nothing.
+ */
+
+#include <ostream>
+#include <atomic>
+
+/*! \class CounterReport
+ * \brief Values of the counters summed over all threads
+ */
+class CounterReport
+{
+public:
+	//! The counters
+	enum Counter
+	{
+		Derivative = 0,		///< DiffEq::derivative calls (Particle and Entity)
+		GHit,				///< Metric::g served from the cache
+		GMiss,				///< Metric::g calculated
+		InvgHit,			///< Metric::invg served from the cache
+		InvgMiss,			///< Metric::invg calculated
+		ChristoffelHit,		///< Metric::christoffel served from the cache
+		ChristoffelMiss,	///< Metric::christoffel calculated
+		Dg,					///< Metric::dg calls
+		PointConversion,	///< Manifold::convertPointTo calls
+		VectorConversion,	///< Manifold::convertVectorTo calls
+		ChartSwitch,		///< Changes of the coordinate system recommended after a step
+		DPAccepted,			///< Steps accepted by DPIntegrator
+		DPRejected,			///< Steps rejected by DPIntegrator
+		NCounters
+	};
+
+	long values[NCounters];
+	long maxDPDepth;	///< Deepest recursion of DPIntegrator::next (1 - accepted at the first attempt)
+
+	//! Constructor - zeroes the counters
+	CounterReport();
+
+	//! Returns the name of a counter
+	static const char* name(int c);
+	//! Prints the counters and the derived ratios
+	void print(std::ostream&);
+};
+
+/*! \class ThreadCounters
+ * \brief Counters of a single thread
+ *
+ * Every thread increments its own counters, so no synchronization is needed on the hot path (the atomics are only
+ * read and written with relaxed ordering, which compiles to plain loads and stores). The threads register themselves
+ * on the first use, and their values are added to the totals when they end.
+ */
+class ThreadCounters
+{
+public:
+	std::atomic<long> values[CounterReport::NCounters];
+	std::atomic<long> maxDPDepth;
+	int dpDepth;	///< Rejections of the step in progress
+
+	ThreadCounters();
+	~ThreadCounters();
+
+	//! Increments a counter
+	inline void add(int c)
+	{
+		values[c].store(values[c].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	//! Records a rejected step of DPIntegrator
+	inline void dpRejected()
+	{
+		add(CounterReport::DPRejected);
+		dpDepth++;
+	}
+	//! Records an accepted step of DPIntegrator
+	inline void dpAccepted()
+	{
+		add(CounterReport::DPAccepted);
+		if(dpDepth + 1 > maxDPDepth.load(std::memory_order_relaxed))
+			maxDPDepth.store(dpDepth + 1, std::memory_order_relaxed);
+		dpDepth = 0;
+	}
+};
+
+extern thread_local ThreadCounters gThreadCounters;
+
+//! Sums the counters of all threads (including the finished ones)
+CounterReport collectCounters();
+//! Zeroes the counters of all threads
+void resetCounters();
+
+#ifdef GR_COUNTERS
+#define GR_COUNT(c) gThreadCounters.add(CounterReport::c)
+#define GR_COUNT_DP_REJECTED() gThreadCounters.dpRejected()
+#define GR_COUNT_DP_ACCEPTED() gThreadCounters.dpAccepted()
+#else
+#define GR_COUNT(c) ((void)0)
+#define GR_COUNT_DP_REJECTED() ((void)0)
+#define GR_COUNT_DP_ACCEPTED() ((void)0)
+#endif
+
+#endif
@@ -1,4 +1,6 @@
 #include "dpintegrator.h"
+#include "counters.h"
+#include "profiler.h"
 #include <math.h>
 
 /*******************************************************************************
@@ -13,6 +15,9 @@ DPIntegrator::DPIntegrator(double maxErr, double stepSize, double minStep, doubl
 	this->maxErr = maxErr;
 	this->minStep = minStep;
 	this->maxStep = maxStep;
+	rejections = 0;
+	lastEq = NULL;
+	stiffness = 0.0;
 }
 
 DPIntegrator::~DPIntegrator()
@@ -21,6 +26,7 @@ DPIntegrator::~DPIntegrator()
 
 StateVector DPIntegrator::next(StateVector state, DiffEq* equation, double step)
 {
+	GR_PROFILE_SCOPE(Step);
 	double h;
 	if(step == 0.0) 
 		h = stepSize;
@@ -38,14 +44,15 @@ StateVector DPIntegrator::next(StateVector state, DiffEq* equation, double step)
 	k3 = h * equation -> derivative(state + k1*3.0/40 + k2*9.0/40);
 	k4 = h * equation -> derivative(state + k1*44.0/45 - k2*56.0/15 + k3*32.0/9);
 	k5 = h * equation -> derivative(state + k1*19372.0/6561 - k2*25360.0/2187 + k3*64448.0/6561 - k4*212.0/729);
-	k6 = h * equation -> derivative(state + k1*9017.0/3168 - k2*355.0/33 + k3*46732.0/5247 + k4*49.0/176 - k5*5103.0/18656);
+	StateVector y6 = state + k1*9017.0/3168 - k2*355.0/33 + k3*46732.0/5247 + k4*49.0/176 - k5*5103.0/18656;
+	k6 = h * equation -> derivative(y6);
 
 
 	nextState = state + k1*35.0/384 + k3*500.0/1113 + k4*125.0/192 - k5*2187.0/6784 + k6*11.0/84;
 
 	k7 = equation -> derivative(nextState);
 
-	double error = abs(k1*71.0/57600 - k3*71.0/16695 + k4*71.0/1920 - k5*17253.0/339200 + k6*22.0/525 - h*k7/40);
+	double error = equation -> errorNorm(k1*71.0/57600 - k3*71.0/16695 + k4*71.0/1920 - k5*17253.0/339200 + k6*22.0/525 - h*k7/40);
 	
 	if(error != 0.0) stepSize = h*pow(maxErr/error, 0.25);
 	else stepSize = maxStep;
@@ -53,7 +60,20 @@ StateVector DPIntegrator::next(StateVector state, DiffEq* equation, double step)
 	if(stepSize < minStep) stepSize = minStep;
 	if(stepSize > maxStep) stepSize = maxStep;
 	if(stepSize < 0.8*h && step == 0.0)
+	{
+		GR_COUNT_DP_REJECTED();
+		rejections++;
 		return next(state, equation);
+	}
+	GR_COUNT_DP_ACCEPTED();
+	
+	lastStep = h;
+	lastError = error;
+	lastRejections = rejections;
+	rejections = 0;
+	//h |lambda| from the last two stages (Hairer), the stability region ends at about 3.3
+	double dy = abs(nextState - y6);
+	stiffness = (dy > 0.0) ? abs(h*k7 - k6)/dy : 0.0;
 	
 	//for optimization
 	lastDerivative = k7;
@@ -78,6 +98,11 @@ double DPIntegrator::getMaxStep()
 	return maxStep;
 }
 
+double DPIntegrator::getStiffness()
+{
+	return stiffness;
+}
+
 void DPIntegrator::setMaxErr(double mE)
 {
 	maxErr = mE;
@@ -93,3 +118,44 @@ void DPIntegrator::setMaxStep(double mS)
 	maxStep = mS;
 }
 
+DiffEq* DPIntegrator::getLastEquation()
+{
+	return lastDerivative.size() ? lastEq : NULL;
+}
+
+void DPIntegrator::setLastEquation(DiffEq* eq)
+{
+	lastEq = eq;
+}
+
+void DPIntegrator::saveState(StateWriter& w)
+{
+	Integrator::saveState(w);
+	w.putDouble(maxErr);
+	w.putDouble(minStep);
+	w.putDouble(maxStep);
+	w.putInt(rejections);
+	w.putInt(lastDerivative.size());
+	if(lastDerivative.size()) w.putDoubles(&lastDerivative[0], lastDerivative.size());
+	w.putInt(lastState.size());
+	if(lastState.size()) w.putDoubles(&lastState[0], lastState.size());
+}
+
+void DPIntegrator::loadState(StateReader& r)
+{
+	Integrator::loadState(r);
+	maxErr = r.getDouble();
+	minStep = r.getDouble();
+	maxStep = r.getDouble();
+	rejections = r.getInt();
+	int n = r.getInt();
+	if(n < 0 || (uint64_t)n*sizeof(double) > r.remaining()) throw "DPIntegrator: Invalid state.";
+	lastDerivative.resize(n);
+	if(n) r.getDoubles(&lastDerivative[0], n);
+	n = r.getInt();
+	if(n < 0 || (uint64_t)n*sizeof(double) > r.remaining()) throw "DPIntegrator: Invalid state.";
+	lastState.resize(n);
+	if(n) r.getDoubles(&lastState[0], n);
+	lastEq = NULL;
+}
+
@@ -20,6 +20,8 @@ class DPIntegrator : public Integrator
 	
 	StateVector lastDerivative, lastState;
 	DiffEq* lastEq;
+	int rejections;	///< Rejections since the last accepted step
+	double stiffness;	///< Estimate of h |lambda| in the last step
 public:
 	//! Constructor
 	/*! \param maxErr The error margin - if the error is larger than this margin, the step size is decreased.
@@ -43,6 +45,11 @@ public:
 	double getMinStep();
 	//! Returns the maximal step size
 	double getMaxStep();
+	//! Returns the estimate of h |lambda| of the last accepted step
+	/*! Values near the border of the stability region (about 3.3) mean the step is limited by stability, not accuracy -
+	 *  the equation is stiff (see AutoIntegrator).
+	 */
+	double getStiffness();
 	
 	//! Sets the error margin
 	void setMaxErr(double);
@@ -50,6 +57,12 @@ public:
 	void setMinStep(double);
 	//! Sets the maximal step size
 	void setMaxStep(double);
+	
+	DiffEq* getLastEquation();
+	void setLastEquation(DiffEq*);
+	//! Serializes the internal state, including the derivative at the end of the last step (reused by the next one)
+	void saveState(StateWriter&);
+	void loadState(StateReader&);
 };
 
 #endif
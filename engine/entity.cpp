@@ -1,4 +1,6 @@
 #include "entity.h"
+#include "counters.h"
+#include "profiler.h"
 #include <math.h>
 
 Entity::Entity(Manifold* _m, Point _p, vector4 _u, vector4 _x, vector4 _y, vector4 _z)
@@ -163,7 +165,9 @@ vector4 Entity::getZ()
 void Entity::setPosVel(Point _p, vector4 _u)
 {
 	p = _p;
+	lastPos = Point();
 	u = _u;
+	stopReason = StopCondition::NotStopped;
 	orthonormalize();
 }
 
@@ -173,8 +177,32 @@ void Entity::setVel(vector4 _u)
 	orthonormalize();
 }
 
+void Entity::saveState(StateWriter& w)
+{
+	int i, j;
+	Particle::saveState(w);
+	for(i = 0; i < 3; i++)
+		for(j = 0; j < 4; j++)
+			w.putDouble(basis[i][j]);
+	w.putDoubles(force, 3);
+	w.putDoubles(angvel, 3);
+}
+
+void Entity::loadState(StateReader& r)
+{
+	int i, j;
+	Particle::loadState(r);
+	for(i = 0; i < 3; i++)
+		for(j = 0; j < 4; j++)
+			basis[i][j] = r.getDouble();
+	r.getDoubles(force, 3);
+	r.getDoubles(angvel, 3);
+}
+
 StateVector Entity::derivative(StateVector v)
 {
+	GR_COUNT(Derivative);
+	GR_PROFILE_SCOPE(Derivative);
 	StateVector result;
 	int i,j;
 	for(i=0; i<4; i++)
@@ -184,12 +212,28 @@ StateVector Entity::derivative(StateVector v)
 	Point p1 = getPosFromState(v);
 	vector4 u1 = getVelFromState(v);
 	
+	//Gamma^i_jk u^j evaluated once for the whole basis
+	double gamma[4][4][4], A[4][4];
+	int k;
+	metric -> christoffel(p1, gamma);
+	for(i=0; i<4; i++)
+		for(k=0; k<4; k++)
+		{
+			A[i][k] = 0.0;
+			for(j=0; j<4; j++)
+				A[i][k] += gamma[i][j][k]*u1[j];
+		}
+	
 	for(j=0; j<4; j++)	
 	{
 		vector4 v1 = getVectorFromState(v, j);
-		vector4 force = calculateFourForce(j) - metric -> christoffel(u1, v1, p1);
+		vector4 force = calculateFourForce(j);
 		for(i=0; i<4; i++)
+		{
+			for(k=0; k<4; k++)
+				force[i] -= A[i][k]*v1[k];
 			result.push_back(force[i]);
+		}
 	}
 		
 	return result;
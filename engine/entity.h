@@ -86,6 +86,11 @@ public:
 	 */
 	void setVel(vector4);
 	
+	//! Serializes the state of the entity (the state of the particle, the local basis and the pending force and rotation)
+	void saveState(StateWriter&);
+	//! Restores the state of the entity
+	void loadState(StateReader&);
+	
 	//! Adds an acceleration to the entity
 	/*! \param x Local X component
 	 *  \param y Local Y component
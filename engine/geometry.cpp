@@ -1,11 +1,13 @@
 #include "geometry.h"
+#include "counters.h"
+#include "profiler.h"
+#include <string.h>
+#include <math.h>
 
 /*
 Point
 */
 
-Manifold* Point::m;
-
 Point::Point()
 {
 	coordSystem = -1;
@@ -67,10 +69,7 @@ vector4 Point::toVector4()
 bool Point::operator==(Point arg)
 {
 	if(coordSystem == -1) return false;
-	if(arg.coordSystem == -1) return false;
-	
-	if(arg.coordSystem != coordSystem)
-		arg = m->getConversion(arg.coordSystem, coordSystem)->convertPoint(arg);
+	if(arg.coordSystem != coordSystem) return false;
 	
 	for(int i=0; i<4; i++)
 		if(x[i] != arg.x[i]) return false;
@@ -82,11 +81,6 @@ bool Point::operator!=(Point arg)
 	return !((*this) == arg);
 }
 
-void Point::setGlobalManifold(Manifold* _m)
-{
-	m = _m;
-}
-
 /*
 vector4
 */
@@ -238,17 +232,49 @@ double IdentityConversion::inv_jacobian(int i, int j, Point)
  * Metric
  */
  
-Metric::Metric(int cS)
+Metric::Metric(int cS, Manifold* _manifold)
 {
 	coordSystem = cS;
+	manifold = _manifold;
 }
 
 Metric::~Metric()
 {
 }
 
+void Metric::clearCache()
+{
+	int i, j, k;
+	for(i = 0; i < 4; i++)
+		for(j = 0; j < 4; j++)
+		{
+			gCachePoints[i][j] = Point();
+			invgCachePoints[i][j] = Point();
+			for(k = 0; k < 4; k++)
+				gammaCachePoints[i][j][k] = Point();
+		}
+	gammaTablePoint = Point();
+	riemannTablePoint = Point();
+}
+
+bool Metric::isIgnorable(int)
+{
+	return false;
+}
+
+Manifold* Metric::getManifold()
+{
+	return manifold;
+}
+
+int Metric::getCoordSystem()
+{
+	return coordSystem;
+}
+
 double Metric::dg(int i, int j, int k, Point p)
 {
+	GR_COUNT(Dg);
 	double h = 0.0001;
 	double df = 0.0;
 	
@@ -266,6 +292,7 @@ double Metric::dg(int i, int j, int k, Point p)
 
 double Metric::g(vector4 u, vector4 v, Point p)
 {
+	GR_PROFILE_SCOPE(Metric);
 	int i,j;
 	double sum = 0.0;
 	for(i=0; i<4; i++)
@@ -276,6 +303,7 @@ double Metric::g(vector4 u, vector4 v, Point p)
 
 vector4 Metric::christoffel(vector4 u, vector4 v, Point p)
 {
+	GR_PROFILE_SCOPE(Metric);
 	int i, j, k;
 	vector4 result;
 	
@@ -286,6 +314,271 @@ vector4 Metric::christoffel(vector4 u, vector4 v, Point p)
 	return result;
 }
 
+void Metric::christoffel(Point p, double gamma[4][4][4])
+{
+	GR_PROFILE_SCOPE(Metric);
+	int i, j, k;
+	
+	if(gammaTablePoint != p)
+	{
+		gammaTablePoint = p;
+		for(i=0; i<4; i++)
+			for(j=0; j<4; j++)
+				for(k=j; k<4; k++)
+				{
+					GR_COUNT(ChristoffelMiss);
+					gammaTable[i][j][k] = gammaTable[i][k][j] = _christoffel(i, j, k, p);
+				}
+	}
+	else GR_COUNT(ChristoffelHit);
+	memcpy(gamma, gammaTable, sizeof(gammaTable));
+}
+
+double Metric::riemann(int i, int j, int k, int l, Point p)
+{
+	if(riemannTablePoint != p)
+	{
+		riemannTablePoint = p;
+		_riemann(p, riemannTable);
+	}
+	return riemannTable[i][j][k][l];
+}
+
+void Metric::riemann(Point p, double R[4][4][4][4])
+{
+	if(riemannTablePoint != p)
+	{
+		riemannTablePoint = p;
+		_riemann(p, riemannTable);
+	}
+	memcpy(R, riemannTable, sizeof(riemannTable));
+}
+
+void Metric::_riemann(Point p, double R[4][4][4][4])
+{
+	riemannFromChristoffel(p, R);
+}
+
+void Metric::tidal(Point p, vector4 u, double K[4][4])
+{
+	_tidal(p, u, K);
+}
+
+void Metric::_tidal(Point p, vector4 u, double K[4][4])
+{
+	int i, j, k, l;
+	double R[4][4][4][4];
+	riemann(p, R);
+	for(i=0; i<4; i++)
+		for(k=0; k<4; k++)
+		{
+			K[i][k] = 0.0;
+			for(j=0; j<4; j++)
+				for(l=0; l<4; l++)
+					K[i][k] += R[i][j][k][l]*u[j]*u[l];
+		}
+}
+
+void Metric::riemannFromChristoffel(Point p, double R[4][4][4][4])
+{
+	//relative step of the central differences - about the cube root of the machine epsilon
+	const double diffStep = 6e-6;
+	double dGamma[4][4][4][4];	//[k][i][j][l] = d_k Gamma^i_jl
+	double gamma[4][4][4], g1[4][4][4], g2[4][4][4];
+	int i, j, k, l, n;
+	
+	for(k=0; k<4; k++)
+	{
+		if(isIgnorable(k))
+		{
+			memset(dGamma[k], 0, sizeof(dGamma[k]));
+			continue;
+		}
+		double h = diffStep*(1.0 + fabs(p[k]));
+		Point p1 = p, p2 = p;
+		p1[k] += h;
+		p2[k] -= h;
+		christoffel(p1, g1);
+		christoffel(p2, g2);
+		for(i=0; i<4; i++)
+			for(j=0; j<4; j++)
+				for(l=0; l<4; l++)
+					dGamma[k][i][j][l] = (g1[i][j][l] - g2[i][j][l])/(2*h);
+	}
+	christoffel(p, gamma);
+	
+	for(i=0; i<4; i++)
+		for(j=0; j<4; j++)
+			for(k=0; k<4; k++)
+				for(l=0; l<4; l++)
+				{
+					double sum = dGamma[k][i][l][j] - dGamma[l][i][k][j];
+					for(n=0; n<4; n++)
+						sum += gamma[i][k][n]*gamma[n][l][j] - gamma[i][l][n]*gamma[n][k][j];
+					R[i][j][k][l] = sum;
+				}
+}
+
+//the Levi-Civita symbol of the spatial indices 1-3
+static int levi(int i, int j, int k)
+{
+	return (i - j)*(j - k)*(k - i)/2;
+}
+
+//a component of the canonical type D Weyl tensor R_abcd in an orthonormal frame (signature -+++), E and B diagonal
+static double typeDComponent(int a, int b, int c, int d, const double* E, const double* B)
+{
+	int m;
+	if(a == b || c == d) return 0.0;
+	if(a > b) return -typeDComponent(b, a, c, d, E, B);
+	if(c > d) return -typeDComponent(a, b, d, c, E, B);
+	if(a == 0 && c == 0) return (b == d) ? E[b] : 0.0;
+	if(a == 0) return levi(c, d, b)*B[b];
+	if(c == 0) return levi(a, b, d)*B[d];
+	double sum = 0.0;
+	for(m=1; m<4; m++)
+		sum -= levi(a, b, m)*levi(c, d, m)*E[m];
+	return sum;
+}
+
+//the orthonormal frame of a type D spacetime (e[a][i]), its dual (w[a][i]) and the Riemann tensor in it (F[a][b][c][d] = R^a_bcd)
+static void typeDFrame(Metric* m, Point p, double re, double im, vector4 l, vector4 n, vector4 b2, vector4 b3,
+	double e[4][4], double w[4][4], double F[4][4][4][4])
+{
+	const double eta[4] = { 1.0, -1.0, -1.0, -1.0 };
+	int a, b, c, d, i, j;
+	
+	//the orthonormal frame and its dual, with the metric read once
+	double gm[4][4];
+	for(i=0; i<4; i++)
+		for(j=0; j<4; j++)
+			gm[i][j] = m->g(i, j, p);
+	for(i=0; i<4; i++)
+	{
+		e[0][i] = l[i] + n[i];
+		e[1][i] = l[i] - n[i];
+		e[2][i] = b2[i];
+		e[3][i] = b3[i];
+	}
+	for(a=0; a<4; a++)
+	{
+		for(b=0; b<a; b++)
+		{
+			double dot = 0.0;
+			for(i=0; i<4; i++)
+				dot += e[a][i]*w[b][i];
+			for(i=0; i<4; i++)
+				e[a][i] -= dot*e[b][i];
+		}
+		double norm = 0.0;
+		for(i=0; i<4; i++)
+			for(j=0; j<4; j++)
+				norm += gm[i][j]*e[a][i]*e[a][j];
+		norm = sqrt(fabs(norm));
+		for(i=0; i<4; i++)
+			e[a][i] /= norm;
+		for(i=0; i<4; i++)
+		{
+			w[a][i] = 0.0;
+			for(j=0; j<4; j++)
+				w[a][i] += eta[a]*gm[i][j]*e[a][j];
+		}
+	}
+	
+	//R^a_bcd in the frame from its electric and magnetic parts - R_abcd changes its sign with the signature
+	const double E[4] = { 0.0, -2*re, re, re };
+	const double B[4] = { 0.0, 2*im, -im, -im };
+	memset(F, 0, 256*sizeof(double));
+	for(a=0; a<4; a++)
+		for(b=a+1; b<4; b++)
+			for(c=0; c<4; c++)
+				for(d=c+1; d<4; d++)
+				{
+					double v = typeDComponent(a, b, c, d, E, B);
+					F[a][b][c][d] = -eta[a]*v;
+					F[b][a][c][d] = eta[b]*v;
+					F[a][b][d][c] = eta[a]*v;
+					F[b][a][d][c] = -eta[b]*v;
+				}
+}
+
+void Metric::typeDRiemann(Point p, double re, double im, vector4 l, vector4 n, vector4 b2, vector4 b3, double R[4][4][4][4])
+{
+	int a, b, c, d, i, j;
+	double e[4][4], w[4][4], F[4][4][4][4], T[4][4][4][4];
+	typeDFrame(this, p, re, im, l, n, b2, b3, e, w, F);
+	
+	//transformation to the coordinates, one index at a time - most of the frame components are zero
+	memset(T, 0, sizeof(T));
+	for(a=0; a<4; a++)
+		for(b=0; b<4; b++)
+			for(c=0; c<4; c++)
+				for(d=0; d<4; d++)
+				{
+					if(F[a][b][c][d] == 0.0) continue;
+					for(i=0; i<4; i++)
+						T[a][b][c][i] += F[a][b][c][d]*w[d][i];
+				}
+	for(a=0; a<4; a++)
+		for(b=0; b<4; b++)
+			for(i=0; i<4; i++)
+				for(j=0; j<4; j++)
+				{
+					F[a][b][i][j] = 0.0;
+					for(c=0; c<4; c++)
+						F[a][b][i][j] += T[a][b][c][j]*w[c][i];
+				}
+	for(a=0; a<4; a++)
+		for(i=0; i<4; i++)
+			for(c=0; c<4; c++)
+				for(d=0; d<4; d++)
+				{
+					T[a][i][c][d] = 0.0;
+					for(b=0; b<4; b++)
+						T[a][i][c][d] += F[a][b][c][d]*w[b][i];
+				}
+	for(i=0; i<4; i++)
+		for(b=0; b<4; b++)
+			for(c=0; c<4; c++)
+				for(d=0; d<4; d++)
+				{
+					R[i][b][c][d] = 0.0;
+					for(a=0; a<4; a++)
+						R[i][b][c][d] += e[a][i]*T[a][b][c][d];
+				}
+}
+
+void Metric::typeDTidal(Point p, double re, double im, vector4 l, vector4 n, vector4 b2, vector4 b3, vector4 u, double K[4][4])
+{
+	int a, b, c, d, i, k;
+	double e[4][4], w[4][4], F[4][4][4][4], ua[4], Kf[4][4];
+	typeDFrame(this, p, re, im, l, n, b2, b3, e, w, F);
+	
+	//R^a_bcd u^b u^d in the frame, then back to the coordinates
+	for(a=0; a<4; a++)
+	{
+		ua[a] = 0.0;
+		for(i=0; i<4; i++)
+			ua[a] += w[a][i]*u[i];
+	}
+	for(a=0; a<4; a++)
+		for(c=0; c<4; c++)
+		{
+			Kf[a][c] = 0.0;
+			for(b=0; b<4; b++)
+				for(d=0; d<4; d++)
+					Kf[a][c] += F[a][b][c][d]*ua[b]*ua[d];
+		}
+	for(i=0; i<4; i++)
+		for(k=0; k<4; k++)
+		{
+			K[i][k] = 0.0;
+			for(a=0; a<4; a++)
+				for(c=0; c<4; c++)
+					K[i][k] += e[a][i]*Kf[a][c]*w[c][k];
+		}
+}
+
 double Metric::g(int i, int j, Point p)
 {
 	if(i > j)
@@ -298,9 +591,11 @@ double Metric::g(int i, int j, Point p)
 	
 	if(gCachePoints[i][j] != p)
 	{
+		GR_COUNT(GMiss);
 		gCachePoints[i][j] = p;
 		gCache[i][j] = _g(i, j, p);
 	}
+	else GR_COUNT(GHit);
 	return gCache[i][j];
 }
 
@@ -316,9 +611,11 @@ double Metric::invg(int i, int j, Point p)
 	
 	if(invgCachePoints[i][j] != p)
 	{
+		GR_COUNT(InvgMiss);
 		invgCachePoints[i][j] = p;
 		invgCache[i][j] = _invg(i, j, p);
 	}
+	else GR_COUNT(InvgHit);
 	return invgCache[i][j];
 }
 
@@ -334,9 +631,11 @@ double Metric::christoffel(int i, int j, int k, Point p)
 	
 	if(gammaCachePoints[i][j][k] != p)
 	{
+		GR_COUNT(ChristoffelMiss);
 		gammaCachePoints[i][j][k] = p;
 		gammaCache[i][j][k] = _christoffel(i, j, k, p);
 	}
+	else GR_COUNT(ChristoffelHit);
 	return gammaCache[i][j][k];
 }
 
@@ -344,8 +643,6 @@ double Metric::christoffel(int i, int j, int k, Point p)
 Manifold
 */
 
-Manifold* gManifold = NULL;
-
 Manifold::Manifold()
 {
 }
@@ -366,9 +663,32 @@ Metric* Manifold::getMetric(int i)
 	return metrics[i];
 }
 
+int Manifold::getNCoordSystems()
+{
+	return nCoordSystems;
+}
+
+void Manifold::clearCaches()
+{
+	int i;
+	for(i = 0; i < nCoordSystems; i++)
+		metrics[i]->clearCache();
+}
+
+void Manifold::saveState(StateWriter&)
+{
+}
+
+void Manifold::loadState(StateReader&)
+{
+	clearCaches();
+}
+
 Point Manifold::convertPointTo(Point p, int system)
 {
 	if(system < 0 || system >= nCoordSystems) throw "Manifold: Index out of bounds.";
+	GR_COUNT(PointConversion);
+	GR_PROFILE_SCOPE(Conversion);
 	Point result(system);
 	
 	result = conversions[p.getCoordSystem()][system]->convertPoint(p);
@@ -379,6 +699,8 @@ Point Manifold::convertPointTo(Point p, int system)
 vector4 Manifold::convertVectorTo(vector4 v, Point p, int system)
 {
 	if(system < 0 || system >= nCoordSystems) throw "Manifold: Index out of bounds.";
+	GR_COUNT(VectorConversion);
+	GR_PROFILE_SCOPE(Conversion);
 	vector4 result;
 	
 	CoordinateConversion* c = conversions[p.getCoordSystem()][system];
@@ -394,7 +716,36 @@ vector4 Manifold::convertVectorTo(vector4 v, Point p, int system)
 	return result;
 }
 
+bool Manifold::isSamePoint(Point p, Point q)
+{
+	if(p.getCoordSystem() < 0 || p.getCoordSystem() >= nCoordSystems) return false;
+	if(q.getCoordSystem() < 0 || q.getCoordSystem() >= nCoordSystems) return false;
+	if(q.getCoordSystem() != p.getCoordSystem())
+		q = convertPointTo(q, p.getCoordSystem());
+	return p == q;
+}
+
 int Manifold::recommendCoordSystem(Point p)
 {
 	return p.getCoordSystem(); 	//trivial implementation
 }
+
+Manifold* Manifold::clone()
+{
+	return NULL;
+}
+
+int Manifold::getNParameters()
+{
+	return 0;
+}
+
+double Manifold::getParameter(int)
+{
+	throw "Manifold: Index out of bounds.";
+}
+
+void Manifold::setParameter(int, double)
+{
+	throw "Manifold: Index out of bounds.";
+}
@@ -9,9 +9,9 @@
 #define NULL 0
 #endif
 
-class Manifold;
+#include "serialize.h"
 
-extern Manifold* gManifold;
+class Manifold;
 
 /*! \class vector4
  * \brief A 4-dimensional tangent vector
@@ -57,13 +57,13 @@ public:
 /*! \class Point
  * \brief A point on a manifold
  *
- * The class defines a point on the manifold using 4 coordinates and the number of the coordinate system being used. This allows for two points from different coordinate systems to be compared.
+ * The class defines a point on the manifold using 4 coordinates and the number of the coordinate system being used. A point does not know its manifold
+ * - points expressed in different coordinate systems are compared with Manifold::isSamePoint.
  */
 class Point
 {
 	double x[4];
 	int coordSystem;
-	static Manifold* m; ///< The manifold used by the program
 public:
 	//! Default constructor - initializes the point with an invalid coordinate system
 	Point();
@@ -104,14 +104,11 @@ public:
 	 */
 	vector4 toVector4();
 	
+	//! Comparison of points
+	/*! \return true if both points are expressed in the same, valid coordinate system and have equal coordinates
+	 */
 	bool operator==(Point);
 	bool operator!=(Point);
-	
-	//! Static method setting the global manifold variable
-	/* This method sets the manifold being used in the whole program
-	 * \param _m The pointer to the manifold object
-	 */
-	static void setGlobalManifold(Manifold* _m);
 };
 
 /*! \class CoordinateConversion
@@ -198,12 +195,17 @@ class Metric
 	Point gCachePoints[4][4];
 	Point invgCachePoints[4][4];
 	Point gammaCachePoints[4][4][4];
+	Point gammaTablePoint;
+	Point riemannTablePoint;
 	
 	double gCache[4][4];
 	double invgCache[4][4];
 	double gammaCache[4][4][4];
+	double gammaTable[4][4][4];
+	double riemannTable[4][4][4][4];
 protected:
 	int coordSystem;
+	Manifold* manifold;	///< The manifold on which the metric is defined
 	//! Partial derivative of the metric
 	/*! Returns partial derivative of a component of the metric with respect to some coordinate.
 	 *  \param i First index of the component
@@ -239,11 +241,46 @@ protected:
 	 *  \return Gamma^i_jk(p)
 	 */
 	virtual double _christoffel(int i, int j, int k, Point p) = 0;
+	//! The Riemann tensor
+	/*! Function calculating all components of the Riemann tensor. The default implementation is riemannFromChristoffel.
+	 *  \param p The point at which the tensor is evaluated
+	 *  \param R The components - R[i][j][k][l] = R^i_jkl(p)
+	 */
+	virtual void _riemann(Point p, double R[4][4][4][4]);
+	//! The tidal tensor
+	/*! Function calculating the Riemann tensor contracted twice with a vector. The default implementation contracts the table of
+	 *  riemann(Point, double[4][4][4][4]).
+	 *  \param p The point at which the tensor is evaluated
+	 *  \param u The vector
+	 *  \param K The components - K[i][k] = R^i_jkl(p) u^j u^l
+	 */
+	virtual void _tidal(Point p, vector4 u, double K[4][4]);
+	//! The Riemann tensor of a vacuum spacetime of Petrov type D (e.g. Schwarzschild or Kerr)
+	/*! The Weyl tensor has the canonical form in an orthonormal frame whose first two vectors span the principal null directions
+	 *  - it is given by the complex scalar Psi = -Psi_2, and it does not change under boosts in the plane of the principal null
+	 *  directions and rotations in the plane orthogonal to it.
+	 *  \param p The point
+	 *  \param re Real part of Psi (M/r^3 for Schwarzschild)
+	 *  \param im Imaginary part of Psi
+	 *  \param l The outgoing principal null direction
+	 *  \param n The ingoing principal null direction
+	 *  \param b2 A vector completing the frame (the direction of increasing theta)
+	 *  \param b3 A vector completing the frame (the direction of increasing phi)
+	 *  \param R The components - R[i][j][k][l] = R^i_jkl(p)
+	 */
+	void typeDRiemann(Point p, double re, double im, vector4 l, vector4 n, vector4 b2, vector4 b3, double R[4][4][4][4]);
+	//! The tidal tensor of a vacuum spacetime of Petrov type D
+	/*! The parameters as in typeDRiemann - the contraction is made in the orthonormal frame, where most components vanish.
+	 *  \param u The vector
+	 *  \param K The components - K[i][k] = R^i_jkl(p) u^j u^l
+	 */
+	void typeDTidal(Point p, double re, double im, vector4 l, vector4 n, vector4 b2, vector4 b3, vector4 u, double K[4][4]);
 public:
     //! Constructor
     /*! \param cS Coordinate system.
+     *  \param _manifold The manifold on which the metric is defined
      */
-	Metric(int cS);
+	Metric(int cS, Manifold* _manifold);
 	//! Destructor
 	virtual ~Metric();
 	
@@ -293,6 +330,58 @@ public:
 	 *  \return Gamma^i_jk(p) u^j v^k
 	 */
 	vector4 christoffel(vector4 u, vector4 v, Point p);
+	
+	//! All components of the Christoffel symbol
+	/*! Function filling the whole table of the Christoffel symbols at a point, for contracting with many vectors.
+	 *  Uses internal caching - the table is recalculated only when the point changes.
+	 *  \param p The point at which the symbols are evaluated
+	 *  \param gamma The table - gamma[i][j][k] = Gamma^i_jk(p)
+	 */
+	void christoffel(Point p, double gamma[4][4][4]);
+	
+	//! Component of the Riemann tensor
+	/*! Uses internal caching.
+	 *  \param i First index of the component
+	 *  \param j Second index of the component
+	 *  \param k Third index of the component
+	 *  \param l Fourth index of the component
+	 *  \param p The point at which the component is evaluated
+	 *  \return R^i_jkl(p) - the convention in which [nabla_k, nabla_l] V^i = R^i_jkl V^j, and the geodesic deviation is
+	 *          D^2 xi^i/dtau^2 = -R^i_jkl u^j xi^k u^l
+	 */
+	double riemann(int i, int j, int k, int l, Point p);
+	//! All components of the Riemann tensor
+	/*! Uses internal caching - the table is recalculated only when the point changes.
+	 *  \param p The point at which the tensor is evaluated
+	 *  \param R The table - R[i][j][k][l] = R^i_jkl(p)
+	 */
+	void riemann(Point p, double R[4][4][4][4]);
+	//! The tidal tensor - the Riemann tensor contracted twice with a vector
+	/*! The geodesic deviation equation is D^2 xi^i/dtau^2 = -K^i_k xi^k. Not cached - it depends on the vector.
+	 *  \param p The point at which the tensor is evaluated
+	 *  \param u The vector (the tangent of the geodesic)
+	 *  \param K The components - K[i][k] = R^i_jkl(p) u^j u^l
+	 */
+	void tidal(Point p, vector4 u, double K[4][4]);
+	//! The Riemann tensor from central differences of the Christoffel symbols
+	/*! The default for metrics without an analytic Riemann tensor. The ignorable coordinates (isIgnorable) are not differentiated.
+	 *  \param p The point at which the tensor is evaluated
+	 *  \param R The components - R[i][j][k][l] = R^i_jkl(p)
+	 */
+	void riemannFromChristoffel(Point p, double R[4][4][4][4]);
+	
+	//! Returns true if the metric does not depend on a coordinate (default implementation - false for all)
+	/*! Derivatives with respect to such coordinates (e.g. of the Christoffel symbols) are zero and need not be calculated.
+	 *  \param i The index of the coordinate
+	 */
+	virtual bool isIgnorable(int i);
+	
+	//! Removes all cached values - must be called when the parameters of the manifold change
+	void clearCache();
+	//! Returns the manifold on which the metric is defined
+	Manifold* getManifold();
+	//! Returns the coordinate system in which the metric is expressed
+	int getCoordSystem();
 };
 
 /*! \class Manifold
@@ -323,6 +412,10 @@ public:
 	 *  \return Pointer to the metric expressed in the chosen system
 	 */
 	Metric* getMetric(int i);
+	//! Returns the number of the coordinate systems
+	int getNCoordSystems();
+	//! Removes the cached values of all metrics
+	void clearCaches();
 	//! Convert a point to another coordinate system
 	/*! \param p The point to be converted
 	 *  \param system The target coordinate system
@@ -336,12 +429,40 @@ public:
 	 *  \return Converted vector
 	 */
 	vector4 convertVectorTo(vector4 v, Point p, int system);	//convert vector to coordinates
+	//! Compares points which can be expressed in different coordinate systems
+	/*! \return true if q converted to the coordinate system of p has the same coordinates as p
+	 */
+	bool isSamePoint(Point p, Point q);
 	
 	//! Get the best coordinate system to use at a point
 	/*! \param p The point
 	 *  \return The recommended coordinate system to be used
 	 */
 	virtual int recommendCoordSystem(Point p);
+	
+	//! Create an independent copy of the manifold
+	/*! The copy has its own metric objects (and their caches), so it can be used in another thread.
+	 *  The caller takes the ownership of the copy.
+	 *  \return Pointer to the copy, or NULL if the manifold cannot be copied (default implementation)
+	 */
+	virtual Manifold* clone();
+	
+	//! Returns the number of the parameters of the manifold (e.g. mass), default implementation - 0
+	virtual int getNParameters();
+	//! Returns a parameter of the manifold
+	/*! \param i Number of the parameter (< getNParameters())
+	 */
+	virtual double getParameter(int i);
+	//! Sets a parameter of the manifold and removes the cached values of the metrics if it changes
+	/*! \param i Number of the parameter (< getNParameters())
+	 *  \param value The new value
+	 */
+	virtual void setParameter(int i, double value);
+	
+	//! Serializes the parameters of the manifold (default implementation - none)
+	virtual void saveState(StateWriter&);
+	//! Restores the parameters of the manifold and clears the caches of the metrics
+	virtual void loadState(StateReader&);
 };
 
 #endif
@@ -0,0 +1,292 @@
+#include "initconds.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <algorithm>
+
+static_assert(sizeof(InitialConditionsHeader) == 88, "InitialConditionsHeader must have no padding");
+
+/*******************************************************************************
+ *
+ *  InitialConditionsWriter class implementation
+ *
+ *******************************************************************************/
+
+InitialConditionsWriter::InitialConditionsWriter(const char* _filename)
+	: filename(_filename)
+{
+}
+
+InitialConditionsWriter::~InitialConditionsWriter()
+{
+}
+
+void InitialConditionsWriter::add(Point p, vector4 v)
+{
+	charts.push_back(p.getCoordSystem());
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		x[i].push_back(p[i]);
+		u[i].push_back(v[i]);
+	}
+}
+
+bool InitialConditionsWriter::close()
+{
+	uint64_t n = charts.size();
+	InitialConditionsHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "GRIC", 4);
+	header.version = 1;
+	header.nRecords = n;
+
+	//the columns of doubles start at multiples of 8 bytes
+	uint64_t chartBytes = (n*sizeof(int32_t) + 7) & ~(uint64_t)7;
+	header.chartOffset = sizeof(header);
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		header.xOffset[i] = sizeof(header) + chartBytes + i*n*sizeof(double);
+		header.uOffset[i] = sizeof(header) + chartBytes + (4 + i)*n*sizeof(double);
+	}
+
+	FILE* f = fopen(filename.c_str(), "wb");
+	if(!f) return false;
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	if(n)
+	{
+		int32_t zero = 0;
+		ok = ok && fwrite(&charts[0], sizeof(int32_t), n, f) == n;
+		if(chartBytes > n*sizeof(int32_t)) ok = ok && fwrite(&zero, sizeof(zero), 1, f) == 1;
+		for(i = 0; i < 4; i++)
+			ok = ok && fwrite(&x[i][0], sizeof(double), n, f) == n;
+		for(i = 0; i < 4; i++)
+			ok = ok && fwrite(&u[i][0], sizeof(double), n, f) == n;
+	}
+	ok = (fclose(f) == 0) && ok;
+	return ok;
+}
+
+uint64_t InitialConditionsWriter::getNRecords()
+{
+	return charts.size();
+}
+
+/*******************************************************************************
+ *
+ *  InitialConditionsReader class implementation
+ *
+ *******************************************************************************/
+
+InitialConditionsReader::InitialConditionsReader()
+{
+	fd = -1;
+	data = NULL;
+	fileSize = 0;
+	header = NULL;
+	charts = NULL;
+	int i;
+	for(i = 0; i < 4; i++)
+		x[i] = u[i] = NULL;
+}
+
+InitialConditionsReader::~InitialConditionsReader()
+{
+	close();
+}
+
+bool InitialConditionsReader::open(const char* filename)
+{
+	close();
+
+	fd = ::open(filename, O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(InitialConditionsHeader))
+	{
+		close();
+		return false;
+	}
+	fileSize = st.st_size;
+
+	void* p = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	if(p == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	data = (const char*)p;
+
+	header = (const InitialConditionsHeader*)data;
+	uint64_t n = header->nRecords;
+	bool ok = memcmp(header->magic, "GRIC", 4) == 0 && header->version == 1 && n <= fileSize/(sizeof(int32_t) + 8*sizeof(double));
+	ok = ok && header->chartOffset % sizeof(int32_t) == 0 && header->chartOffset <= fileSize &&
+		n*sizeof(int32_t) <= fileSize - header->chartOffset;
+	int i;
+	for(i = 0; i < 4 && ok; i++)
+	{
+		ok = header->xOffset[i] % sizeof(double) == 0 && header->xOffset[i] <= fileSize && n*sizeof(double) <= fileSize - header->xOffset[i];
+		ok = ok && header->uOffset[i] % sizeof(double) == 0 && header->uOffset[i] <= fileSize && n*sizeof(double) <= fileSize - header->uOffset[i];
+	}
+	if(!ok)
+	{
+		close();
+		return false;
+	}
+
+	charts = (const int32_t*)(data + header->chartOffset);
+	for(i = 0; i < 4; i++)
+	{
+		x[i] = (const double*)(data + header->xOffset[i]);
+		u[i] = (const double*)(data + header->uOffset[i]);
+	}
+	//the columns are read sequentially
+	madvise((void*)data, fileSize, MADV_SEQUENTIAL);
+	return true;
+}
+
+void InitialConditionsReader::close()
+{
+	if(data) munmap((void*)data, fileSize);
+	if(fd >= 0) ::close(fd);
+	fd = -1;
+	data = NULL;
+	fileSize = 0;
+	header = NULL;
+	charts = NULL;
+	int i;
+	for(i = 0; i < 4; i++)
+		x[i] = u[i] = NULL;
+}
+
+uint64_t InitialConditionsReader::getNRecords()
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	return header->nRecords;
+}
+
+const int32_t* InitialConditionsReader::getCharts()
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	return charts;
+}
+
+const double* InitialConditionsReader::getCoords(int i)
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	if(i < 0 || i > 3) throw "InitialConditionsReader: Invalid coordinate.";
+	return x[i];
+}
+
+const double* InitialConditionsReader::getVelComponents(int i)
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	if(i < 0 || i > 3) throw "InitialConditionsReader: Invalid component.";
+	return u[i];
+}
+
+Point InitialConditionsReader::getPos(uint64_t i)
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	if(i >= header->nRecords) throw "InitialConditionsReader: Invalid record.";
+	return Point(charts[i], x[0][i], x[1][i], x[2][i], x[3][i]);
+}
+
+vector4 InitialConditionsReader::getVel(uint64_t i)
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	if(i >= header->nRecords) throw "InitialConditionsReader: Invalid record.";
+	return vector4(u[0][i], u[1][i], u[2][i], u[3][i]);
+}
+
+void InitialConditionsReader::createParticles(Manifold* m, std::vector<Particle>& particles, uint64_t first, int64_t count)
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	if(first > header->nRecords) throw "InitialConditionsReader: Invalid record.";
+	uint64_t last = header->nRecords;
+	if(count >= 0 && first + count < last) last = first + count;
+
+	particles.reserve(particles.size() + (last - first));
+	uint64_t i;
+	for(i = first; i < last; i++)
+		particles.push_back(Particle(m, Point(charts[i], x[0][i], x[1][i], x[2][i], x[3][i]), vector4(u[0][i], u[1][i], u[2][i], u[3][i])));
+}
+
+void InitialConditionsReader::validateRange(Manifold* m, double norm, double tolerance, uint64_t first, uint64_t last,
+	std::vector<uint64_t>* invalid, double* maxDeviation)
+{
+	int nCharts = m->getNCoordSystems();
+	uint64_t i;
+	int j;
+	for(i = first; i < last; i++)
+	{
+		bool ok = charts[i] >= 0 && charts[i] < nCharts;
+		for(j = 0; j < 4; j++)
+			ok = ok && isfinite(x[j][i]) && isfinite(u[j][i]);
+		if(ok)
+		{
+			Point p(charts[i], x[0][i], x[1][i], x[2][i], x[3][i]);
+			vector4 v(u[0][i], u[1][i], u[2][i], u[3][i]);
+			double dev = fabs(m->getMetric(charts[i])->g(v, v, p) - norm);
+			if(dev > *maxDeviation || dev != dev) *maxDeviation = dev;
+			ok = dev <= tolerance;
+		}
+		if(!ok) invalid->push_back(i);
+	}
+}
+
+uint64_t InitialConditionsReader::validate(Manifold* m, double norm, double tolerance, int threads, std::vector<uint64_t>* invalid,
+	double* maxDeviation)
+{
+	if(!header) throw "InitialConditionsReader: No file.";
+	uint64_t n = header->nRecords;
+
+	int nThreads = threads;
+	if(nThreads <= 0) nThreads = std::thread::hardware_concurrency();
+	if((uint64_t)nThreads > n) nThreads = n;
+	if(nThreads < 1) nThreads = 1;
+
+	//every thread needs its own manifold - the metrics cache their values
+	std::vector<Manifold*> copies;
+	copies.push_back(m);
+	int i;
+	for(i = 1; i < nThreads; i++)
+	{
+		Manifold* c = m->clone();
+		if(!c) break;
+		copies.push_back(c);
+	}
+	nThreads = copies.size();
+
+	//contiguous ranges, so that the invalid records stay sorted when the results are joined
+	std::vector<std::vector<uint64_t> > results(nThreads);
+	std::vector<double> deviations(nThreads, 0.0);
+	std::vector<std::thread> workers;
+	for(i = 1; i < nThreads; i++)
+		workers.push_back(std::thread(&InitialConditionsReader::validateRange, this, copies[i], norm, tolerance,
+			n*i/nThreads, n*(i + 1)/nThreads, &results[i], &deviations[i]));
+	validateRange(m, norm, tolerance, 0, n/nThreads, &results[0], &deviations[0]);
+	for(i = 1; i < nThreads; i++)
+	{
+		workers[i - 1].join();
+		delete copies[i];
+	}
+
+	uint64_t count = 0;
+	double dev = 0.0;
+	for(i = 0; i < nThreads; i++)
+	{
+		count += results[i].size();
+		if(invalid) invalid->insert(invalid->end(), results[i].begin(), results[i].end());
+		if(deviations[i] > dev || deviations[i] != deviations[i]) dev = deviations[i];
+	}
+	if(maxDeviation) *maxDeviation = dev;
+	return count;
+}
@@ -0,0 +1,139 @@
+#ifndef __INITCONDS_H__
+#define __INITCONDS_H__
+
+/*! \file initconds.h
+ * \brief Columnar binary files of initial conditions for large ensembles of particles
+ *
+ * The file consists of a header (InitialConditionsHeader) and nine columns with one value per particle: the coordinate systems
+ * (int32, padded to a multiple of 8 bytes), the four coordinates and the four components of the 4-velocity (double). The header
+ * contains the offsets of the columns in the file. All values are stored in the native byte order.
+ */
+
+#include "particle.h"
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+/*! \struct InitialConditionsHeader
+ * \brief The header of an initial conditions file
+ */
+struct InitialConditionsHeader
+{
+	char magic[4];			///< "GRIC"
+	uint32_t version;		///< Format version (1)
+	uint64_t nRecords;		///< Number of the particles
+	uint64_t chartOffset;	///< Position of the column of the coordinate systems
+	uint64_t xOffset[4];	///< Positions of the columns of the coordinates
+	uint64_t uOffset[4];	///< Positions of the columns of the 4-velocity components
+};
+
+/*! \class InitialConditionsWriter
+ * \brief Writer of initial conditions files
+ *
+ * The columns are collected in memory (72 bytes per particle) and written by \a close.
+ */
+class InitialConditionsWriter
+{
+	std::string filename;
+	std::vector<int32_t> charts;
+	std::vector<double> x[4];
+	std::vector<double> u[4];
+
+	InitialConditionsWriter(const InitialConditionsWriter&);
+	InitialConditionsWriter& operator=(const InitialConditionsWriter&);
+public:
+	//! Constructor
+	/*! \param _filename Name of the file (created by \a close)
+	 */
+	InitialConditionsWriter(const char* _filename);
+	//! Destructor - does not write the file
+	~InitialConditionsWriter();
+
+	//! Adds a particle
+	void add(Point p, vector4 u);
+	//! Writes the file
+	/*! \return true if the file was written successfully
+	 */
+	bool close();
+
+	//! Returns the number of the particles added so far
+	uint64_t getNRecords();
+};
+
+/*! \class InitialConditionsReader
+ * \brief Memory-mapped reader of initial conditions files
+ *
+ * The columns are read in place - \a getCharts, \a getCoords and \a getVelComponents give the structure-of-arrays view of the whole
+ * ensemble without copying or parsing anything. \a createParticles constructs the particles directly from the columns.
+ */
+class InitialConditionsReader
+{
+	int fd;
+	const char* data;
+	uint64_t fileSize;
+	const InitialConditionsHeader* header;
+	const int32_t* charts;
+	const double* x[4];
+	const double* u[4];
+
+	//! Validation of a part of the records (run in the threads of \a validate)
+	void validateRange(Manifold* m, double norm, double tolerance, uint64_t first, uint64_t last, std::vector<uint64_t>* invalid,
+		double* maxDeviation);
+
+	InitialConditionsReader(const InitialConditionsReader&);
+	InitialConditionsReader& operator=(const InitialConditionsReader&);
+public:
+	//! Constructor
+	InitialConditionsReader();
+	//! Destructor - closes the file
+	~InitialConditionsReader();
+
+	//! Opens a file
+	/*! \return false if the file cannot be mapped or is not a valid initial conditions file
+	 */
+	bool open(const char* filename);
+	//! Closes the file
+	void close();
+
+	//! Returns the number of the particles
+	uint64_t getNRecords();
+	//! Returns the column of the coordinate systems
+	const int32_t* getCharts();
+	//! Returns the column of a coordinate
+	/*! \param i Number of the coordinate
+	 */
+	const double* getCoords(int i);
+	//! Returns the column of a component of the 4-velocity
+	/*! \param i Number of the component
+	 */
+	const double* getVelComponents(int i);
+
+	//! Returns the position of a particle
+	Point getPos(uint64_t i);
+	//! Returns the 4-velocity of a particle
+	vector4 getVel(uint64_t i);
+
+	//! Constructs the particles
+	/*! \param m The manifold of the particles
+	 *  \param particles The vector to which the particles are appended
+	 *  \param first Number of the first particle
+	 *  \param count Number of the particles (-1 - all remaining)
+	 */
+	void createParticles(Manifold* m, std::vector<Particle>& particles, uint64_t first = 0, int64_t count = -1);
+
+	//! Checks the normalization of the 4-velocities
+	/*! Every thread uses its own copy of the manifold (Manifold::clone) - if the manifold cannot be copied, the check runs in
+	 *  a single thread. Records with an invalid coordinate system or non-finite values are invalid too.
+	 *  \param m The manifold of the particles
+	 *  \param norm The expected value of g(u,u) (1 for massive particles, 0 for photons)
+	 *  \param tolerance Largest accepted |g(u,u) - norm|
+	 *  \param threads Number of the threads (0 - the number of the hardware threads)
+	 *  \param invalid If not NULL, the numbers of the invalid records are stored here, in ascending order
+	 *  \param maxDeviation If not NULL, the largest |g(u,u) - norm| of the valid coordinate systems is stored here
+	 *  \return Number of the invalid records
+	 */
+	uint64_t validate(Manifold* m, double norm, double tolerance, int threads = 0, std::vector<uint64_t>* invalid = NULL,
+		double* maxDeviation = NULL);
+};
+
+#endif
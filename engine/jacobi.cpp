@@ -0,0 +1,177 @@
+#include "jacobi.h"
+#include <math.h>
+
+JacobiParticle::JacobiParticle(Manifold* _m, Point _p, vector4 _k, vector4 observer)
+	: TransportParticle(_m, _p, _k)
+{
+	Metric* g = m->getMetric(p.getCoordSystem());
+	double w = g->g(_k, observer, p);
+	if(w == 0.0) throw "JacobiParticle: The wave vector is orthogonal to the observer.";
+
+	//the screen - the coordinate directions orthogonal to the observer and the direction of the ray, the longest ones first
+	vector4 uo = observer/sqrt(g->g(observer, observer, p));
+	w = g->g(_k, uo, p);
+	vector4 d = _k/w - uo;
+	vector4 c[3], e[2];
+	double len[3];
+	int i, j, A;
+	for(i = 0; i < 3; i++)
+	{
+		c[i] = vector4(0.0, 0.0, 0.0, 0.0);
+		c[i][i + 1] = 1.0;
+	}
+	for(A = 0; A < 2; A++)
+	{
+		int best = -1;
+		for(i = 0; i < 3; i++)
+		{
+			c[i] -= g->g(c[i], uo, p)*uo;
+			c[i] += g->g(c[i], d, p)*d;
+			for(j = 0; j < A; j++)
+				c[i] += g->g(c[i], e[j], p)*e[j];
+			len[i] = -g->g(c[i], c[i], p);
+			if(best < 0 || len[i] > len[best]) best = i;
+		}
+		e[A] = c[best]/sqrt(len[best]);
+		addVector(e[A]);
+	}
+
+	double zero[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } }, id[2][2] = { { 1.0, 0.0 }, { 0.0, 1.0 } };
+	setJacobi(zero, id);
+}
+
+JacobiParticle::~JacobiParticle()
+{
+}
+
+void JacobiParticle::setJacobi(double _D[2][2], double _dD[2][2])
+{
+	int A, B;
+	for(A = 0; A < 2; A++)
+		for(B = 0; B < 2; B++)
+		{
+			D[A][B] = _D[A][B];
+			dD[A][B] = _dD[A][B];
+		}
+}
+
+double JacobiParticle::getJacobi(int A, int B)
+{
+	if(A < 0 || A >= 2 || B < 0 || B >= 2) throw "JacobiParticle: Index out of bounds.";
+	return D[A][B];
+}
+
+double JacobiParticle::getJacobiDerivative(int A, int B)
+{
+	if(A < 0 || A >= 2 || B < 0 || B >= 2) throw "JacobiParticle: Index out of bounds.";
+	return dD[A][B];
+}
+
+vector4 JacobiParticle::getScreenVector(int A)
+{
+	if(A < 0 || A >= 2) throw "JacobiParticle: Index out of bounds.";
+	return getVector(A);
+}
+
+double JacobiParticle::getDeterminant()
+{
+	return D[0][0]*D[1][1] - D[0][1]*D[1][0];
+}
+
+double JacobiParticle::getAreaDistance()
+{
+	return sqrt(fabs(getDeterminant()));
+}
+
+double JacobiParticle::getMagnification()
+{
+	return tau*tau/fabs(getDeterminant());
+}
+
+double JacobiParticle::getShear()
+{
+	//s1^2 + s2^2 = |D|^2 (Frobenius), s1 s2 = |det D|
+	double f = D[0][0]*D[0][0] + D[0][1]*D[0][1] + D[1][0]*D[1][0] + D[1][1]*D[1][1];
+	double det = fabs(getDeterminant());
+	double sum = sqrt(f + 2*det), diff = sqrt(fabs(f - 2*det));
+	return (sum > 0.0) ? diff/sum : 0.0;
+}
+
+StateVector JacobiParticle::constructState()
+{
+	StateVector v = TransportParticle::constructState();
+	int A, B;
+	for(A = 0; A < 2; A++)
+		for(B = 0; B < 2; B++)
+			v.push_back(D[A][B]);
+	for(A = 0; A < 2; A++)
+		for(B = 0; B < 2; B++)
+			v.push_back(dD[A][B]);
+	return v;
+}
+
+void JacobiParticle::setState(StateVector v)
+{
+	TransportParticle::setState(v);
+	int base = 8 + 4*getNVectors();
+	int A, B;
+	for(A = 0; A < 2; A++)
+		for(B = 0; B < 2; B++)
+		{
+			D[A][B] = v[base + 2*A + B];
+			dD[A][B] = v[base + 4 + 2*A + B];
+		}
+}
+
+StateVector JacobiParticle::derivative(StateVector v)
+{
+	StateVector result = TransportParticle::derivative(v);
+	Point p1 = getPosFromState(v);
+	vector4 k = getVelFromState(v);
+	Metric* g = m->getMetric(p.getCoordSystem());
+	int base = 8 + 4*getNVectors();
+	int i, l, A, B, C;
+
+	vector4 e[2];
+	for(A = 0; A < 2; A++)
+		for(i = 0; i < 4; i++)
+			e[A][i] = v[8 + 4*A + i];
+
+	//the optical tidal matrix T_AB = E_A . R(k, E_B) k
+	double K[4][4], T[2][2];
+	g->tidal(p1, k, K);
+	for(B = 0; B < 2; B++)
+	{
+		vector4 x;
+		for(i = 0; i < 4; i++)
+			for(l = 0; l < 4; l++)
+				x[i] += K[i][l]*e[B][l];
+		for(A = 0; A < 2; A++)
+			T[A][B] = g->g(e[A], x, p1);
+	}
+
+	for(A = 0; A < 2; A++)
+		for(B = 0; B < 2; B++)
+		{
+			double d2 = 0.0;
+			for(C = 0; C < 2; C++)
+				d2 += T[A][C]*v[base + 2*C + B];
+			result[base + 2*A + B] = v[base + 4 + 2*A + B];
+			result[base + 4 + 2*A + B] = d2;
+		}
+	return result;
+}
+
+void JacobiParticle::saveState(StateWriter& w)
+{
+	TransportParticle::saveState(w);
+	w.putDoubles(D[0], 4);
+	w.putDoubles(dD[0], 4);
+}
+
+void JacobiParticle::loadState(StateReader& r)
+{
+	TransportParticle::loadState(r);
+	r.getDoubles(D[0], 4);
+	r.getDoubles(dD[0], 4);
+}
@@ -0,0 +1,76 @@
+#ifndef __JACOBI_H__
+#define __JACOBI_H__
+
+/*! \file jacobi.h
+ * \brief Header for the JacobiParticle class - a light ray carrying the Jacobi matrix of the infinitesimal bundle around it.
+ */
+
+#include "transport.h"
+
+/*! \class JacobiParticle
+ * \brief Light ray integrating the geodesic deviation equation of the bundle of rays around it
+ *
+ * The ray carries a screen - two unit vectors orthogonal to the ray and to the 4-velocity of the observer, parallel transported
+ * (they are the vectors 0 and 1 of TransportParticle and must not be removed). The separation of a neighbouring ray projected
+ * on the screen is xi = D xi'(0) + ..., and the 2x2 Jacobi matrix D satisfies
+ *
+ * D'' = T D, T_AB = E_A . R(k, E_B) k
+ *
+ * where R is the Riemann tensor (Metric::tidal). A single ray gives the area distance, the magnification and the shear of the
+ * image, instead of differences of 3-5 neighbouring rays. Initially D = 0 and D' = 1 - the bundle has its vertex at the
+ * observer. The Jacobi matrix does not take part in the error control of adaptive integrators (errorNorm).
+ */
+class JacobiParticle : public TransportParticle
+{
+	double D[2][2];		///< The Jacobi matrix
+	double dD[2][2];	///< The derivative of the Jacobi matrix
+
+	JacobiParticle(const JacobiParticle&);
+	JacobiParticle& operator=(const JacobiParticle&);
+protected:
+	//! Constructs a state vector from the internal state.
+	StateVector constructState();
+	//! Sets the internal state to a state represented by a StateVector.
+	void setState(StateVector);
+public:
+	//! Constructor
+	/*! \param _m The manifold on which the ray is defined
+	 *  \param _p The position of the observer
+	 *  \param _k The wave vector - with k.u = 1 the affine parameter near the observer is the distance
+	 *  \param observer The 4-velocity of the observer, defining the screen
+	 */
+	JacobiParticle(Manifold* _m, Point _p, vector4 _k, vector4 observer);
+	//! Destructor
+	~JacobiParticle();
+
+	//! Sets the Jacobi matrix and its derivative (e.g. D = 1, D' = 0 for a parallel bundle)
+	void setJacobi(double _D[2][2], double _dD[2][2]);
+	//! Returns an element of the Jacobi matrix
+	double getJacobi(int A, int B);
+	//! Returns an element of the derivative of the Jacobi matrix
+	double getJacobiDerivative(int A, int B);
+	//! Returns a screen vector (0 or 1, in the current coordinate system)
+	vector4 getScreenVector(int A);
+
+	//! Returns the determinant of the Jacobi matrix - negative after an odd number of caustics
+	double getDeterminant();
+	//! Returns the area distance - sqrt(|det D|)
+	double getAreaDistance();
+	//! Returns the magnification relative to flat space at the same affine distance - tau^2/|det D|
+	double getMagnification();
+	//! Returns the shear of the image - (s1 - s2)/(s1 + s2), where s1 >= s2 are the singular values of D
+	double getShear();
+
+	//! Overloaded method from \a DiffEq
+	/*! \param v Current state
+	 *  \return The derivative of the current state as given by the geodesic, parallel transport and geodesic deviation equations.
+	 */
+	StateVector derivative(StateVector v);
+
+	//! Serializes the state of the ray (the state of TransportParticle and the Jacobi matrix)
+	void saveState(StateWriter&);
+	//! Restores the state of the ray
+	void loadState(StateReader&);
+};
+
+#endif
@@ -6,9 +6,6 @@ KerrManifold::KerrManifold(double _M, double _a)
 	M = _M;
 	a = _a;
 	
-	gManifold = this;
-	Point::setGlobalManifold(this);
-	
 	nCoordSystems = 3;
 	
 	metrics = new Metric*[nCoordSystems];
@@ -62,12 +59,31 @@ double KerrManifold::getAngMomentum()
 
 void KerrManifold::setMass(double _M)
 {
+	if(_M == M) return;
 	M = _M;
+	clearCaches();
 }
 
 void KerrManifold::setAngMomentum(double _a)
 {
+	if(_a == a) return;
 	a = _a;
+	clearCaches();
+}
+
+double KerrManifold::getHorizonRadius()
+{
+	if(a*a > M*M) return 0.0;
+	return M + sqrt(M*M - a*a);
+}
+
+double KerrManifold::getISCORadius()
+{
+	double x = a/M;
+	double z1 = 1.0 + cbrt(1.0 - x*x)*(cbrt(1.0 + x) + cbrt(1.0 - x));
+	double z2 = sqrt(3*x*x + z1*z1);
+	double s = (x > 0.0) ? 1.0 : ((x < 0.0) ? -1.0 : 0.0);
+	return M*(3.0 + z2 - s*sqrt((3.0 - z1)*(3.0 + z1 + 2*z2)));
 }
 	
 int KerrManifold::recommendCoordSystem(Point p)
@@ -89,12 +105,63 @@ int KerrManifold::recommendCoordSystem(Point p)
 	}
 }
 
+KerrManifold* KerrManifold::clone()
+{
+	return new KerrManifold(M, a);
+}
+
+int KerrManifold::getNParameters()
+{
+	return 2;
+}
+
+double KerrManifold::getParameter(int i)
+{
+	switch(i)
+	{
+	case 0:
+		return M;
+	case 1:
+		return a;
+	default:
+		throw "KerrManifold: Index out of bounds.";
+	}
+}
+
+void KerrManifold::setParameter(int i, double value)
+{
+	switch(i)
+	{
+	case 0:
+		setMass(value);
+		break;
+	case 1:
+		setAngMomentum(value);
+		break;
+	default:
+		throw "KerrManifold: Index out of bounds.";
+	}
+}
+
+void KerrManifold::saveState(StateWriter& w)
+{
+	w.putDouble(M);
+	w.putDouble(a);
+}
+
+void KerrManifold::loadState(StateReader& r)
+{
+	M = r.getDouble();
+	a = r.getDouble();
+	clearCaches();
+}
+
 /*
  * Metric in Eddington-Finkelstein coordinates
  */
  
 KerrEFMetric::KerrEFMetric(int cS, KerrManifold* _m)
-	: Metric(cS)
+	: Metric(cS, _m)
 { 
 	m = _m;
 }
@@ -103,6 +170,49 @@ KerrEFMetric::~KerrEFMetric()
 { 
 }
 
+bool KerrEFMetric::isIgnorable(int i)
+{
+	return i == coordU || i == coordPhi;
+}
+
+void KerrEFMetric::principalDirections(Point p, double& re, double& im, vector4& l, vector4& n)
+{
+	Point pos = m->convertPointTo(p, coordSystem);
+	double M,a;
+	M = m->getMass();
+	a = m->getAngMomentum();
+	
+	double r = pos[coordR];
+	double t = pos[coordTheta];
+	
+	double c = a*cos(t);
+	double rho2 = r*r + c*c;
+	double rho6 = rho2*rho2*rho2;
+	double delta = r*r-2*M*r+a*a;
+	
+	//Psi = M/(r - i a cos(theta))^3, the principal null directions are regular on the horizon
+	re = M*r*(r*r - 3*c*c)/rho6;
+	im = M*c*(3*r*r - c*c)/rho6;
+	l = vector4(2*(r*r+a*a)/rho2, delta/rho2, 0.0, 2*a/rho2);
+	n = vector4(0.0, -1.0, 0.0, 0.0);
+}
+
+void KerrEFMetric::_riemann(Point p, double R[4][4][4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDRiemann(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), R);
+}
+
+void KerrEFMetric::_tidal(Point p, vector4 u, double K[4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDTidal(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), u, K);
+}
+
 double KerrEFMetric::_g(int i, int j, Point p)
 {
 	Point pos = m->convertPointTo(p, coordSystem);
@@ -258,7 +368,7 @@ double KerrEFMetric::_christoffel(int i, int j, int k, Point p)
  */
  
 KerrNearPoleMetric::KerrNearPoleMetric(int cS, KerrManifold* _m)
-	: Metric(cS)
+	: Metric(cS, _m)
 {
 	m = _m;
 }
@@ -267,6 +377,50 @@ KerrNearPoleMetric::~KerrNearPoleMetric()
 {
 }
 
+bool KerrNearPoleMetric::isIgnorable(int i)
+{
+	return i == coordU;
+}
+
+void KerrNearPoleMetric::principalDirections(Point p, double& re, double& im, vector4& l, vector4& n)
+{
+	Point pos = m->convertPointTo(p, coordSystem);
+	double M,a;
+	M = m->getMass();
+	a = m->getAngMomentum();
+	
+	double r = pos[coordR];
+	double x = pos[coordX];
+	double y = pos[coordY];
+	
+	double c = a*(1.0-x*x-y*y)/(1.0+x*x+y*y);
+	double rho2 = r*r + c*c;
+	double rho6 = rho2*rho2*rho2;
+	double delta = r*r-2*M*r+a*a;
+	
+	//as in EF coordinates, with d/dphi = -y d/dx + x d/dy
+	re = M*r*(r*r - 3*c*c)/rho6;
+	im = M*c*(3*r*r - c*c)/rho6;
+	l = vector4(2*(r*r+a*a)/rho2, delta/rho2, -2*a*y/rho2, 2*a*x/rho2);
+	n = vector4(0.0, -1.0, 0.0, 0.0);
+}
+
+void KerrNearPoleMetric::_riemann(Point p, double R[4][4][4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDRiemann(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), R);
+}
+
+void KerrNearPoleMetric::_tidal(Point p, vector4 u, double K[4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDTidal(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), u, K);
+}
+
 double KerrNearPoleMetric::_g(int i, int j, Point p)
 {
 	Point pos = m->convertPointTo(p, coordSystem);
@@ -20,10 +20,30 @@ public:
 	
 	double getMass();
 	double getAngMomentum();
+	//! Sets the mass - the cached values of the metrics are removed if it changes
 	void setMass(double _M);
+	//! Sets the angular momentum per unit mass - the cached values of the metrics are removed if it changes
 	void setAngMomentum(double _a);
 	
+	//! Returns the radius of the outer event horizon
+	/*! \return M + sqrt(M^2 - a^2), or 0 if a > M (no horizon)
+	 */
+	double getHorizonRadius();
+	//! Returns the radius of the innermost stable circular orbit in the equatorial plane
+	/*! \return The prograde ISCO radius for a > 0, the retrograde one for a < 0
+	 */
+	double getISCORadius();
+	
 	int recommendCoordSystem(Point);
+	KerrManifold* clone();
+	
+	//! Returns 2 - the parameters are the mass (0) and the angular momentum per unit mass (1)
+	int getNParameters();
+	double getParameter(int i);
+	void setParameter(int i, double value);
+	
+	void saveState(StateWriter&);
+	void loadState(StateReader&);
 };
 
 /*! \class KerrEFMetric
@@ -36,12 +56,21 @@ protected:
 	double _g(int, int, Point);
 	double _invg(int, int, Point);
 	double _christoffel(int, int, int, Point);
+	//! The analytic Riemann tensor (Metric::typeDRiemann)
+	void _riemann(Point, double R[4][4][4][4]);
+	//! The analytic tidal tensor (Metric::typeDTidal)
+	void _tidal(Point, vector4, double K[4][4]);
+	//! The scalar Psi of the Weyl tensor and the principal null directions (Metric::typeDRiemann)
+	void principalDirections(Point, double& re, double& im, vector4& l, vector4& n);
 	
 public:
 	enum { coordU = 0, coordR = 1, coordTheta = 2, coordPhi = 3 };
 	
 	KerrEFMetric(int cS, KerrManifold* _m);
 	~KerrEFMetric();
+	
+	//! The metric does not depend on u and phi
+	bool isIgnorable(int i);
 };
 
 /*! \class KerrNearPoleMetric
@@ -54,12 +83,21 @@ protected:
 	double _g(int, int, Point);
 	double _invg(int, int, Point);
 	double _christoffel(int, int, int, Point);
+	//! The analytic Riemann tensor (Metric::typeDRiemann)
+	void _riemann(Point, double R[4][4][4][4]);
+	//! The analytic tidal tensor (Metric::typeDTidal)
+	void _tidal(Point, vector4, double K[4][4]);
+	//! The scalar Psi of the Weyl tensor and the principal null directions (Metric::typeDRiemann)
+	void principalDirections(Point, double& re, double& im, vector4& l, vector4& n);
 	
 public:
 	enum { coordU = 0, coordR = 1, coordX = 2, coordY = 3 };
 	
 	KerrNearPoleMetric(int cS, KerrManifold* _m);
 	~KerrNearPoleMetric();
+	
+	//! The metric does not depend on u
+	bool isIgnorable(int i);
 };
 
 #endif
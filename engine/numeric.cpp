@@ -1,4 +1,5 @@
 #include "numeric.h"
+#include "profiler.h"
 #include <math.h>
 
 StateLengthError::StateLengthError()
@@ -24,6 +25,7 @@ const char* StateLengthError::what() const throw()
  
 StateVector operator+(const StateVector& arg1, const StateVector& arg2)
 {
+	GR_PROFILE_SCOPE(Arithmetic);
 	if(arg1.size() != arg2.size())
 		throw StateLengthError();
 		
@@ -37,6 +39,7 @@ StateVector operator+(const StateVector& arg1, const StateVector& arg2)
 
 StateVector operator-(const StateVector& arg1, const StateVector& arg2)
 {
+	GR_PROFILE_SCOPE(Arithmetic);
 	if(arg1.size() != arg2.size())
 		throw StateLengthError();
 		
@@ -50,6 +53,7 @@ StateVector operator-(const StateVector& arg1, const StateVector& arg2)
 
 StateVector operator*(const StateVector& arg1, double arg2)
 {	
+	GR_PROFILE_SCOPE(Arithmetic);
 	unsigned i;
 	StateVector result;
 	for(i = 0; i < arg1.size(); i++)
@@ -60,6 +64,7 @@ StateVector operator*(const StateVector& arg1, double arg2)
 
 StateVector operator*(double arg, const StateVector& arg2)
 {	
+	GR_PROFILE_SCOPE(Arithmetic);
 	unsigned i;
 	StateVector result;
 	for(i = 0; i < arg2.size(); i++)
@@ -70,6 +75,7 @@ StateVector operator*(double arg, const StateVector& arg2)
 
 StateVector operator/(const StateVector& arg1, double arg2)
 {	
+	GR_PROFILE_SCOPE(Arithmetic);
 	unsigned i;
 	StateVector result;
 	for(i = 0; i < arg1.size(); i++)
@@ -102,6 +108,28 @@ DiffEq::~DiffEq()
 {
 }
 
+double DiffEq::errorNorm(StateVector error)
+{
+	return abs(error);
+}
+
+void DiffEq::jacobian(StateVector v, std::vector<double>& J)
+{
+	unsigned int n = v.size(), i, j;
+	J.resize(n*n);
+	StateVector f0 = derivative(v);
+	for(j = 0; j < n; j++)
+	{
+		//about the square root of the machine epsilon
+		double h = 1.5e-8*(1.0 + fabs(v[j]));
+		StateVector v1 = v;
+		v1[j] += h;
+		StateVector f1 = derivative(v1);
+		for(i = 0; i < n; i++)
+			J[n*i + j] = (f1[i] - f0[i])/h;
+	}
+}
+
 /*******************************************************************************
  *
  *  Integrator class implementation
@@ -112,6 +140,9 @@ Integrator::Integrator(double stepSize)
 {
 	this->stepSize = stepSize;
 	initStepSize = stepSize;
+	lastStep = 0.0;
+	lastError = 0.0;
+	lastRejections = 0;
 }
 
 Integrator::~Integrator()
@@ -133,3 +164,45 @@ double Integrator::getStepSize()
 	return stepSize;
 }
 
+double Integrator::getLastStep()
+{
+	return lastStep;
+}
+
+double Integrator::getLastError()
+{
+	return lastError;
+}
+
+int Integrator::getLastRejections()
+{
+	return lastRejections;
+}
+
+DiffEq* Integrator::getLastEquation()
+{
+	return NULL;
+}
+
+void Integrator::setLastEquation(DiffEq*)
+{
+}
+
+void Integrator::saveState(StateWriter& w)
+{
+	w.putDouble(stepSize);
+	w.putDouble(initStepSize);
+	w.putDouble(lastStep);
+	w.putDouble(lastError);
+	w.putInt(lastRejections);
+}
+
+void Integrator::loadState(StateReader& r)
+{
+	stepSize = r.getDouble();
+	initStepSize = r.getDouble();
+	lastStep = r.getDouble();
+	lastError = r.getDouble();
+	lastRejections = r.getInt();
+}
+
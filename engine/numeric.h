@@ -10,6 +10,8 @@
 #include <vector>
 #include <exception>
 
+#include "serialize.h"
+
 /*! \class StateLengthError
  * \brief An exception class thrown when there is a state vector length mismatch
  */
@@ -50,6 +52,17 @@ public:
 		\return StateVector which contains the derivatives of the components of the state.
 	 */
 	virtual StateVector derivative(StateVector v) = 0;
+	//! Measure of the error estimate of a step, used by adaptive integrators
+	/*! \param error The estimated error of the components of the state
+	 *  \return The magnitude of the error (default implementation - abs(error))
+	 */
+	virtual double errorNorm(StateVector error);
+	//! The Jacobian of the derivative, used by implicit integrators
+	/*! \param v Current state
+	 *  \param J The Jacobian, resized to n*n - J[n*i + j] = d derivative_i / d v_j
+	 *  (default implementation - forward differences, n evaluations of \a derivative)
+	 */
+	virtual void jacobian(StateVector v, std::vector<double>& J);
 };
 
 /*! \class Integrator
@@ -63,6 +76,9 @@ class Integrator
 protected:
 	double stepSize;	///< Default step size
 	double initStepSize;///< Step size which was given to the constructor (for resetting purposes)
+	double lastStep;	///< Step size actually used in the last call to \a next
+	double lastError;	///< Error estimate of the last step (0 for fixed-step methods)
+	int lastRejections;	///< Number of rejected attempts in the last call to \a next
 public:
 	//! Constructor
 	/*! \param stepSize Initial step size
@@ -86,6 +102,23 @@ public:
 	
 	//! Returns the default step size.
 	double getStepSize();
+	//! Returns the step size actually used in the last call to \a next (for adaptive methods - the accepted one).
+	double getLastStep();
+	//! Returns the error estimate of the last step (0 for methods without one)
+	double getLastError();
+	//! Returns the number of steps rejected in the last call to \a next before one was accepted
+	int getLastRejections();
+	
+	//! Returns the equation whose derivative is kept for the next step (NULL - none, default implementation)
+	virtual DiffEq* getLastEquation();
+	//! Sets the equation to which the kept derivative belongs (after restoring the state, default implementation - nothing)
+	virtual void setLastEquation(DiffEq*);
+	//! Serializes the internal state (step sizes and the data kept between the steps)
+	virtual void saveState(StateWriter&);
+	//! Restores the internal state
+	/*! The kept derivative is not used until its equation is set with \a setLastEquation.
+	 */
+	virtual void loadState(StateReader&);
 };
 
 #endif
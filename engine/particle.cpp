@@ -1,10 +1,21 @@
 #include "particle.h"
+#include "counters.h"
+#include "profiler.h"
+#include <math.h>
 
 Particle::Particle(Manifold* _m)
 	: p(0)
 {
 	m = _m;
 	integrator = NULL;
+	stepPredictor = stepRecorder = NULL;
+	stepTrace = NULL;
+	sink = NULL;
+	trajId = 0;
+	tau = 0.0;
+	lambda = 0.0;
+	timeTransform = NULL;
+	stopReason = StopCondition::NotStopped;
 }
 
 Particle::Particle(Manifold* _m, Point _p, vector4 _u)
@@ -13,6 +24,14 @@ Particle::Particle(Manifold* _m, Point _p, vector4 _u)
 	m = _m;
 	u = _u;
 	integrator = NULL;
+	stepPredictor = stepRecorder = NULL;
+	stepTrace = NULL;
+	sink = NULL;
+	trajId = 0;
+	tau = 0.0;
+	lambda = 0.0;
+	timeTransform = NULL;
+	stopReason = StopCondition::NotStopped;
 }
 
 Particle::~Particle()
@@ -34,20 +53,47 @@ void Particle::setCoordSystem(int sys)
 	}
 }
 
+Manifold* Particle::getManifold()
+{
+	return m;
+}
+
 Point Particle::getPos()
 {
 	return p;
 }
 
+Point Particle::getLastPos()
+{
+	return lastPos;
+}
+
 vector4 Particle::getVel()
 {
 	return u;
 }
 
+double Particle::getProperTime()
+{
+	return tau;
+}
+
+void Particle::setProperTime(double t)
+{
+	tau = t;
+}
+
+double Particle::getLambda()
+{
+	return lambda;
+}
+
 void Particle::setPosVel(Point _p, vector4 _u)
 {
 	p = _p;
+	lastPos = Point();
 	u = _u;
+	stopReason = StopCondition::NotStopped;
 }
 
 void Particle::setVel(vector4 _u)
@@ -55,6 +101,48 @@ void Particle::setVel(vector4 _u)
 	u = _u;
 }
 
+static void putPoint(StateWriter& w, Point p)
+{
+	int i;
+	w.putInt(p.getCoordSystem());
+	for(i = 0; i < 4; i++)
+		w.putDouble((p.getCoordSystem() == -1) ? 0.0 : p[i]);
+}
+
+static Point getPoint(StateReader& r)
+{
+	int i;
+	int cs = r.getInt();
+	Point p(cs);
+	for(i = 0; i < 4; i++)
+		p[i] = r.getDouble();
+	return (cs == -1) ? Point() : p;
+}
+
+void Particle::saveState(StateWriter& w)
+{
+	int i;
+	putPoint(w, p);
+	putPoint(w, lastPos);
+	for(i = 0; i < 4; i++)
+		w.putDouble(u[i]);
+	w.putDouble(tau);
+	w.putDouble(lambda);
+	w.putInt(stopReason);
+}
+
+void Particle::loadState(StateReader& r)
+{
+	int i;
+	p = getPoint(r);
+	lastPos = getPoint(r);
+	for(i = 0; i < 4; i++)
+		u[i] = r.getDouble();
+	tau = r.getDouble();
+	lambda = r.getDouble();
+	stopReason = r.getInt();
+}
+
 StateVector Particle::constructState()
 {
 	StateVector v;
@@ -105,18 +193,131 @@ void Particle::setIntegrator(Integrator* i)
 	integrator = i;
 }
 
+void Particle::setStepPredictor(StepProfile* profile)
+{
+	stepPredictor = profile;
+}
+
+void Particle::setStepRecorder(StepProfile* profile)
+{
+	stepRecorder = profile;
+}
+
+void Particle::setStepTrace(StepTrace* trace)
+{
+	stepTrace = trace;
+}
+
+void Particle::setTrajectorySink(TrajectorySink* s, uint32_t id)
+{
+	sink = s;
+	trajId = id;
+	if(sink) writeRecord();
+}
+
+void Particle::setTimeTransform(TimeTransform* t)
+{
+	timeTransform = t;
+}
+
+void Particle::writeRecord()
+{
+	TrajectoryRecord r;
+	r.traj = trajId;
+	r.chart = p.getCoordSystem();
+	r.tau = tau;
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		r.x[i] = p[i];
+		r.u[i] = u[i];
+	}
+	sink -> write(r);
+}
+
+void Particle::addStopCondition(StopCondition* c)
+{
+	stopConditions.push_back(c);
+}
+
+void Particle::clearStopConditions()
+{
+	stopConditions.clear();
+	stopReason = StopCondition::NotStopped;
+}
+
+bool Particle::isStopped()
+{
+	return stopReason != StopCondition::NotStopped;
+}
+
+int Particle::getStopReason()
+{
+	return stopReason;
+}
+
+int Particle::checkStopConditions()
+{
+	unsigned i;
+	int reason;
+	for(i = 0; i < stopConditions.size(); i++)
+	{
+		reason = stopConditions[i] -> check(this);
+		if(reason != StopCondition::NotStopped) return reason;
+	}
+	return StopCondition::NotStopped;
+}
+
 void Particle::propagate(double dt)
 {
+	GR_PROFILE_SCOPE(Propagate);
 	if(!integrator) throw "Integrator not set!";
 	
-	setState(integrator -> next(constructState(), this, dt));
+	if(stopReason != StopCondition::NotStopped) return;
+	stopReason = checkStopConditions();
+	if(stopReason != StopCondition::NotStopped) return;
+	
+	//only the first step is predicted - later on the integrator's own estimate is better
+	if(stepPredictor && dt == 0.0 && lastPos.getCoordSystem() == -1)
+	{
+		double h = stepPredictor -> predict(p);
+		if(h > 0.0)
+			integrator -> setStepSize(h);
+	}
+	
+	lastPos = p;
+	if(timeTransform)
+	{
+		//the pointer is set here, so that copies of the particle use their own
+		reparametrized.particle = this;
+		StateVector v = constructState();
+		v.push_back(tau);
+		v = integrator -> next(v, &reparametrized, dt);
+		tau = v.back();
+		v.pop_back();
+		setState(v);
+	}
+	else
+	{
+		setState(integrator -> next(constructState(), this, dt));
+		tau += integrator -> getLastStep();
+	}
+	lambda += integrator -> getLastStep();
+	
+	if(stepRecorder) stepRecorder -> record(lastPos, integrator -> getLastStep());
+	if(stepTrace) stepTrace -> record(p, integrator -> getLastStep(), integrator -> getLastError(), integrator -> getLastRejections());
 	
 	int newCoordSystem = m->recommendCoordSystem(p);
+	if(newCoordSystem != p.getCoordSystem()) GR_COUNT(ChartSwitch);
 	setCoordSystem(newCoordSystem);
+	
+	if(sink) writeRecord();
 }
 
 StateVector Particle::derivative(StateVector v)
 {
+	GR_COUNT(Derivative);
+	GR_PROFILE_SCOPE(Derivative);
 	Point p1 = getPosFromState(v);
 	vector4 u1 = getVelFromState(v);
 	
@@ -133,3 +334,60 @@ StateVector Particle::derivative(StateVector v)
 	return result;
 }
 
+void Particle::jacobian(StateVector v, std::vector<double>& J)
+{
+	//the states of the derived classes carry more than the geodesic
+	if(v.size() != 8)
+	{
+		DiffEq::jacobian(v, J);
+		return;
+	}
+	Point p1 = getPosFromState(v);
+	vector4 u1 = getVelFromState(v);
+	Metric* metric = m -> getMetric(p.getCoordSystem());
+	int i, j, k;
+	J.assign(64, 0.0);
+	
+	//d(-Gamma^i(u,u))/dx^k by central differences - the shifted points go first, so that the cache keeps the values at p1
+	for(k = 0; k < 4; k++)
+	{
+		if(metric -> isIgnorable(k)) continue;
+		double h = 6e-6*(1.0 + fabs(p1[k]));
+		Point q1 = p1, q2 = p1;
+		q1[k] += h;
+		q2[k] -= h;
+		vector4 d = (metric -> christoffel(u1, u1, q2) - metric -> christoffel(u1, u1, q1))/(2*h);
+		for(i = 0; i < 4; i++)
+			J[8*(2*i + 1) + 2*k] = d[i];
+	}
+	//dx^i/dtau = u^i, d(-Gamma^i(u,u))/du^j = -2 Gamma^i_jk u^k
+	for(i = 0; i < 4; i++)
+	{
+		J[8*2*i + 2*i + 1] = 1.0;
+		for(j = 0; j < 4; j++)
+		{
+			double a = 0.0;
+			for(k = 0; k < 4; k++)
+				a += metric -> christoffel(i, j, k, p1)*u1[k];
+			J[8*(2*i + 1) + 2*j + 1] = -2*a;
+		}
+	}
+}
+
+StateVector Particle::Reparametrized::derivative(StateVector v)
+{
+	StateVector state(v.begin(), v.end() - 1);
+	double f = particle -> timeTransform -> factor(particle -> getPosFromState(state), particle -> getVelFromState(state));
+	StateVector result = f*particle -> derivative(state);
+	result.push_back(f);
+	return result;
+}
+
+double Particle::Reparametrized::errorNorm(StateVector error)
+{
+	double tauError = error.back();
+	error.pop_back();
+	double e = particle -> errorNorm(error);
+	return sqrt(e*e + tauError*tauError);
+}
+
@@ -7,6 +7,12 @@
 
 #include "geometry.h"
 #include "numeric.h"
+#include "stopcondition.h"
+#include "stepprofile.h"
+#include "steptrace.h"
+#include "trajectory.h"
+#include "timetransform.h"
+#include <vector>
 
 /*! \class Particle
  * \brief Class representing a particle with defined position and 4-velocity.
@@ -15,8 +21,22 @@
  */
 class Particle : public DiffEq
 {
+	/*! \class Reparametrized
+	 * \brief The equation of motion of the particle in the parameter of its time transformation
+	 *
+	 * The state is the state of the particle followed by the proper time.
+	 */
+	class Reparametrized : public DiffEq
+	{
+	public:
+		Particle* particle;
+		StateVector derivative(StateVector v);
+		double errorNorm(StateVector error);
+	};
+	Reparametrized reparametrized;
 protected:
 	Point p;
+	Point lastPos;	///< Position before the last step (invalid before the first step)
 	vector4 u;
 	Manifold* m;
 	
@@ -30,6 +50,27 @@ protected:
 	virtual vector4 getVelFromState(StateVector);
 	
 	Integrator* integrator;
+	
+	StepProfile* stepPredictor;
+	StepProfile* stepRecorder;
+	StepTrace* stepTrace;
+	
+	TrajectorySink* sink;
+	uint32_t trajId;
+	double tau;		///< Proper time (affine parameter for photons)
+	double lambda;	///< The parameter of the time transformation (equal to tau if there is none)
+	TimeTransform* timeTransform;
+	
+	//! Writes the current state to the trajectory sink
+	void writeRecord();
+	
+	std::vector<StopCondition*> stopConditions;
+	int stopReason;	///< Reason of stopping (StopCondition::NotStopped if the particle is still propagated)
+	
+	//! Checks the stop conditions in the order they were added.
+	/*! \return The reason returned by the first fulfilled condition, or StopCondition::NotStopped
+	 */
+	int checkStopConditions();
 public:
 	//! Constructor
 	/*! \param _m The manifold on which the particle is defined
@@ -46,29 +87,84 @@ public:
 	
 	//! Sets the integrator to be used for propagation.
 	void setIntegrator(Integrator*);
+	//! Sets the profile used to predict the step sizes (NULL - none)
+	/*! Before the first step after setting the position (if made with the default step size), the integrator's step size
+	 *  is set to the value predicted for the initial position, if there is one. The profile is not owned by the particle.
+	 */
+	void setStepPredictor(StepProfile*);
+	//! Sets the profile in which the accepted step sizes are recorded (NULL - none)
+	/*! The profile is not owned by the particle.
+	 */
+	void setStepRecorder(StepProfile*);
+	//! Sets the trace in which every step is recorded (NULL - none)
+	/*! The trace is not owned by the particle.
+	 */
+	void setStepTrace(StepTrace*);
+	//! Sets the output of the trajectory (NULL - none)
+	/*! The current state is written immediately, and then the state after every step. The sink is not owned by the particle.
+	 *  \param s The output
+	 *  \param id ID of the trajectory in the records
+	 */
+	void setTrajectorySink(TrajectorySink* s, uint32_t id);
+	//! Sets the transformation of the parameter of propagation (NULL - none, the proper time is used)
+	/*! With a transformation, the steps of the integrator (also those given to \a propagate, recorded in the step profiles
+	 *  and traces) are steps in lambda, and the proper time is integrated along with the state. The transformation is not
+	 *  owned by the particle.
+	 */
+	void setTimeTransform(TimeTransform*);
 	
 	//! Overloaded method from \a DiffEq
 	/*! \param v Current state
 	 *  \return The derivative of the current state as given by the geodesic equation.
 	 */
 	StateVector derivative(StateVector v);
+	//! Overloaded method from \a DiffEq
+	/*! The derivatives with respect to the 4-velocity are exact, those with respect to the position are central differences
+	 *  of the Christoffel symbols (the coordinates the metric does not depend on are skipped). The states of the derived
+	 *  classes, which are longer, use the default implementation.
+	 */
+	void jacobian(StateVector v, std::vector<double>& J);
 	//! Propagates the particle
-	/*! \param step The simulation step - corresponds to the change in proper time.
+	/*! Does nothing if the particle has been stopped. The stop conditions are checked before the step is made,
+	 *  so the particle is never integrated further once its fate is known.
+	 *  \param step The simulation step - corresponds to the change in proper time (in lambda with a time transformation).
 	 */
 	void propagate(double step = 0.0);
 	
+	//! Adds a condition which ends the propagation
+	/*! The condition is not owned by the particle.
+	 */
+	void addStopCondition(StopCondition*);
+	//! Removes all stop conditions and clears the stopped state
+	void clearStopConditions();
+	//! Returns true if the propagation has been stopped by one of the conditions
+	bool isStopped();
+	//! Returns the reason of stopping (StopCondition::NotStopped if the particle is not stopped)
+	int getStopReason();
+	
 	//! Returns the current coordinate system in use.
 	int getCoordSystem();
 	//! Changes the coordinate system in use.
 	virtual void setCoordSystem(int);
 	
+	//! Returns the manifold on which the particle is defined.
+	Manifold* getManifold();
 	//! Returns the position.
 	Point getPos();
+	//! Returns the position before the last step (a point with an invalid coordinate system if no step was made).
+	Point getLastPos();
 	//! Returns the 4-velocity.
 	vector4 getVel();
+	//! Returns the proper time (affine parameter for photons) elapsed in the steps made so far
+	double getProperTime();
+	//! Sets the proper time
+	void setProperTime(double);
+	//! Returns the parameter of the time transformation elapsed in the steps made so far (the proper time if there is none)
+	double getLambda();
 	
 	//! Changes the position and 4-velocity
-	/*! \param _p The new position
+	/*! Clears the stopped state, the stop conditions will be evaluated again at the new position.
+	 *  \param _p The new position
 	 *  \param _u The new 4-velocity
 	 */
 	virtual void setPosVel(Point _p, vector4 _u);
@@ -76,6 +172,13 @@ public:
 	/*! \param _u The new 4-velocity
 	 */
 	virtual void setVel(vector4 _u);
+	
+	//! Serializes the state of the particle (position, 4-velocity, proper time and lambda, stopped state)
+	/*! The attached objects (integrator, stop conditions, profiles, traces and sinks) are not part of the state.
+	 */
+	virtual void saveState(StateWriter&);
+	//! Restores the state of the particle
+	virtual void loadState(StateReader&);
 };
 
 #endif
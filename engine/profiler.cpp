@@ -0,0 +1,390 @@
+#include "profiler.h"
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define GR_HAVE_RDTSC
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define GR_HAVE_PERF
+#endif
+
+static inline uint64_t readTimer()
+{
+#ifdef GR_HAVE_RDTSC
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Call tree
+ */
+
+class ProfileNode
+{
+public:
+	int phase;
+	ProfileNode* parent;
+	ProfileNode* children[ProfileReport::NPhases];
+	uint64_t calls;
+	uint64_t total[ProfileReport::NValues];
+	uint64_t self[ProfileReport::NValues];
+	uint64_t nested[ProfileReport::NValues];	///< Values of the nested scopes of the call in progress
+
+	ProfileNode(int _phase, ProfileNode* _parent);
+	~ProfileNode();
+
+	//! Returns the child node of a phase, creating it if necessary
+	ProfileNode* child(int phase);
+	//! Zeroes the values of the subtree
+	void clear();
+	//! Adds the values of another subtree
+	void merge(ProfileNode* other);
+};
+
+ProfileNode::ProfileNode(int _phase, ProfileNode* _parent)
+{
+	phase = _phase;
+	parent = _parent;
+	int i;
+	for(i = 0; i < ProfileReport::NPhases; i++)
+		children[i] = NULL;
+	clear();
+}
+
+ProfileNode::~ProfileNode()
+{
+	int i;
+	for(i = 0; i < ProfileReport::NPhases; i++)
+		delete children[i];
+}
+
+ProfileNode* ProfileNode::child(int phase)
+{
+	if(!children[phase]) children[phase] = new ProfileNode(phase, this);
+	return children[phase];
+}
+
+void ProfileNode::clear()
+{
+	int i;
+	calls = 0;
+	for(i = 0; i < ProfileReport::NValues; i++)
+		total[i] = self[i] = nested[i] = 0;
+	for(i = 0; i < ProfileReport::NPhases; i++)
+		if(children[i]) children[i]->clear();
+}
+
+void ProfileNode::merge(ProfileNode* other)
+{
+	int i;
+	calls += other->calls;
+	for(i = 0; i < ProfileReport::NValues; i++)
+	{
+		total[i] += other->total[i];
+		self[i] += other->self[i];
+	}
+	for(i = 0; i < ProfileReport::NPhases; i++)
+		if(other->children[i]) child(i)->merge(other->children[i]);
+}
+
+/*
+ * Threads
+ */
+
+class ThreadProfile
+{
+public:
+	ProfileNode root;
+	ProfileNode* current;
+	int perfFd;		///< The leader of the perf_event group, -1 if the hardware counters are not used
+
+	ThreadProfile();
+	~ThreadProfile();
+
+	//! Reads the current values
+	void read(uint64_t* values);
+};
+
+static std::mutex& registryMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+static std::vector<ThreadProfile*>& registry()
+{
+	static std::vector<ThreadProfile*> threads;
+	return threads;
+}
+
+//profiles of the threads which have already ended
+static ProfileNode& retired()
+{
+	static ProfileNode root(-1, NULL);
+	return root;
+}
+
+static std::atomic<bool> perfEnabled(false);
+static std::atomic<bool> perfUsed(false);
+
+#ifdef GR_HAVE_PERF
+static int perfOpen(uint64_t config, int group)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+static thread_local ThreadProfile gThreadProfile;
+
+ThreadProfile::ThreadProfile()
+	: root(-1, NULL)
+{
+	current = &root;
+	perfFd = -1;
+
+#ifdef GR_HAVE_PERF
+	if(perfEnabled)
+	{
+		perfFd = perfOpen(PERF_COUNT_HW_CPU_CYCLES, -1);
+		if(perfFd >= 0)
+		{
+			if(perfOpen(PERF_COUNT_HW_CACHE_MISSES, perfFd) < 0 || perfOpen(PERF_COUNT_HW_BRANCH_MISSES, perfFd) < 0)
+			{
+				//closing the leader closes the whole group
+				close(perfFd);
+				perfFd = -1;
+			}
+			else perfUsed = true;
+		}
+	}
+#endif
+
+	//the totals must outlive the thread-local profiles, so they have to be constructed first
+	retired();
+	std::lock_guard<std::mutex> lock(registryMutex());
+	registry().push_back(this);
+}
+
+ThreadProfile::~ThreadProfile()
+{
+#ifdef GR_HAVE_PERF
+	if(perfFd >= 0) close(perfFd);
+#endif
+
+	std::lock_guard<std::mutex> lock(registryMutex());
+	std::vector<ThreadProfile*>& threads = registry();
+	unsigned i;
+	for(i = 0; i < threads.size(); i++)
+		if(threads[i] == this)
+		{
+			threads.erase(threads.begin() + i);
+			break;
+		}
+	retired().merge(&root);
+}
+
+void ThreadProfile::read(uint64_t* values)
+{
+	values[ProfileReport::Time] = readTimer();
+	values[ProfileReport::Cycles] = values[ProfileReport::CacheMisses] = values[ProfileReport::BranchMisses] = 0;
+
+#ifdef GR_HAVE_PERF
+	if(perfFd >= 0)
+	{
+		uint64_t buffer[4];	//the number of counters and their values
+		if(::read(perfFd, buffer, sizeof(buffer)) == sizeof(buffer))
+		{
+			values[ProfileReport::Cycles] = buffer[1];
+			values[ProfileReport::CacheMisses] = buffer[2];
+			values[ProfileReport::BranchMisses] = buffer[3];
+		}
+	}
+#endif
+}
+
+/*
+ * ProfileScope
+ */
+
+ProfileScope::ProfileScope(int phase)
+{
+	thread = &gThreadProfile;
+	thread->current = thread->current->child(phase);
+	thread->read(start);
+}
+
+ProfileScope::~ProfileScope()
+{
+	uint64_t now[ProfileReport::NValues];
+	thread->read(now);
+
+	ProfileNode* node = thread->current;
+	int i;
+	for(i = 0; i < ProfileReport::NValues; i++)
+	{
+		uint64_t elapsed = now[i] - start[i];
+		node->total[i] += elapsed;
+		node->self[i] += (elapsed > node->nested[i]) ? elapsed - node->nested[i] : 0;
+		node->nested[i] = 0;
+		node->parent->nested[i] += elapsed;
+	}
+	node->calls++;
+	thread->current = node->parent;
+}
+
+/*
+ * ProfileReport
+ */
+
+ProfileReport::ProfileReport()
+{
+	int i, j;
+	for(i = 0; i < NPhases; i++)
+	{
+		phases[i].calls = 0;
+		for(j = 0; j < NValues; j++)
+			phases[i].total[j] = phases[i].self[j] = 0;
+	}
+	perf = false;
+}
+
+const char* ProfileReport::phaseName(int phase)
+{
+	static const char* names[NPhases] = { "propagate", "step", "derivative", "metric", "conversion", "arithmetic" };
+	if(phase < 0 || phase >= NPhases) throw "ProfileReport: Index out of bounds.";
+	return names[phase];
+}
+
+const char* ProfileReport::valueName(int value)
+{
+#ifdef GR_HAVE_RDTSC
+	static const char* names[NValues] = { "tsc cycles", "cycles", "cache misses", "branch misses" };
+#else
+	static const char* names[NValues] = { "ns", "cycles", "cache misses", "branch misses" };
+#endif
+	if(value < 0 || value >= NValues) throw "ProfileReport: Index out of bounds.";
+	return names[value];
+}
+
+void ProfileReport::print(std::ostream& out)
+{
+	int i, j;
+	int nValues = perf ? NValues : 1;
+	for(i = 0; i < NPhases; i++)
+	{
+		if(!phases[i].calls) continue;
+		out << phaseName(i) << ": " << phases[i].calls << " calls";
+		for(j = 0; j < nValues; j++)
+			out << ", " << valueName(j) << " total " << phases[i].total[j] << " self " << phases[i].self[j];
+		out << std::endl;
+	}
+}
+
+bool ProfileReport::writeFolded(const char* filename, int value)
+{
+	if(value < 0 || value >= NValues) throw "ProfileReport: Index out of bounds.";
+	std::ofstream out(filename);
+	if(!out) return false;
+	unsigned i;
+	for(i = 0; i < stacks.size(); i++)
+		if(stacks[i].self[value])
+			out << stacks[i].path << " " << stacks[i].self[value] << std::endl;
+	return (bool)out;
+}
+
+/*
+ * Profiler
+ */
+
+//adds the nodes of a tree to the report - onStack counts the ancestors of every phase
+static void collectNode(ProfileNode* node, std::string path, int* onStack, std::map<std::string, ProfileReport::Stack>& stacks, ProfileReport& report)
+{
+	int i, j;
+	if(node->phase >= 0)
+	{
+		path = path.empty() ? ProfileReport::phaseName(node->phase) : path + ";" + ProfileReport::phaseName(node->phase);
+
+		ProfileReport::Stack& s = stacks[path];
+		if(s.path.empty())
+		{
+			s.path = path;
+			s.calls = 0;
+			for(j = 0; j < ProfileReport::NValues; j++)
+				s.total[j] = s.self[j] = 0;
+		}
+		s.calls += node->calls;
+
+		ProfileReport::PhaseTotals& p = report.phases[node->phase];
+		p.calls += node->calls;
+		for(j = 0; j < ProfileReport::NValues; j++)
+		{
+			s.total[j] += node->total[j];
+			s.self[j] += node->self[j];
+			p.self[j] += node->self[j];
+			if(!onStack[node->phase]) p.total[j] += node->total[j];
+		}
+		onStack[node->phase]++;
+	}
+
+	for(i = 0; i < ProfileReport::NPhases; i++)
+		if(node->children[i]) collectNode(node->children[i], path, onStack, stacks, report);
+
+	if(node->phase >= 0) onStack[node->phase]--;
+}
+
+void Profiler::enablePerf(bool enable)
+{
+	perfEnabled = enable;
+}
+
+ProfileReport Profiler::collect()
+{
+	ProfileReport report;
+	std::map<std::string, ProfileReport::Stack> stacks;
+	int onStack[ProfileReport::NPhases] = { 0 };
+
+	std::lock_guard<std::mutex> lock(registryMutex());
+	collectNode(&retired(), "", onStack, stacks, report);
+	std::vector<ThreadProfile*>& threads = registry();
+	unsigned i;
+	for(i = 0; i < threads.size(); i++)
+		collectNode(&threads[i]->root, "", onStack, stacks, report);
+
+	std::map<std::string, ProfileReport::Stack>::iterator it;
+	for(it = stacks.begin(); it != stacks.end(); it++)
+		report.stacks.push_back(it->second);
+	report.perf = perfUsed;
+	return report;
+}
+
+void Profiler::reset()
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	retired().clear();
+	std::vector<ThreadProfile*>& threads = registry();
+	unsigned i;
+	for(i = 0; i < threads.size(); i++)
+		threads[i]->root.clear();
+}
@@ -0,0 +1,122 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+/*! \file profiler.h
+ * \brief Optional scoped timers of the engine phases
+ *
+ * The timers are compiled in only if GR_PROFILE is defined (make PROFILE=1). Otherwise GR_PROFILE_SCOPE expands to nothing.
+ */
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*! \class ProfileReport
+ * \brief Totals of the profiled phases, summed over all threads
+ *
+ * Every value is collected both per call stack (for flame graphs) and per phase. The "self" values exclude the time
+ * spent in the nested phases; the total values of a phase count only its outermost calls, so recursion is not counted twice.
+ */
+class ProfileReport
+{
+public:
+	//! The phases
+	enum Phase
+	{
+		Propagate = 0,	///< Particle::propagate
+		Step,			///< Integrator::next
+		Derivative,		///< DiffEq::derivative of particles and entities
+		Metric,			///< Evaluation of the metric and the Christoffel symbols (contracted with vectors)
+		Conversion,		///< Manifold::convertPointTo and convertVectorTo
+		Arithmetic,		///< StateVector arithmetic of the integrators
+		NPhases
+	};
+	//! The measured values
+	enum Value
+	{
+		Time = 0,		///< rdtsc cycles on x86, nanoseconds (clock_gettime) elsewhere
+		Cycles,			///< CPU cycles (perf_event)
+		CacheMisses,	///< Cache misses (perf_event)
+		BranchMisses,	///< Mispredicted branches (perf_event)
+		NValues
+	};
+
+	//! Totals of a call stack
+	struct Stack
+	{
+		std::string path;		///< Names of the phases from the outermost one, separated by ';'
+		uint64_t calls;
+		uint64_t total[NValues];
+		uint64_t self[NValues];
+	};
+	//! Totals of a phase
+	struct PhaseTotals
+	{
+		uint64_t calls;
+		uint64_t total[NValues];
+		uint64_t self[NValues];
+	};
+
+	std::vector<Stack> stacks;
+	PhaseTotals phases[NPhases];
+	bool perf;	///< True if the hardware counters were read
+
+	//! Constructor - an empty report
+	ProfileReport();
+
+	//! Returns the name of a phase
+	static const char* phaseName(int phase);
+	//! Returns the name of a value
+	static const char* valueName(int value);
+
+	//! Prints the per-phase totals
+	void print(std::ostream&);
+	//! Writes the call stacks in the folded format of flame graph tools ("a;b;c value" per line, self values)
+	/*! \return true on success
+	 */
+	bool writeFolded(const char* filename, int value = Time);
+};
+
+class ProfileNode;
+class ThreadProfile;
+
+/*! \class ProfileScope
+ * \brief Measures the phase from its construction to its destruction
+ */
+class ProfileScope
+{
+	ThreadProfile* thread;
+	uint64_t start[ProfileReport::NValues];
+public:
+	ProfileScope(int phase);
+	~ProfileScope();
+};
+
+/*! \class Profiler
+ * \brief Access to the profiles of all threads
+ *
+ * Every thread keeps its own call tree, so the timers need no synchronization. The results should be collected while
+ * the profiled threads are idle (or after they finish - the trees of finished threads are kept).
+ */
+class Profiler
+{
+public:
+	//! Enables the hardware counters (Linux perf_event) for the threads which start profiling from now on
+	/*! Reading the counters costs a system call at both ends of every scope, so the times of short phases grow a lot.
+	 *  If the counters are not available (other systems, insufficient permissions), only the times are measured.
+	 */
+	static void enablePerf(bool);
+	//! Sums the profiles of all threads
+	static ProfileReport collect();
+	//! Clears the profiles of all threads
+	static void reset();
+};
+
+#ifdef GR_PROFILE
+#define GR_PROFILE_SCOPE(phase) ProfileScope grProfileScope(ProfileReport::phase)
+#else
+#define GR_PROFILE_SCOPE(phase)
+#endif
+
+#endif
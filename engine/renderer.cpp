@@ -0,0 +1,637 @@
+#include "renderer.h"
+#include "dpintegrator.h"
+#include "kerr_coords.h"
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+#include <chrono>
+
+Renderer::Renderer(Manifold* _m, Entity* _camera, int _width, int _height, double _fov)
+{
+	m = _m;
+	camera = _camera;
+	width = _width;
+	height = _height;
+	fov = _fov;
+	
+	tileSize = 16;
+	nThreads = 0;
+	threadsUsed = 0;
+	maxSteps = 100000;
+	coarseStep = 1;
+	maxAngle = 0.01;
+	warmStart = true;
+	
+	stallSteps = 0;
+	traceCapacity = 256;
+	maxDumps = 1;
+	traceOut = NULL;
+	stalledRays = 0;
+	dumps = 0;
+	
+	maxErr = 1e-8;
+	initStep = 0.1;
+	minStep = 1e-5;
+	maxStep = 10.0;
+	
+	rHorizon = 0.0;
+	rEscape = 1000.0;
+	rDiskIn = rDiskOut = 0.0;
+	classifier = NULL;
+	
+	totalTime = 0.0;
+}
+
+Renderer::~Renderer()
+{
+}
+
+void Renderer::setTileSize(int size)
+{
+	tileSize = size;
+}
+
+void Renderer::setThreads(int n)
+{
+	nThreads = n;
+}
+
+void Renderer::setMaxSteps(int n)
+{
+	maxSteps = n;
+}
+
+void Renderer::setIntegrator(double _maxErr, double _initStep, double _minStep, double _maxStep)
+{
+	maxErr = _maxErr;
+	initStep = _initStep;
+	minStep = _minStep;
+	maxStep = _maxStep;
+}
+
+void Renderer::setHorizon(double r)
+{
+	rHorizon = r;
+}
+
+void Renderer::setEscapeRadius(double r)
+{
+	rEscape = r;
+}
+
+void Renderer::setDisk(double rIn, double rOut)
+{
+	rDiskIn = rIn;
+	rDiskOut = rOut;
+}
+
+void Renderer::setClassifier(GeodesicClassifier* c)
+{
+	classifier = c;
+}
+
+void Renderer::setAdaptive(int step, double angle)
+{
+	coarseStep = (step < 1) ? 1 : step;
+	maxAngle = angle;
+}
+
+void Renderer::setWarmStart(bool enable)
+{
+	warmStart = enable;
+}
+
+void Renderer::setStallDetection(int steps, std::ostream* out, int capacity, int _maxDumps)
+{
+	stallSteps = steps;
+	traceOut = out;
+	traceCapacity = capacity;
+	maxDumps = _maxDumps;
+}
+
+vector4 Renderer::rayDirection(double x, double y)
+{
+	double t = tan(fov/2);
+	double alpha = (2*x/width - 1.0)*t;
+	double beta = (1.0 - 2*y/height)*t*height/width;
+	
+	vector4 n = (camBasis[1] + alpha*camBasis[2] + beta*camBasis[3])/sqrt(1.0 + alpha*alpha + beta*beta);
+	
+	//past-directed null vector - the photon is traced backwards in time
+	return n - camBasis[0];
+}
+
+RayResult Renderer::traceRay(RenderContext& ctx, double x, double y)
+{
+	RayResult res;
+	unsigned i;
+	
+	res.traced = true;
+	Particle ray(ctx.m, camPos, rayDirection(x, y));
+	ray.setIntegrator(ctx.integrator);
+	ctx.integrator->resetStepSize();
+	for(i = 0; i < ctx.conditions.size(); i++)
+		ray.addStopCondition(ctx.conditions[i]);
+	
+	if(ctx.recorder)
+	{
+		//the previous ray's record becomes the prediction for this one
+		StepProfile* tmp = ctx.predictor;
+		ctx.predictor = ctx.recorder;
+		ctx.recorder = tmp;
+		ctx.recorder->clear();
+		ray.setStepPredictor(ctx.predictor);
+		ray.setStepRecorder(ctx.recorder);
+	}
+	
+	if(ctx.trace)
+	{
+		ctx.trace->clear();
+		ray.setStepTrace(ctx.trace);
+	}
+	
+	res.steps = 0;
+	bool stalled = false;
+	try
+	{
+		while(res.steps < maxSteps)
+		{
+			ray.propagate();
+			//reported right away, so that the trace still contains the steps which led to the stall
+			if(ctx.trace && !stalled && ctx.trace->isTriggered())
+			{
+				stalled = true;
+				reportStall(ctx, x, y);
+			}
+			if(ray.isStopped()) break;
+			res.steps++;
+		}
+	}
+	catch(...)
+	{
+		//a failed ray (e.g. an invalid coordinate conversion) must not bring down the whole image
+		res.fate = StopCondition::NotStopped;
+		res.r = res.theta = res.phi = 0.0;
+		return res;
+	}
+	
+	res.fate = ray.getStopReason();
+	Point end;
+	if(res.fate == StopCondition::Disk)
+		end = DiskCondition::crossingPoint(&ray);
+	else
+		end = ctx.m->convertPointTo(ray.getPos(), EF);
+	
+	res.r = end[1];
+	res.theta = end[2];
+	res.phi = end[3];
+	return res;
+}
+
+void Renderer::shade(RayResult& res, unsigned char* rgb)
+{
+	double t, b;
+	int cell;
+	
+	switch(res.fate)
+	{
+	case StopCondition::Horizon:
+		rgb[0] = rgb[1] = rgb[2] = 0;
+		break;
+	case StopCondition::Disk:
+		t = (res.r - rDiskIn)/(rDiskOut - rDiskIn);
+		if(t < 0.0) t = 0.0;
+		if(t > 1.0) t = 1.0;
+		cell = (int)floor(res.phi/(M_PI/12));
+		b = (cell % 2) ? 1.0 : 0.75;
+		rgb[0] = (unsigned char)(255*b);
+		rgb[1] = (unsigned char)((40 + 180*(1.0 - t))*b);
+		rgb[2] = (unsigned char)(60*(1.0 - t)*b);
+		break;
+	case StopCondition::Escape:
+		cell = (int)floor(res.theta/(M_PI/18)) + (int)floor(res.phi/(M_PI/18));
+		if(cell % 2)
+		{
+			rgb[0] = rgb[1] = 40;
+			rgb[2] = 90;
+		}
+		else
+		{
+			rgb[0] = rgb[1] = 200;
+			rgb[2] = 220;
+		}
+		break;
+	default:
+		rgb[0] = rgb[2] = 255;
+		rgb[1] = 0;
+	}
+}
+
+//unit vector pointing at the endpoint of a ray
+static void endpointDirection(RayResult& res, double v[3])
+{
+	v[0] = sin(res.theta)*cos(res.phi);
+	v[1] = sin(res.theta)*sin(res.phi);
+	v[2] = cos(res.theta);
+}
+
+bool Renderer::similar(RayResult& a, RayResult& b)
+{
+	double va[3], vb[3];
+	
+	if(a.fate != b.fate) return false;
+	
+	switch(a.fate)
+	{
+	case StopCondition::Horizon:
+		return true;
+	case StopCondition::Disk:
+		if(fabs(a.r - b.r) > maxAngle*a.r) return false;
+		//no break - the positions on the disk are compared as directions
+	case StopCondition::Escape:
+		endpointDirection(a, va);
+		endpointDirection(b, vb);
+		return va[0]*vb[0] + va[1]*vb[1] + va[2]*vb[2] >= cos(maxAngle);
+	default:
+		return false;
+	}
+}
+
+RayResult Renderer::interpolate(RayResult c[4], double fx, double fy)
+{
+	int i, k;
+	double w[4] = { (1-fx)*(1-fy), fx*(1-fy), (1-fx)*fy, fx*fy };
+	double v[3] = { 0.0, 0.0, 0.0 };
+	RayResult res;
+	
+	res.fate = c[0].fate;
+	res.steps = 0;
+	res.traced = false;
+	res.r = 0.0;
+	for(i = 0; i < 4; i++)
+	{
+		double d[3];
+		endpointDirection(c[i], d);
+		for(k = 0; k < 3; k++)
+			v[k] += w[i]*d[k];
+		res.r += w[i]*c[i].r;
+	}
+	
+	//directions are interpolated as unit vectors, which avoids the problems with wrapping of phi
+	res.theta = atan2(sqrt(v[0]*v[0] + v[1]*v[1]), v[2]);
+	res.phi = atan2(v[1], v[0]);
+	return res;
+}
+
+void Renderer::renderTileAdaptive(RenderContext& ctx, TileStats& tile)
+{
+	int tw = tile.width, th = tile.height;
+	int lx, ly, i;
+	
+	//the corners on the right and bottom edge belong to the neighbouring tiles - they are traced again here
+	//instead of being shared, so that the tiles stay independent
+	std::vector<RayResult> corners((tw+1)*(th+1));
+	std::vector<bool> done((tw+1)*(th+1), false);
+	
+	//blocks waiting for refinement: x, y, width, height
+	std::vector<int> blocks;
+	for(ly = 0; ly < th; ly += coarseStep)
+		for(lx = 0; lx < tw; lx += coarseStep)
+		{
+			blocks.push_back(lx);
+			blocks.push_back(ly);
+			blocks.push_back((lx + coarseStep > tw) ? tw - lx : coarseStep);
+			blocks.push_back((ly + coarseStep > th) ? th - ly : coarseStep);
+		}
+	
+	while(!blocks.empty())
+	{
+		int bh = blocks.back(); blocks.pop_back();
+		int bw = blocks.back(); blocks.pop_back();
+		int by = blocks.back(); blocks.pop_back();
+		int bx = blocks.back(); blocks.pop_back();
+		
+		int cx[4] = { bx, bx + bw, bx, bx + bw };
+		int cy[4] = { by, by, by + bh, by + bh };
+		RayResult c[4];
+		for(i = 0; i < 4; i++)
+		{
+			int idx = cy[i]*(tw+1) + cx[i];
+			if(!done[idx])
+			{
+				//the corners past the last row or column of the image are rays just outside the field of view - they are
+				//traced where they are, so that the interpolation weights stay right
+				corners[idx] = traceRay(ctx, tile.x0 + cx[i] + 0.5, tile.y0 + cy[i] + 0.5);
+				done[idx] = true;
+				tile.rays++;
+				tile.steps += corners[idx].steps;
+			}
+			c[i] = corners[idx];
+		}
+		
+		if(bw <= 1 && bh <= 1) continue;
+		
+		//the center of the block - a corner of the subdivided blocks
+		int mx = bx + bw/2, my = by + bh/2;
+		int idx = my*(tw+1) + mx;
+		if(!done[idx])
+		{
+			corners[idx] = traceRay(ctx, tile.x0 + mx + 0.5, tile.y0 + my + 0.5);
+			done[idx] = true;
+			tile.rays++;
+			tile.steps += corners[idx].steps;
+		}
+		
+		bool smooth = true;
+		for(i = 1; i < 4; i++)
+			if(c[i].fate != c[0].fate) smooth = false;
+		if(smooth)
+		{
+			RayResult guess = interpolate(c, (double)(mx - bx)/bw, (double)(my - by)/bh);
+			smooth = similar(corners[idx], guess);
+		}
+		
+		if(smooth)
+		{
+			for(ly = by; ly < by + bh; ly++)
+				for(lx = bx; lx < bx + bw; lx++)
+					if(!done[ly*(tw+1) + lx])
+					{
+						corners[ly*(tw+1) + lx] = interpolate(c, (double)(lx - bx)/bw, (double)(ly - by)/bh);
+						done[ly*(tw+1) + lx] = true;
+					}
+			continue;
+		}
+		
+		//subdivide
+		int w1 = (bw > 1) ? bw/2 : bw;
+		int h1 = (bh > 1) ? bh/2 : bh;
+		int sx[2] = { bx, bx + w1 };
+		int sw[2] = { w1, bw - w1 };
+		int sy[2] = { by, by + h1 };
+		int sh[2] = { h1, bh - h1 };
+		int j, k;
+		for(j = 0; j < 2; j++)
+			for(k = 0; k < 2; k++)
+				if(sw[k] > 0 && sh[j] > 0)
+				{
+					blocks.push_back(sx[k]);
+					blocks.push_back(sy[j]);
+					blocks.push_back(sw[k]);
+					blocks.push_back(sh[j]);
+				}
+	}
+	
+	for(ly = 0; ly < th; ly++)
+		for(lx = 0; lx < tw; lx++)
+		{
+			int p = (tile.y0 + ly)*width + tile.x0 + lx;
+			results[p] = corners[ly*(tw+1) + lx];
+			shade(results[p], &image[3*p]);
+		}
+}
+
+void Renderer::renderTile(RenderContext& ctx, TileStats& tile)
+{
+	int x, y;
+	
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	tile.rays = 0;
+	tile.steps = 0;
+	//the rays are seeded only from the earlier rays of the same tile, so the image does not depend on the order of the tiles
+	if(ctx.recorder)
+	{
+		ctx.predictor->clear();
+		ctx.recorder->clear();
+	}
+	if(coarseStep > 1)
+		renderTileAdaptive(ctx, tile);
+	else
+		for(y = tile.y0; y < tile.y0 + tile.height; y++)
+			for(x = tile.x0; x < tile.x0 + tile.width; x++)
+			{
+				RayResult& res = results[y*width + x];
+				res = traceRay(ctx, x + 0.5, y + 0.5);
+				shade(res, &image[3*(y*width + x)]);
+				tile.rays++;
+				tile.steps += res.steps;
+			}
+	
+	tile.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Renderer::reportStall(RenderContext& ctx, double x, double y)
+{
+	stalledRays++;
+	if(!traceOut) return;
+	
+	std::lock_guard<std::mutex> lock(dumpMutex);
+	if(dumps >= maxDumps) return;
+	dumps++;
+	*traceOut << "Ray (" << x << ", " << y << ") stalled at step " << ctx.trace->getTriggerStep()
+		<< " - step, h, err, rejections, chart, x[0..3]:" << std::endl;
+	ctx.trace->dump(*traceOut);
+}
+
+void Renderer::worker(Manifold* man, std::atomic<int>* nextTile)
+{
+	DPIntegrator dp(maxErr, initStep, minStep, maxStep);
+	
+	StepTrace* trace = NULL;
+	if(stallSteps > 0)
+	{
+		trace = new StepTrace(traceCapacity);
+		trace->setAnomalyTrigger(stallSteps, minStep);
+	}
+	
+	//the conditions don't keep any state, but they are cheap enough to have a set per thread
+	HorizonCondition horizon(rHorizon);
+	EscapeCondition escape(rEscape);
+	DiskCondition disk(rDiskIn, rDiskOut);
+	FateCondition fate(classifier);
+	
+	//profiles of the previous and the current ray
+	double rMin = (rHorizon > 0.0) ? rHorizon/2 : 0.01;
+	StepProfile profile1(rMin, 2*rEscape), profile2(rMin, 2*rEscape);
+	
+	RenderContext ctx;
+	ctx.m = man;
+	ctx.integrator = &dp;
+	ctx.predictor = warmStart ? &profile1 : NULL;
+	ctx.recorder = warmStart ? &profile2 : NULL;
+	ctx.trace = trace;
+	
+	if(rDiskOut > rDiskIn)
+	{
+		ctx.conditions.push_back(&disk);
+		fate.setExcludedShell(rDiskIn, rDiskOut);
+	}
+	if(rHorizon > 0.0) ctx.conditions.push_back(&horizon);
+	ctx.conditions.push_back(&escape);
+	if(classifier) ctx.conditions.push_back(&fate);
+	
+	int i;
+	while((i = (*nextTile)++) < (int)tiles.size())
+		renderTile(ctx, tiles[i]);
+	
+	delete trace;
+}
+
+void Renderer::render()
+{
+	int x, y, i;
+	
+	results.assign(width*height, RayResult());
+	image.assign(3*width*height, 0);
+	
+	int size = tileSize;
+	if(size % coarseStep) size += coarseStep - size % coarseStep;
+	
+	tiles.clear();
+	for(y = 0; y < height; y += size)
+		for(x = 0; x < width; x += size)
+		{
+			TileStats t;
+			t.x0 = x;
+			t.y0 = y;
+			t.width = (x + size > width) ? width - x : size;
+			t.height = (y + size > height) ? height - y : size;
+			t.rays = 0;
+			t.steps = 0;
+			t.time = 0.0;
+			tiles.push_back(t);
+		}
+	
+	stalledRays = 0;
+	dumps = 0;
+	
+	camPos = camera->getPos();
+	for(i = 0; i < 4; i++)
+		camBasis[i] = camera->getStateVector(i);
+	
+	int n = nThreads;
+	if(n <= 0) n = std::thread::hardware_concurrency();
+	if(n > (int)tiles.size()) n = tiles.size();
+	if(n < 1) n = 1;
+	
+	//every thread needs its own manifold - the metrics cache their values
+	std::vector<Manifold*> copies;
+	copies.push_back(m);
+	for(i = 1; i < n; i++)
+	{
+		Manifold* c = m->clone();
+		if(!c) break;
+		copies.push_back(c);
+	}
+	threadsUsed = copies.size();
+	
+	std::atomic<int> nextTile(0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	std::vector<std::thread> threads;
+	for(i = 1; i < threadsUsed; i++)
+		threads.push_back(std::thread(&Renderer::worker, this, copies[i], &nextTile));
+	worker(m, &nextTile);
+	for(i = 0; i < (int)threads.size(); i++)
+		threads[i].join();
+	
+	totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	
+	for(i = 1; i < threadsUsed; i++)
+		delete copies[i];
+}
+
+int Renderer::getWidth()
+{
+	return width;
+}
+
+int Renderer::getHeight()
+{
+	return height;
+}
+
+RayResult Renderer::getResult(int x, int y)
+{
+	if(x < 0 || x >= width || y < 0 || y >= height) throw "Renderer: Index out of bounds.";
+	return results[y*width + x];
+}
+
+unsigned char* Renderer::getImage()
+{
+	return &image[0];
+}
+
+bool Renderer::writePPM(const char* filename)
+{
+	FILE* f = fopen(filename, "wb");
+	if(!f) return false;
+	
+	fprintf(f, "P6\n%d %d\n255\n", width, height);
+	size_t n = fwrite(&image[0], 1, image.size(), f);
+	fclose(f);
+	
+	return n == image.size();
+}
+
+int Renderer::getNTiles()
+{
+	return tiles.size();
+}
+
+TileStats Renderer::getTileStats(int i)
+{
+	if(i < 0 || i >= (int)tiles.size()) throw "Renderer: Index out of bounds.";
+	return tiles[i];
+}
+
+double Renderer::getTotalTime()
+{
+	return totalTime;
+}
+
+long Renderer::getRayCount()
+{
+	long n = 0;
+	for(unsigned i = 0; i < tiles.size(); i++)
+		n += tiles[i].rays;
+	return n;
+}
+
+long Renderer::getStalledRays()
+{
+	return stalledRays;
+}
+
+double Renderer::getRaysPerSecond()
+{
+	if(totalTime == 0.0) return 0.0;
+	return getRayCount()/totalTime;
+}
+
+void Renderer::printReport(std::ostream& out)
+{
+	unsigned i;
+	long steps = 0;
+	double tMin = 0.0, tMax = 0.0, tSum = 0.0;
+	
+	for(i = 0; i < tiles.size(); i++)
+	{
+		steps += tiles[i].steps;
+		tSum += tiles[i].time;
+		if(i == 0 || tiles[i].time < tMin) tMin = tiles[i].time;
+		if(i == 0 || tiles[i].time > tMax) tMax = tiles[i].time;
+	}
+	long rays = getRayCount();
+	
+	out << "Image: " << width << "x" << height << ", " << tiles.size() << " tiles, " << threadsUsed << " thread(s)" << std::endl;
+	out << "Total time: " << totalTime << " s" << std::endl;
+	out << "Rays: " << rays << " (" << getRaysPerSecond() << " rays/s, " << (double)rays/(width*height) << " per pixel)" << std::endl;
+	if(rays > 0)
+		out << "Steps: " << steps << " (" << (double)steps/rays << " per ray, " << steps/totalTime << " steps/s)" << std::endl;
+	if(tiles.size() > 0)
+		out << "Tile time: min " << tMin << " s, avg " << tSum/tiles.size() << " s, max " << tMax << " s" << std::endl;
+	if(stallSteps > 0)
+		out << "Stalled rays: " << stalledRays << std::endl;
+}
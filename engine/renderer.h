@@ -0,0 +1,219 @@
+#ifndef __RENDERER_H__
+#define __RENDERER_H__
+
+/*! \file renderer.h
+ * \brief Backward ray-tracing of the image seen by an observer
+ */
+
+#include "geometry.h"
+#include "entity.h"
+#include "classifier.h"
+#include "stepprofile.h"
+#include "steptrace.h"
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <mutex>
+
+/*! \struct RayResult
+ * \brief The endpoint of a ray traced from the camera
+ */
+struct RayResult
+{
+	int fate;		///< Reason of stopping (StopCondition::Horizon, Escape, Disk, or NotStopped if the step limit was reached)
+	double r;		///< Radius of the endpoint (for the disk - of the crossing point)
+	double theta;	///< Polar angle of the endpoint (EF coordinates)
+	double phi;		///< Azimuthal angle of the endpoint (EF coordinates)
+	int steps;		///< Number of integration steps made
+	bool traced;	///< True if the ray was traced, false if the result was interpolated from the neighbours
+};
+
+/*! \struct TileStats
+ * \brief Timing of a single rendered tile
+ */
+struct TileStats
+{
+	int x0, y0;		///< Upper-left corner of the tile
+	int width, height;	///< Size of the tile
+	int rays;		///< Number of traced rays (smaller than the number of pixels with adaptive refinement)
+	long steps;		///< Total number of integration steps
+	double time;	///< Wall time in seconds
+};
+
+/*! \struct RenderContext
+ * \brief Objects used by a single rendering thread
+ */
+struct RenderContext
+{
+	Manifold* m;			///< The thread's copy of the manifold
+	Integrator* integrator;	///< The thread's integrator
+	std::vector<StopCondition*> conditions;	///< Stop conditions of the rays
+	StepProfile* predictor;	///< Step sizes of the previous ray (NULL - no warm start)
+	StepProfile* recorder;	///< Step sizes of the current ray (NULL - no warm start)
+	StepTrace* trace;		///< Trace of the current ray (NULL - stalls are not detected)
+};
+
+/*! \class Renderer
+ * \brief Class rendering the image seen by an observer
+ *
+ * The observer (camera) is an Entity - its 4-velocity and local basis define the frame, in which the pixel directions are
+ * constructed. The camera looks along its local X direction, local Y points to the right of the image and local Z up.
+ * For every pixel a photon is traced backwards in time (with the wave vector n - u, where n is the unit pixel direction
+ * and u the 4-velocity of the camera) until it falls below the horizon radius, escapes to the celestial sphere or crosses
+ * a thin disk in the equatorial plane.
+ *
+ * With adaptive refinement enabled (\a setAdaptive), every tile is first traced on a coarse grid. For every block of the grid
+ * the ray through its center is traced too and compared with the value interpolated from the corners. The block is subdivided
+ * (quadtree-like) if the rays in the corners end differently, or if the interpolated endpoint misses the traced one by more
+ * than a given angle. The pixels of the remaining blocks are interpolated from the corners (the center is reused by the
+ * subdivided blocks, so it is never wasted). Features smaller than the coarse grid step which disturb neither the corners
+ * nor the center can be missed.
+ *
+ * With warm start enabled (default), every ray starts with the step size accepted near the camera by the previous ray of the
+ * same tile (see StepProfile), which saves most of the rejected steps of the adaptive integrator. The first ray of a tile starts
+ * with the default step size, so the image does not depend on the number of threads.
+ *
+ * With stall detection enabled (\a setStallDetection), the last steps of every ray are kept in a StepTrace. Rays which make
+ * the given number of consecutive steps with the minimal step size are counted, and the traces of the first few are written out.
+ *
+ * The image is split into square tiles, which are rendered in parallel. Every thread uses its own copy of the manifold
+ * (Manifold::clone) - if the manifold cannot be copied, the image is rendered in a single thread. The time spent on every
+ * tile is recorded, so the renderer can serve as a throughput benchmark.
+ */
+class Renderer
+{
+protected:
+	Manifold* m;
+	Entity* camera;
+	int width, height;
+	double fov;
+	int tileSize;
+	int nThreads;
+	int threadsUsed;
+	int maxSteps;
+	int coarseStep;
+	double maxAngle;
+	bool warmStart;
+	int stallSteps, traceCapacity, maxDumps;
+	std::ostream* traceOut;
+	std::atomic<long> stalledRays;
+	int dumps;
+	std::mutex dumpMutex;
+
+	double maxErr, initStep, minStep, maxStep;
+	double rHorizon, rEscape, rDiskIn, rDiskOut;
+	GeodesicClassifier* classifier;
+
+	std::vector<RayResult> results;
+	std::vector<unsigned char> image;
+	std::vector<TileStats> tiles;
+	double totalTime;
+
+	Point camPos;
+	vector4 camBasis[4];
+
+	//! Returns the initial wave vector of the ray through a point on the image plane
+	/*! \param x Horizontal position in pixels (may be fractional)
+	 *  \param y Vertical position in pixels (may be fractional)
+	 */
+	vector4 rayDirection(double x, double y);
+	//! Traces a single ray
+	/*! \param ctx The objects of the calling thread
+	 *  \param x Horizontal position in pixels
+	 *  \param y Vertical position in pixels
+	 */
+	RayResult traceRay(RenderContext& ctx, double x, double y);
+	//! Calculates the color of a pixel from the ray endpoint
+	void shade(RayResult& res, unsigned char* rgb);
+	//! Checks whether two rays end closely enough to interpolate between them
+	bool similar(RayResult& a, RayResult& b);
+	//! Bilinear interpolation of the ray endpoints
+	/*! \param c The corners - (0,0), (1,0), (0,1), (1,1)
+	 *  \param fx Horizontal position inside the block (0..1)
+	 *  \param fy Vertical position inside the block (0..1)
+	 */
+	RayResult interpolate(RayResult c[4], double fx, double fy);
+	//! Renders a single tile
+	void renderTile(RenderContext& ctx, TileStats& tile);
+	//! Renders a single tile with adaptive refinement
+	void renderTileAdaptive(RenderContext& ctx, TileStats& tile);
+	//! Counts a stalled ray and writes its trace
+	void reportStall(RenderContext& ctx, double x, double y);
+	//! Worker thread - renders tiles until there are none left
+	void worker(Manifold* man, std::atomic<int>* nextTile);
+public:
+	//! Constructor
+	/*! \param _m The manifold
+	 *  \param _camera The observer
+	 *  \param _width Width of the image in pixels
+	 *  \param _height Height of the image in pixels
+	 *  \param _fov Horizontal field of view in radians
+	 */
+	Renderer(Manifold* _m, Entity* _camera, int _width, int _height, double _fov = 1.0);
+	//! Destructor
+	virtual ~Renderer();
+
+	//! Sets the size of the tiles (default 16 pixels)
+	void setTileSize(int);
+	//! Sets the number of threads (0 - default, one per hardware thread)
+	void setThreads(int);
+	//! Sets the maximal number of steps for a single ray (default 100000)
+	void setMaxSteps(int);
+	//! Sets the parameters of the Dormand-Prince integrators used for tracing
+	void setIntegrator(double _maxErr, double _initStep, double _minStep, double _maxStep);
+	//! Sets the radius below which rays are considered to have fallen into the horizon (0 - none)
+	void setHorizon(double r);
+	//! Sets the radius of the celestial sphere
+	void setEscapeRadius(double r);
+	//! Sets the thin disk in the equatorial plane (rOut <= rIn - no disk)
+	void setDisk(double rIn, double rOut);
+	//! Sets the classifier used for early termination of rays (NULL - none)
+	void setClassifier(GeodesicClassifier*);
+	//! Enables adaptive refinement
+	/*! \param step Step of the coarse grid in pixels (1 - refinement disabled, default). The tile size is rounded up to a multiple of it.
+	 *  \param angle Maximal error of the interpolated endpoint direction in radians (relative error for the radius on the disk)
+	 */
+	void setAdaptive(int step, double angle = 0.01);
+	//! Enables or disables warm-starting the step size of every ray from the previous one
+	void setWarmStart(bool);
+	//! Enables the detection of rays stalled at the minimal step size
+	/*! \param steps Number of consecutive minimal steps after which a ray counts as stalled (0 - disabled, default)
+	 *  \param out Stream to which the step traces of the stalled rays are written (NULL - they are only counted)
+	 *  \param capacity Number of the last steps kept for every ray
+	 *  \param _maxDumps Maximal number of the written traces in a single render
+	 */
+	void setStallDetection(int steps, std::ostream* out = NULL, int capacity = 256, int _maxDumps = 1);
+
+	//! Renders the image
+	void render();
+
+	//! Returns the width of the image
+	int getWidth();
+	//! Returns the height of the image
+	int getHeight();
+	//! Returns the endpoint of the ray traced through a pixel
+	RayResult getResult(int x, int y);
+	//! Returns the image buffer - width*height RGB triples, row by row
+	unsigned char* getImage();
+	//! Writes the image to a binary PPM file
+	/*! \return true on success
+	 */
+	bool writePPM(const char* filename);
+
+	//! Returns the number of tiles
+	int getNTiles();
+	//! Returns the statistics of a tile
+	TileStats getTileStats(int i);
+	//! Returns the wall time of the last render in seconds
+	double getTotalTime();
+	//! Returns the number of rays traced in the last render
+	long getRayCount();
+	//! Returns the number of rays which stalled at the minimal step size in the last render (0 if the detection is disabled)
+	long getStalledRays();
+	//! Returns the number of rays traced per second in the last render
+	double getRaysPerSecond();
+	//! Prints the timing report
+	void printReport(std::ostream&);
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "rk4integrator.h"
+#include "profiler.h"
 
 /*******************************************************************************
  *
@@ -17,6 +18,7 @@ RK4Integrator::~RK4Integrator()
 
 StateVector RK4Integrator::next(StateVector state, DiffEq* equation, double step)
 {
+	GR_PROFILE_SCOPE(Step);
 	double h;
 	if(step == 0.0) 
 		h = stepSize;
@@ -30,6 +32,7 @@ StateVector RK4Integrator::next(StateVector state, DiffEq* equation, double step
 	k3 = equation -> derivative(state + k2*h/2);
 	k4 = equation -> derivative(state + k3*h);
 	
+	lastStep = h;
 	return state + (k1 + 2*k2 + 2*k3 + k4)*h/6;
 }
 
@@ -0,0 +1,249 @@
+#include "rosenbrockintegrator.h"
+#include "profiler.h"
+#include <math.h>
+
+//LU decomposition with partial pivoting, in place
+static void luDecompose(std::vector<double>& A, int n, std::vector<int>& pivot)
+{
+	int i, j, k;
+	pivot.resize(n);
+	for(k = 0; k < n; k++)
+	{
+		int best = k;
+		for(i = k + 1; i < n; i++)
+			if(fabs(A[n*i + k]) > fabs(A[n*best + k])) best = i;
+		if(A[n*best + k] == 0.0) throw "RosenbrockIntegrator: Singular matrix.";
+		pivot[k] = best;
+		if(best != k)
+			for(j = 0; j < n; j++)
+			{
+				double t = A[n*k + j];
+				A[n*k + j] = A[n*best + j];
+				A[n*best + j] = t;
+			}
+		for(i = k + 1; i < n; i++)
+		{
+			double f = A[n*i + k] /= A[n*k + k];
+			if(f == 0.0) continue;
+			for(j = k + 1; j < n; j++)
+				A[n*i + j] -= f*A[n*k + j];
+		}
+	}
+}
+
+//solves A x = b with the decomposition of A
+static StateVector luSolve(const std::vector<double>& A, int n, const std::vector<int>& pivot, StateVector b)
+{
+	int i, j;
+	for(i = 0; i < n; i++)
+		if(pivot[i] != i)
+		{
+			double t = b[i];
+			b[i] = b[pivot[i]];
+			b[pivot[i]] = t;
+		}
+	for(i = 1; i < n; i++)
+		for(j = 0; j < i; j++)
+			b[i] -= A[n*i + j]*b[j];
+	for(i = n - 1; i >= 0; i--)
+	{
+		for(j = i + 1; j < n; j++)
+			b[i] -= A[n*i + j]*b[j];
+		b[i] /= A[n*i + i];
+	}
+	return b;
+}
+
+//the spectral radius of J - the growth of J^k x over a few steps of the power method
+static double spectralRadius(const std::vector<double>& J, int n)
+{
+	StateVector x(n, 1.0), y(n);
+	double logGrowth = 0.0;
+	int i, j, k;
+	const int iterations = 8;
+	for(k = 0; k < iterations; k++)
+	{
+		for(i = 0; i < n; i++)
+		{
+			y[i] = 0.0;
+			for(j = 0; j < n; j++)
+				y[i] += J[n*i + j]*x[j];
+		}
+		double norm = abs(y)/abs(x);
+		if(norm == 0.0) return 0.0;
+		logGrowth += log(norm);
+		x = y/abs(y);
+	}
+	return exp(logGrowth/iterations);
+}
+
+/*******************************************************************************
+ *
+ *  RosenbrockIntegrator class implementation
+ *
+ *******************************************************************************/
+
+RosenbrockIntegrator::RosenbrockIntegrator(double maxErr, double stepSize, double minStep, double maxStep)
+	: Integrator(stepSize)
+{
+	this->maxErr = maxErr;
+	this->minStep = minStep;
+	this->maxStep = maxStep;
+	rejections = 0;
+	lastEq = NULL;
+	jacEq = NULL;
+	stiffness = 0.0;
+}
+
+RosenbrockIntegrator::~RosenbrockIntegrator()
+{
+}
+
+StateVector RosenbrockIntegrator::next(StateVector state, DiffEq* equation, double step)
+{
+	GR_PROFILE_SCOPE(Step);
+	double h;
+	if(step == 0.0) 
+		h = stepSize;
+	else
+		h = step;
+	
+	const double d = 1.0/(2.0 + sqrt(2.0));
+	const double e32 = 6.0 + sqrt(2.0);
+	int n = state.size();
+	int i;
+	
+	StateVector F0, F1, F2, k1, k2, k3, nextState;
+	if(lastDerivative.size() && lastEq == equation && lastState == state)
+		F0 = lastDerivative;
+	else
+		F0 = equation -> derivative(state);
+	
+	//the Jacobian is kept for the rejected attempts of the same step
+	if(jacEq != equation || jacState != state)
+	{
+		equation -> jacobian(state, J);
+		jacState = state;
+		jacEq = equation;
+	}
+	
+	std::vector<double> W(n*n);
+	std::vector<int> pivot;
+	for(i = 0; i < n*n; i++)
+		W[i] = -h*d*J[i];
+	for(i = 0; i < n; i++)
+		W[n*i + i] += 1.0;
+	luDecompose(W, n, pivot);
+	
+	k1 = luSolve(W, n, pivot, F0);
+	F1 = equation -> derivative(state + k1*h/2);
+	k2 = luSolve(W, n, pivot, F1 - k1) + k1;
+	nextState = state + h*k2;
+	F2 = equation -> derivative(nextState);
+	k3 = luSolve(W, n, pivot, F2 - e32*(k2 - F1) - 2.0*(k1 - F0));
+	
+	double error = equation -> errorNorm((k1 - 2.0*k2 + k3)*h/6);
+	
+	if(error != 0.0) stepSize = h*pow(maxErr/error, 1.0/3);
+	else stepSize = maxStep;
+	
+	if(stepSize < minStep) stepSize = minStep;
+	if(stepSize > maxStep) stepSize = maxStep;
+	if(stepSize < 0.8*h && step == 0.0)
+	{
+		rejections++;
+		return next(state, equation);
+	}
+	
+	lastStep = h;
+	lastError = error;
+	lastRejections = rejections;
+	rejections = 0;
+	stiffness = h*spectralRadius(J, n);
+	
+	//for optimization
+	lastDerivative = F2;
+	lastState = nextState;
+	lastEq = equation;
+	
+	return nextState;
+}
+
+double RosenbrockIntegrator::getMaxErr()
+{
+	return maxErr;
+}
+
+double RosenbrockIntegrator::getMinStep()
+{
+	return minStep;
+}
+
+double RosenbrockIntegrator::getMaxStep()
+{
+	return maxStep;
+}
+
+double RosenbrockIntegrator::getStiffness()
+{
+	return stiffness;
+}
+
+void RosenbrockIntegrator::setMaxErr(double mE)
+{
+	maxErr = mE;
+}
+
+void RosenbrockIntegrator::setMinStep(double mS)
+{
+	minStep = mS;
+}
+
+void RosenbrockIntegrator::setMaxStep(double mS)
+{
+	maxStep = mS;
+}
+
+DiffEq* RosenbrockIntegrator::getLastEquation()
+{
+	return lastDerivative.size() ? lastEq : NULL;
+}
+
+void RosenbrockIntegrator::setLastEquation(DiffEq* eq)
+{
+	lastEq = eq;
+}
+
+void RosenbrockIntegrator::saveState(StateWriter& w)
+{
+	Integrator::saveState(w);
+	w.putDouble(maxErr);
+	w.putDouble(minStep);
+	w.putDouble(maxStep);
+	w.putDouble(stiffness);
+	w.putInt(rejections);
+	w.putInt(lastDerivative.size());
+	if(lastDerivative.size()) w.putDoubles(&lastDerivative[0], lastDerivative.size());
+	w.putInt(lastState.size());
+	if(lastState.size()) w.putDoubles(&lastState[0], lastState.size());
+}
+
+void RosenbrockIntegrator::loadState(StateReader& r)
+{
+	Integrator::loadState(r);
+	maxErr = r.getDouble();
+	minStep = r.getDouble();
+	maxStep = r.getDouble();
+	stiffness = r.getDouble();
+	rejections = r.getInt();
+	int n = r.getInt();
+	if(n < 0 || (uint64_t)n*sizeof(double) > r.remaining()) throw "RosenbrockIntegrator: Invalid state.";
+	lastDerivative.resize(n);
+	if(n) r.getDoubles(&lastDerivative[0], n);
+	n = r.getInt();
+	if(n < 0 || (uint64_t)n*sizeof(double) > r.remaining()) throw "RosenbrockIntegrator: Invalid state.";
+	lastState.resize(n);
+	if(n) r.getDoubles(&lastState[0], n);
+	lastEq = NULL;
+	jacEq = NULL;
+}
@@ -0,0 +1,72 @@
+#ifndef __ROSENBROCKINTEGRATOR__
+#define __ROSENBROCKINTEGRATOR__
+
+/*! \file rosenbrockintegrator.h
+ * \brief Implementation of a linearly implicit Rosenbrock method for stiff equations
+ */
+ 
+ #include "numeric.h"
+
+/*! \class RosenbrockIntegrator
+ * \brief Class implementing an adaptive Rosenbrock-W numerical integrator of order 2(3).
+ *
+ * The method of Shampine and Reichelt (ode23s) - L-stable, with two evaluations of the derivative and one LU decomposition
+ * of W = 1 - h d J per step, where J is the Jacobian of the equation (DiffEq::jacobian). It stays of order 2 for an
+ * inexact Jacobian, so J is evaluated once per step and reused by the rejected attempts. The step size is controlled like
+ * in DPIntegrator, and the derivative at the end of a step is reused by the next one.
+ */
+class RosenbrockIntegrator : public Integrator
+{
+	double maxErr;
+	double minStep;
+	double maxStep;
+	
+	StateVector lastDerivative, lastState;
+	DiffEq* lastEq;
+	int rejections;	///< Rejections since the last accepted step
+	
+	std::vector<double> J;		///< The Jacobian at jacState
+	StateVector jacState;
+	DiffEq* jacEq;
+	double stiffness;	///< h times the spectral radius of J in the last step
+public:
+	//! Constructor
+	/*! \param maxErr The error margin - if the error is larger than this margin, the step size is decreased.
+	 *  \param stepSize Default step size
+	 *  \param minStep Minimal step size
+	 *  \param maxStep Maximal step size
+	 */
+	RosenbrockIntegrator(double maxErr = 0.000001, double stepSize = 0.01, double minStep = 0.0001, double maxStep = 0.1);
+	//! Destructor
+	~RosenbrockIntegrator();
+	//! Function calculating the next state
+	/*! \param state Current state
+	 *  \param equation The differential equation to be used
+	 *  \param step Step size. If 0 (default), the default step size is used.
+	 */
+	StateVector next(StateVector state, DiffEq* equation, double step = 0.0);
+	
+	//! Returns the error margin
+	double getMaxErr();
+	//! Returns the minimal step size
+	double getMinStep();
+	//! Returns the maximal step size
+	double getMaxStep();
+	//! Returns the estimate of h |lambda| of the last step - the step times the spectral radius of the Jacobian
+	double getStiffness();
+	
+	//! Sets the error margin
+	void setMaxErr(double);
+	//! Sets the minimal step size
+	void setMinStep(double);
+	//! Sets the maximal step size
+	void setMaxStep(double);
+	
+	DiffEq* getLastEquation();
+	void setLastEquation(DiffEq*);
+	//! Serializes the internal state, including the derivative at the end of the last step (the Jacobian is not kept)
+	void saveState(StateWriter&);
+	void loadState(StateReader&);
+};
+
+#endif
@@ -5,9 +5,6 @@ SchwManifold::SchwManifold(double _M)
 {
 	M = _M;
 	
-	gManifold = this;
-	Point::setGlobalManifold(this);
-	
 	nCoordSystems = 3;
 	
 	metrics = new Metric*[nCoordSystems];
@@ -56,7 +53,14 @@ double SchwManifold::getMass()
 
 void SchwManifold::setMass(double _M)
 {
+	if(_M == M) return;
 	M = _M;
+	clearCaches();
+}
+
+double SchwManifold::getHorizonRadius()
+{
+	return 2*M;
 }
 
 int SchwManifold::recommendCoordSystem(Point p)
@@ -77,12 +81,45 @@ int SchwManifold::recommendCoordSystem(Point p)
 	return -1;	//at this point apparently the point's coord system is invalid
 }
 
+SchwManifold* SchwManifold::clone()
+{
+	return new SchwManifold(M);
+}
+
+int SchwManifold::getNParameters()
+{
+	return 1;
+}
+
+double SchwManifold::getParameter(int i)
+{
+	if(i != 0) throw "SchwManifold: Index out of bounds.";
+	return M;
+}
+
+void SchwManifold::setParameter(int i, double value)
+{
+	if(i != 0) throw "SchwManifold: Index out of bounds.";
+	setMass(value);
+}
+
+void SchwManifold::saveState(StateWriter& w)
+{
+	w.putDouble(M);
+}
+
+void SchwManifold::loadState(StateReader& r)
+{
+	M = r.getDouble();
+	clearCaches();
+}
+
 /*
  * Metric in Eddington-Finkelstein coordinates
  */
  
 SchwEFMetric::SchwEFMetric(int cS, SchwManifold* _m)
-	: Metric(cS)
+	: Metric(cS, _m)
 { 
 	m = _m;
 }
@@ -91,6 +128,39 @@ SchwEFMetric::~SchwEFMetric()
 {
 }
 
+bool SchwEFMetric::isIgnorable(int i)
+{
+	return i == coordU || i == coordPhi;
+}
+
+void SchwEFMetric::principalDirections(Point p, double& re, double& im, vector4& l, vector4& n)
+{
+	Point pos = m->convertPointTo(p, coordSystem);
+	double M = m->getMass();
+	double r = pos[coordR];
+	
+	re = M/(r*r*r);
+	im = 0.0;
+	l = vector4(2.0, 1.0-2*M/r, 0.0, 0.0);
+	n = vector4(0.0, -1.0, 0.0, 0.0);
+}
+
+void SchwEFMetric::_riemann(Point p, double R[4][4][4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDRiemann(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), R);
+}
+
+void SchwEFMetric::_tidal(Point p, vector4 u, double K[4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDTidal(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), u, K);
+}
+
 double SchwEFMetric::_g(int i, int j, Point p)
 {
 	Point pos = m->convertPointTo(p, coordSystem);
@@ -207,7 +277,7 @@ double SchwEFMetric::_christoffel(int i, int j, int k, Point p)
  */
  
 SchwNearPoleMetric::SchwNearPoleMetric(int cS, SchwManifold* _m)
-	: Metric(cS)
+	: Metric(cS, _m)
 {
 	m = _m;
 }
@@ -216,6 +286,39 @@ SchwNearPoleMetric::~SchwNearPoleMetric()
 {
 }
 
+bool SchwNearPoleMetric::isIgnorable(int i)
+{
+	return i == coordU;
+}
+
+void SchwNearPoleMetric::principalDirections(Point p, double& re, double& im, vector4& l, vector4& n)
+{
+	Point pos = m->convertPointTo(p, coordSystem);
+	double M = m->getMass();
+	double r = pos[coordR];
+	
+	re = M/(r*r*r);
+	im = 0.0;
+	l = vector4(2.0, 1.0-2*M/r, 0.0, 0.0);
+	n = vector4(0.0, -1.0, 0.0, 0.0);
+}
+
+void SchwNearPoleMetric::_riemann(Point p, double R[4][4][4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDRiemann(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), R);
+}
+
+void SchwNearPoleMetric::_tidal(Point p, vector4 u, double K[4][4])
+{
+	double re, im;
+	vector4 l, n;
+	principalDirections(p, re, im, l, n);
+	typeDTidal(p, re, im, l, n, vector4(0.0, 0.0, 1.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), u, K);
+}
+
 
 double SchwNearPoleMetric::_g(int i, int j, Point p)
 {
@@ -19,9 +19,22 @@ public:
 	~SchwManifold();
 	
 	double getMass();
+	//! Sets the mass - the cached values of the metrics are removed if it changes
 	void setMass(double _M);
 	
+	//! Returns the radius of the event horizon (2M)
+	double getHorizonRadius();
+	
 	int recommendCoordSystem(Point);
+	SchwManifold* clone();
+	
+	//! Returns 1 - the parameter is the mass (0)
+	int getNParameters();
+	double getParameter(int i);
+	void setParameter(int i, double value);
+	
+	void saveState(StateWriter&);
+	void loadState(StateReader&);
 };
 
 /*! \class SchwEFMetric
@@ -34,12 +47,21 @@ protected:
 	double _g(int, int, Point);
 	double _invg(int, int, Point);
 	double _christoffel(int, int, int, Point);
+	//! The analytic Riemann tensor (Metric::typeDRiemann)
+	void _riemann(Point, double R[4][4][4][4]);
+	//! The analytic tidal tensor (Metric::typeDTidal)
+	void _tidal(Point, vector4, double K[4][4]);
+	//! The scalar Psi of the Weyl tensor and the principal null directions (Metric::typeDRiemann)
+	void principalDirections(Point, double& re, double& im, vector4& l, vector4& n);
 	
 public:
 	enum { coordU = 0, coordR = 1, coordTheta = 2, coordPhi = 3 };
 	
 	SchwEFMetric(int cS, SchwManifold* _m);
 	~SchwEFMetric();
+	
+	//! The metric does not depend on u and phi
+	bool isIgnorable(int i);
 };
 
 /*! \class SchwNearPoleMetric
@@ -52,12 +74,21 @@ protected:
 	double _g(int, int, Point);
 	double _invg(int, int, Point);
 	double _christoffel(int, int, int, Point);
+	//! The analytic Riemann tensor (Metric::typeDRiemann)
+	void _riemann(Point, double R[4][4][4][4]);
+	//! The analytic tidal tensor (Metric::typeDTidal)
+	void _tidal(Point, vector4, double K[4][4]);
+	//! The scalar Psi of the Weyl tensor and the principal null directions (Metric::typeDRiemann)
+	void principalDirections(Point, double& re, double& im, vector4& l, vector4& n);
 	
 public:
 	enum { coordU = 0, coordR = 1, coordX = 2, coordY = 3 };
 	
 	SchwNearPoleMetric(int cS, SchwManifold* _m);
 	~SchwNearPoleMetric();
+	
+	//! The metric does not depend on u
+	bool isIgnorable(int i);
 };
 
 #endif
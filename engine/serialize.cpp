@@ -0,0 +1,106 @@
+#include "serialize.h"
+#include <string.h>
+
+/*******************************************************************************
+ *
+ *  StateWriter class implementation
+ *
+ *******************************************************************************/
+
+StateWriter::StateWriter()
+{
+}
+
+StateWriter::~StateWriter()
+{
+}
+
+void StateWriter::putDouble(double x)
+{
+	putBytes(&x, sizeof(x));
+}
+
+void StateWriter::putDoubles(const double* x, int n)
+{
+	putBytes(x, n*sizeof(double));
+}
+
+void StateWriter::putInt(int32_t x)
+{
+	putBytes(&x, sizeof(x));
+}
+
+void StateWriter::putUInt64(uint64_t x)
+{
+	putBytes(&x, sizeof(x));
+}
+
+void StateWriter::putBytes(const void* bytes, int n)
+{
+	const char* c = (const char*)bytes;
+	data.insert(data.end(), c, c + n);
+}
+
+const std::vector<char>& StateWriter::getData()
+{
+	return data;
+}
+
+void StateWriter::clear()
+{
+	data.clear();
+}
+
+/*******************************************************************************
+ *
+ *  StateReader class implementation
+ *
+ *******************************************************************************/
+
+StateReader::StateReader(const char* data, uint64_t size)
+{
+	p = data;
+	end = data + size;
+}
+
+StateReader::~StateReader()
+{
+}
+
+double StateReader::getDouble()
+{
+	double x;
+	getBytes(&x, sizeof(x));
+	return x;
+}
+
+void StateReader::getDoubles(double* x, int n)
+{
+	getBytes(x, n*sizeof(double));
+}
+
+int32_t StateReader::getInt()
+{
+	int32_t x;
+	getBytes(&x, sizeof(x));
+	return x;
+}
+
+uint64_t StateReader::getUInt64()
+{
+	uint64_t x;
+	getBytes(&x, sizeof(x));
+	return x;
+}
+
+void StateReader::getBytes(void* bytes, int n)
+{
+	if(n < 0 || end - p < n) throw "StateReader: Unexpected end of the data.";
+	memcpy(bytes, p, n);
+	p += n;
+}
+
+uint64_t StateReader::remaining()
+{
+	return end - p;
+}
@@ -0,0 +1,75 @@
+#ifndef __SERIALIZE_H__
+#define __SERIALIZE_H__
+
+/*! \file serialize.h
+ * \brief Binary serialization of the internal state of the simulation objects
+ *
+ * The values are stored in the native byte order, without any conversion, so that restoring them is bit-exact.
+ */
+
+#include <vector>
+#include <stdint.h>
+
+/*! \class StateWriter
+ * \brief Buffer collecting the serialized state
+ */
+class StateWriter
+{
+	std::vector<char> data;
+public:
+	//! Constructor - an empty buffer
+	StateWriter();
+	//! Destructor
+	~StateWriter();
+
+	//! Appends a double
+	void putDouble(double);
+	//! Appends an array of doubles
+	void putDoubles(const double*, int n);
+	//! Appends an integer
+	void putInt(int32_t);
+	//! Appends a 64-bit unsigned integer
+	void putUInt64(uint64_t);
+	//! Appends raw bytes
+	void putBytes(const void*, int n);
+
+	//! Returns the collected data
+	const std::vector<char>& getData();
+	//! Removes the collected data
+	void clear();
+};
+
+/*! \class StateReader
+ * \brief Reads the serialized state from a buffer
+ *
+ * Reading past the end of the buffer throws an exception.
+ */
+class StateReader
+{
+	const char* p;
+	const char* end;
+public:
+	//! Constructor
+	/*! \param data The serialized state (not copied)
+	 *  \param size Size of the data in bytes
+	 */
+	StateReader(const char* data, uint64_t size);
+	//! Destructor
+	~StateReader();
+
+	//! Reads a double
+	double getDouble();
+	//! Reads an array of doubles
+	void getDoubles(double*, int n);
+	//! Reads an integer
+	int32_t getInt();
+	//! Reads a 64-bit unsigned integer
+	uint64_t getUInt64();
+	//! Reads raw bytes
+	void getBytes(void*, int n);
+
+	//! Returns the number of the remaining bytes
+	uint64_t remaining();
+};
+
+#endif
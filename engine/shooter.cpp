@@ -0,0 +1,517 @@
+#include "shooter.h"
+#include "dpintegrator.h"
+#include <math.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+//halvings of a Newton step before a candidate is abandoned
+static const int maxHalvings = 10;
+
+//orthonormal frame at a point built from the coordinate basis, the time coordinate first
+static void coordinateFrame(Metric* g, Point p, vector4* e)
+{
+	int i, j;
+	if(g->g(0, 0, p) <= 0.0) throw "GeodesicShooter: The time coordinate is not timelike.";
+	for(i = 0; i < 4; i++)
+	{
+		e[i] = vector4(0.0, 0.0, 0.0, 0.0);
+		e[i][i] = 1.0;
+		for(j = 0; j < i; j++)
+			e[i] -= g->g(e[i], e[j], p) * e[j] / g->g(e[j], e[j], p);
+		e[i] /= sqrt(fabs(g->g(e[i], e[i], p)));
+	}
+}
+
+//two unit vectors orthogonal to a unit vector and to each other
+static void tangents(const double* n, double* t1, double* t2)
+{
+	int i, k = 0;
+	for(i = 1; i < 3; i++)
+		if(fabs(n[i]) < fabs(n[k])) k = i;
+	double len = 0.0;
+	for(i = 0; i < 3; i++)
+	{
+		t1[i] = ((i == k) ? 1.0 : 0.0) - n[k]*n[i];
+		len += t1[i]*t1[i];
+	}
+	len = sqrt(len);
+	for(i = 0; i < 3; i++)
+		t1[i] /= len;
+	t2[0] = n[1]*t1[2] - n[2]*t1[1];
+	t2[1] = n[2]*t1[0] - n[0]*t1[2];
+	t2[2] = n[0]*t1[1] - n[1]*t1[0];
+}
+
+//solves A x = b by Gaussian elimination with partial pivoting, false if A is singular
+static bool solveLinear(double A[4][4], double* b, int n, double* x)
+{
+	double a[4][5];
+	int i, j, k;
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < n; j++)
+			a[i][j] = A[i][j];
+		a[i][n] = b[i];
+	}
+	for(k = 0; k < n; k++)
+	{
+		int pivot = k;
+		for(i = k + 1; i < n; i++)
+			if(fabs(a[i][k]) > fabs(a[pivot][k])) pivot = i;
+		if(a[pivot][k] == 0.0 || !isfinite(a[pivot][k])) return false;
+		for(j = k; j <= n; j++)
+			std::swap(a[k][j], a[pivot][j]);
+		for(i = k + 1; i < n; i++)
+		{
+			double f = a[i][k]/a[k][k];
+			for(j = k; j <= n; j++)
+				a[i][j] -= f*a[k][j];
+		}
+	}
+	for(i = n - 1; i >= 0; i--)
+	{
+		x[i] = a[i][n];
+		for(j = i + 1; j < n; j++)
+			x[i] -= a[i][j]*x[j];
+		x[i] /= a[i][i];
+	}
+	return true;
+}
+
+static bool earlierArrival(ShootingSolution a, ShootingSolution b)
+{
+	return a.end[0] < b.end[0];
+}
+
+static bool shorterTime(ShootingSolution a, ShootingSolution b)
+{
+	return a.parameter < b.parameter;
+}
+
+GeodesicShooter::GeodesicShooter(Manifold* _m)
+{
+	m = _m;
+	periods.assign(4, 0.0);
+	maxErr = 1e-10;
+	maxStep = 10.0;
+	tolerance = 1e-8;
+	maxParameter = 1000.0;
+	maxIterations = 30;
+	nCandidates = 64;
+	nThreads = 0;
+	threadsUsed = 0;
+	timelike = false;
+	nUnknowns = 3;
+	totalTime = 0.0;
+}
+
+GeodesicShooter::~GeodesicShooter()
+{
+}
+
+void GeodesicShooter::addStopCondition(StopCondition* c)
+{
+	stopConditions.push_back(c);
+}
+
+void GeodesicShooter::setPeriodic(int coordinate, double period)
+{
+	if(coordinate < 0 || coordinate >= 4) throw "GeodesicShooter: Index out of bounds.";
+	periods[coordinate] = period;
+}
+
+void GeodesicShooter::setIntegrator(double _maxErr, double _maxStep)
+{
+	maxErr = _maxErr;
+	maxStep = _maxStep;
+}
+
+void GeodesicShooter::setTolerance(double t)
+{
+	tolerance = t;
+}
+
+void GeodesicShooter::setMaxParameter(double p)
+{
+	maxParameter = p;
+}
+
+void GeodesicShooter::setMaxIterations(int n)
+{
+	maxIterations = n;
+}
+
+void GeodesicShooter::setCandidates(int n)
+{
+	nCandidates = (n > 0) ? n : 1;
+}
+
+void GeodesicShooter::setThreads(int n)
+{
+	nThreads = n;
+}
+
+void GeodesicShooter::initialVelocity(const double* d, vector4& u, vector4* du)
+{
+	int i;
+	if(timelike)
+	{
+		//u = sqrt(1 + w^2) e0 + w^i e_i
+		double gamma = sqrt(1.0 + d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+		u = gamma*sourceFrame[0];
+		for(i = 0; i < 3; i++)
+		{
+			u += d[i]*sourceFrame[i + 1];
+			du[i] = d[i]/gamma*sourceFrame[0] + sourceFrame[i + 1];
+		}
+	}
+	else
+	{
+		//u = e0 + n^i e_i, the direction varied along the tangents of the sphere
+		double t1[3], t2[3];
+		tangents(d, t1, t2);
+		u = sourceFrame[0];
+		du[0] = du[1] = vector4(0.0, 0.0, 0.0, 0.0);
+		for(i = 0; i < 3; i++)
+		{
+			u += d[i]*sourceFrame[i + 1];
+			du[0] += t1[i]*sourceFrame[i + 1];
+			du[1] += t2[i]*sourceFrame[i + 1];
+		}
+	}
+}
+
+void GeodesicShooter::applyStep(const double* d0, double lambda0, const double* step, double factor, double* d, double& lambda)
+{
+	int i;
+	if(timelike)
+	{
+		for(i = 0; i < 3; i++)
+			d[i] = d0[i] + factor*step[i];
+	}
+	else
+	{
+		double t1[3], t2[3], len = 0.0;
+		tangents(d0, t1, t2);
+		for(i = 0; i < 3; i++)
+		{
+			d[i] = d0[i] + factor*(step[0]*t1[i] + step[1]*t2[i]);
+			len += d[i]*d[i];
+		}
+		len = sqrt(len);
+		for(i = 0; i < 3; i++)
+			d[i] /= len;
+	}
+	lambda = lambda0 + factor*step[nUnknowns - 1];
+}
+
+void GeodesicShooter::residual(Point p, double* R)
+{
+	int i;
+	for(i = 0; i < nUnknowns; i++)
+	{
+		int c = timelike ? i : i + 1;
+		R[i] = p[c] - target[c];
+		if(periods[c] > 0.0) R[i] -= periods[c]*floor(R[i]/periods[c] + 0.5);
+	}
+}
+
+double GeodesicShooter::distance(const double* R)
+{
+	int a, i;
+	double result = 0.0;
+	for(a = 0; a < 4; a++)
+	{
+		double c = 0.0;
+		for(i = 0; i < nUnknowns; i++)
+			c += targetForms[a][timelike ? i : i + 1]*R[i];
+		result += c*c;
+	}
+	return sqrt(result);
+}
+
+bool GeodesicShooter::scan(Manifold* man, const double* d, double& lambda)
+{
+	vector4 u, du[3];
+	initialVelocity(d, u, du);
+	Particle particle(man, source, u);
+	DPIntegrator dp(maxErr, 0.01, 1e-6, maxStep);
+	particle.setIntegrator(&dp);
+	unsigned int i;
+	for(i = 0; i < stopConditions.size(); i++)
+		particle.addStopCondition(stopConditions[i]);
+
+	bool found = false;
+	double best = 0.0, R[4];
+	int chart = target.getCoordSystem();
+	while(particle.getProperTime() < maxParameter)
+	{
+		if(particle.getProperTime() + dp.getStepSize() > maxParameter) particle.propagate(maxParameter - particle.getProperTime());
+		else particle.propagate();
+		if(particle.isStopped()) break;
+		residual(man->convertPointTo(particle.getPos(), chart), R);
+		double dist = distance(R);
+		if(!isfinite(dist)) break;
+		if(!found || dist < best)
+		{
+			found = true;
+			best = dist;
+			lambda = particle.getProperTime();
+		}
+	}
+	return found;
+}
+
+bool GeodesicShooter::shoot(Manifold* man, const double* d, double lambda, double* R, double J[4][4], ShootingSolution* s)
+{
+	vector4 u, du[3];
+	initialVelocity(d, u, du);
+	VariationalParticle particle(man, source, u);
+	DPIntegrator dp(maxErr, 0.01, 1e-6, maxStep);
+	particle.setIntegrator(&dp);
+	unsigned int n;
+	for(n = 0; n < stopConditions.size(); n++)
+		particle.addStopCondition(stopConditions[n]);
+
+	while(particle.getProperTime() < lambda)
+	{
+		if(particle.getProperTime() + dp.getStepSize() > lambda) particle.propagate(lambda - particle.getProperTime());
+		else particle.propagate();
+		if(particle.isStopped()) return false;
+	}
+
+	//the residual and its derivatives in the coordinate system of the target
+	int chart = target.getCoordSystem();
+	Point p = particle.getPos();
+	vector4 v = particle.getVel();
+	double C[8][8];
+	int i, j, k, l;
+	stateConversionJacobian(man, p, v, chart, C);
+	s->u = u;
+	s->parameter = lambda;
+	s->endVel = man->convertVectorTo(v, p, chart);
+	s->end = man->convertPointTo(p, chart);
+	residual(s->end, R);
+
+	for(i = 0; i < nUnknowns; i++)
+	{
+		int c = timelike ? i : i + 1;
+		if(!isfinite(R[i])) return false;
+		for(j = 0; j < nUnknowns; j++)
+		{
+			J[i][j] = 0.0;
+			for(k = 0; k < 4; k++)
+			{
+				double dx = 0.0;
+				if(j < nUnknowns - 1)
+				{
+					for(l = 0; l < 4; l++)
+						dx += particle.getTransition(k, l + 4)*du[j][l];
+				}
+				else dx = v[k];
+				J[i][j] += C[c][k]*dx;
+			}
+			if(!isfinite(J[i][j])) return false;
+		}
+	}
+	return true;
+}
+
+void GeodesicShooter::solveCandidate(Manifold* man, int n)
+{
+	try
+	{
+		double d[3], d0[3], lambda, lambda0 = 0.0;
+		int i;
+		for(i = 0; i < 3; i++)
+			d[i] = starts[3*n + i];
+		if(!scan(man, d, lambda)) return;
+
+		double R[4], J[4][4], step[4], best = 0.0, factor = 1.0;
+		int it, halvings = 0;
+		ShootingSolution s;
+		for(it = 0; it < maxIterations; it++)
+		{
+			bool ok = lambda > 0.0 && lambda <= maxParameter && shoot(man, d, lambda, R, J, &s);
+			double dist = ok ? distance(R) : 0.0;
+			if(it > 0 && (!ok || dist >= best))
+			{
+				//the step did not bring the geodesic closer - try half of it
+				if(++halvings > maxHalvings) return;
+				factor /= 2;
+				applyStep(d0, lambda0, step, factor, d, lambda);
+				continue;
+			}
+			if(!ok) return;
+			if(dist < tolerance)
+			{
+				s.distance = dist;
+				s.iterations = it + 1;
+				candidates[n] = s;
+				converged[n] = 1;
+				return;
+			}
+
+			best = dist;
+			halvings = 0;
+			factor = 1.0;
+			for(i = 0; i < 3; i++)
+				d0[i] = d[i];
+			lambda0 = lambda;
+			for(i = 0; i < nUnknowns; i++)
+				R[i] = -R[i];
+			if(!solveLinear(J, R, nUnknowns, step)) return;
+
+			//limits of a single step - the change of the direction and the relative change of the parameter
+			double len = 0.0, limit = 0.5;
+			for(i = 0; i < nUnknowns - 1; i++)
+				len += step[i]*step[i];
+			len = sqrt(len);
+			if(timelike) limit *= 1.0 + sqrt(d0[0]*d0[0] + d0[1]*d0[1] + d0[2]*d0[2]);
+			double scale = 1.0;
+			if(len > limit) scale = limit/len;
+			if(fabs(step[nUnknowns - 1])*scale > 0.5*lambda0) scale = 0.5*lambda0/fabs(step[nUnknowns - 1]);
+			for(i = 0; i < nUnknowns; i++)
+				step[i] *= scale;
+			applyStep(d0, lambda0, step, 1.0, d, lambda);
+		}
+	}
+	catch(...)
+	{
+		//a failed candidate (e.g. an invalid coordinate conversion) stays not converged and must not bring down the search
+	}
+}
+
+void GeodesicShooter::worker(Manifold* man, std::atomic<int>* next)
+{
+	int i, n = candidates.size();
+	while((i = (*next)++) < n)
+		solveCandidate(man, i);
+}
+
+int GeodesicShooter::find(Point _source, Point _target, bool _timelike)
+{
+	int i, j, k;
+	source = _source;
+	target = _target;
+	timelike = _timelike;
+	nUnknowns = timelike ? 4 : 3;
+
+	coordinateFrame(m->getMetric(source.getCoordSystem()), source, sourceFrame);
+	vector4 e[4];
+	Metric* g = m->getMetric(target.getCoordSystem());
+	coordinateFrame(g, target, e);
+	for(i = 0; i < 4; i++)
+		for(j = 0; j < 4; j++)
+		{
+			targetForms[i][j] = 0.0;
+			for(k = 0; k < 4; k++)
+				targetForms[i][j] += g->g(j, k, target)*e[i][k];
+		}
+
+	//directions spread over the sphere (Fibonacci lattice), with 3 speeds for timelike geodesics
+	starts.clear();
+	double speeds[3] = { 0.1, 0.3, 0.6 };
+	int nSpeeds = timelike ? 3 : 1;
+	for(i = 0; i < nCandidates; i++)
+	{
+		double z = 1.0 - (2*i + 1.0)/nCandidates;
+		double rho = sqrt(1.0 - z*z);
+		double phi = i*M_PI*(3.0 - sqrt(5.0));
+		for(j = 0; j < nSpeeds; j++)
+		{
+			double w = timelike ? speeds[j]/sqrt(1.0 - speeds[j]*speeds[j]) : 1.0;
+			starts.push_back(w*rho*cos(phi));
+			starts.push_back(w*rho*sin(phi));
+			starts.push_back(w*z);
+		}
+	}
+	int total = starts.size()/3;
+	candidates.assign(total, ShootingSolution());
+	converged.assign(total, 0);
+
+	int n = nThreads;
+	if(n <= 0) n = std::thread::hardware_concurrency();
+	if(n > total) n = total;
+	if(n < 1) n = 1;
+
+	//every thread needs its own manifold - the metrics cache their values
+	std::vector<Manifold*> copies;
+	copies.push_back(m);
+	for(i = 1; i < n; i++)
+	{
+		Manifold* c = m->clone();
+		if(!c) break;
+		copies.push_back(c);
+	}
+	threadsUsed = copies.size();
+
+	std::atomic<int> next(0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for(i = 1; i < threadsUsed; i++)
+		threads.push_back(std::thread(&GeodesicShooter::worker, this, copies[i], &next));
+	worker(m, &next);
+	for(i = 0; i < (int)threads.size(); i++)
+		threads[i].join();
+
+	totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for(i = 1; i < threadsUsed; i++)
+		delete copies[i];
+
+	//the candidates converging to the same geodesic have the same initial 4-velocity and arrival time
+	solutions.clear();
+	for(i = 0; i < total; i++)
+	{
+		if(!converged[i]) continue;
+		ShootingSolution& s = candidates[i];
+		bool known = false;
+		for(j = 0; j < (int)solutions.size() && !known; j++)
+		{
+			double du = 0.0, scale = 0.0;
+			for(k = 0; k < 4; k++)
+			{
+				du += fabs(s.u[k] - solutions[j].u[k]);
+				scale += fabs(s.u[k]);
+			}
+			known = du < 1e-5*scale && fabs(s.end[0] - solutions[j].end[0]) < 1e-5*(1.0 + fabs(s.end[0]));
+		}
+		if(!known) solutions.push_back(s);
+	}
+	std::sort(solutions.begin(), solutions.end(), timelike ? shorterTime : earlierArrival);
+	return solutions.size();
+}
+
+int GeodesicShooter::findNull(Point _source, Point _target)
+{
+	return find(_source, _target, false);
+}
+
+int GeodesicShooter::findTimelike(Point _source, Point _target)
+{
+	return find(_source, _target, true);
+}
+
+int GeodesicShooter::getNSolutions()
+{
+	return solutions.size();
+}
+
+ShootingSolution GeodesicShooter::getSolution(int i)
+{
+	if(i < 0 || i >= (int)solutions.size()) throw "GeodesicShooter: Index out of bounds.";
+	return solutions[i];
+}
+
+int GeodesicShooter::getThreadsUsed()
+{
+	return threadsUsed;
+}
+
+double GeodesicShooter::getTime()
+{
+	return totalTime;
+}
@@ -0,0 +1,143 @@
+#ifndef __SHOOTER_H__
+#define __SHOOTER_H__
+
+/*! \file shooter.h
+ * \brief Solving the two-point boundary value problem for geodesics by shooting
+ */
+
+#include "variational.h"
+#include "stopcondition.h"
+#include <vector>
+#include <atomic>
+
+/*! \struct ShootingSolution
+ * \brief A geodesic connecting the source with the target
+ */
+struct ShootingSolution
+{
+	vector4 u;			///< The initial 4-velocity (in the coordinate system of the source)
+	double parameter;	///< The affine parameter (proper time for timelike geodesics) at the target
+	Point end;			///< The final position (in the coordinate system of the target)
+	vector4 endVel;		///< The final 4-velocity (in the coordinate system of the target)
+	double distance;	///< The distance of the final position from the target (in the local frame of the target)
+	int iterations;		///< Newton iterations needed
+};
+
+/*! \class GeodesicShooter
+ * \brief Finds the geodesics connecting a source event with a target
+ *
+ * Null geodesics connect the source event with the worldline of a target at rest in its coordinates - the spatial coordinates
+ * of the target are matched, and the arrival time is a result. Timelike geodesics connect two events - all coordinates are
+ * matched. The unknowns are the initial direction (the speed too for timelike geodesics) in the orthonormal frame of the
+ * source built from its coordinate basis, and the affine parameter (proper time) at the target.
+ *
+ * The directions of the candidate geodesics are spread uniformly over the sphere. Every candidate is propagated up to the
+ * maximal parameter, and the point of its closest approach to the target gives the initial guess of the parameter. Newton's
+ * method then solves for the unknowns, with the Jacobian from the variational equations (VariationalParticle), halving the
+ * steps which do not decrease the distance. Several candidates usually converge to the same geodesic - the distinct solutions
+ * (e.g. the multiple images of a lensed source) are kept, ordered by the arrival time (null) or by the proper time
+ * (timelike). The candidates are processed in parallel - every thread has its own copy of the manifold (Manifold::clone).
+ *
+ * The distances are measured in the orthonormal frame of the target built from its coordinate basis, so the time coordinate
+ * (coordinate 0) must be timelike at the source and at the target.
+ */
+class GeodesicShooter
+{
+	Manifold* m;
+	std::vector<StopCondition*> stopConditions;
+	std::vector<double> periods;
+	double maxErr, maxStep;
+	double tolerance;
+	double maxParameter;
+	int maxIterations;
+	int nCandidates;
+	int nThreads, threadsUsed;
+
+	bool timelike;
+	int nUnknowns;		///< 3 (direction, parameter) for null geodesics, 4 (velocity, proper time) for timelike ones
+	Point source, target;
+	vector4 sourceFrame[4];	///< Orthonormal frame of the source
+	double targetForms[4][4];	///< Orthonormal frame of the target with the index lowered - [a][i]
+	std::vector<double> starts;	///< Initial directions of the candidates - 3 per candidate
+	std::vector<ShootingSolution> candidates;
+	std::vector<int> converged;
+	std::vector<ShootingSolution> solutions;
+	double totalTime;
+
+	GeodesicShooter(const GeodesicShooter&);
+	GeodesicShooter& operator=(const GeodesicShooter&);
+
+	//! The initial 4-velocity and its derivatives with respect to the unknowns of the direction
+	/*! \param d The direction - a unit vector in the frame of the source (null), or the spatial velocity in it (timelike)
+	 */
+	void initialVelocity(const double* d, vector4& u, vector4* du);
+	//! Changes the direction and the parameter by a Newton step multiplied by a factor
+	void applyStep(const double* d0, double lambda0, const double* step, double factor, double* d, double& lambda);
+	//! Differences of the coordinates of a point from the target (the time coordinate is skipped for null geodesics)
+	void residual(Point p, double* R);
+	//! Length of a coordinate difference in the frame of the target
+	double distance(const double* R);
+	//! Propagates a geodesic up to a parameter, with the residual and its Jacobian with respect to the unknowns
+	/*! \return false if the geodesic was stopped or is not finite
+	 */
+	bool shoot(Manifold* man, const double* d, double lambda, double* R, double J[4][4], ShootingSolution* s);
+	//! Finds the parameter of the closest approach to the target
+	/*! \return false if the geodesic was stopped before reaching any point
+	 */
+	bool scan(Manifold* man, const double* d, double& lambda);
+	//! Solves for a single candidate - a candidate whose geodesic throws stays not converged
+	void solveCandidate(Manifold* man, int i);
+	//! Worker thread - solves the candidates until there are none left
+	void worker(Manifold* man, std::atomic<int>* next);
+	//! Runs the search
+	int find(Point _source, Point _target, bool _timelike);
+public:
+	//! Constructor
+	/*! \param _m The manifold - the parallel search needs clone()
+	 */
+	GeodesicShooter(Manifold* _m);
+	//! Destructor
+	~GeodesicShooter();
+
+	//! Adds a condition ending the propagation (e.g. the horizon) - a stopped geodesic is not a solution
+	/*! The condition is not owned by the shooter, and it is used by all threads at once.
+	 */
+	void addStopCondition(StopCondition*);
+	//! Makes a coordinate periodic (e.g. an azimuthal angle) - its differences are reduced to (-period/2, period/2]
+	void setPeriodic(int coordinate, double period);
+	//! Sets the error tolerance and the maximal step of the Dormand-Prince integrator (default 1e-10 and 10)
+	void setIntegrator(double _maxErr, double _maxStep);
+	//! Sets the distance from the target at which a solution is accepted (default 1e-8)
+	void setTolerance(double);
+	//! Sets the maximal affine parameter (proper time) of the search (default 1000)
+	void setMaxParameter(double);
+	//! Sets the maximal number of Newton iterations per candidate (default 30)
+	void setMaxIterations(int);
+	//! Sets the number of candidate directions (default 64)
+	void setCandidates(int);
+	//! Sets the number of threads (0 - default, one per hardware thread)
+	void setThreads(int);
+
+	//! Finds the null geodesics from an event to the worldline of a target at rest
+	/*! \param _source The source event
+	 *  \param _target The position of the target (the time coordinate is ignored)
+	 *  \return The number of the solutions found
+	 */
+	int findNull(Point _source, Point _target);
+	//! Finds the timelike geodesics connecting two events
+	/*! The candidates have the speeds 0.1, 0.3 and 0.6 in the frame of the source in every direction.
+	 *  \return The number of the solutions found
+	 */
+	int findTimelike(Point _source, Point _target);
+
+	//! Returns the number of the solutions
+	int getNSolutions();
+	//! Returns a solution (ordered by the arrival time for null geodesics, by the proper time for timelike ones)
+	ShootingSolution getSolution(int i);
+	//! Returns the number of threads used in the last search
+	int getThreadsUsed();
+	//! Returns the time of the last search in seconds
+	double getTime();
+};
+
+#endif
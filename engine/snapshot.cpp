@@ -0,0 +1,259 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static_assert(sizeof(SnapshotFrameHeader) == 32, "SnapshotFrameHeader must have no padding");
+
+//FNV-1a hash of the frame, detects frames which were not written completely
+static uint64_t checksum(const char* data, uint64_t size)
+{
+	uint64_t h = 14695981039346656037ull;
+	uint64_t i;
+	for(i = 0; i < size; i++)
+	{
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+Snapshot::Snapshot()
+{
+	seq = 0;
+	writeOk = true;
+	lastFrameSize = 0;
+}
+
+Snapshot::~Snapshot()
+{
+	wait();
+}
+
+void Snapshot::addManifold(Manifold* m)
+{
+	manifolds.push_back(m);
+	written.clear();
+}
+
+void Snapshot::addIntegrator(Integrator* i)
+{
+	integrators.push_back(i);
+	written.clear();
+}
+
+void Snapshot::addParticle(Particle* p)
+{
+	particles.push_back(p);
+	written.clear();
+}
+
+void Snapshot::capture(std::vector<std::vector<char> >& states)
+{
+	unsigned i, j;
+	StateWriter w;
+	states.clear();
+
+	for(i = 0; i < manifolds.size(); i++)
+	{
+		w.clear();
+		manifolds[i]->saveState(w);
+		states.push_back(w.getData());
+	}
+	for(i = 0; i < integrators.size(); i++)
+	{
+		w.clear();
+		//the derivative kept by the integrator belongs to one of the particles - it is stored as its index
+		DiffEq* eq = integrators[i]->getLastEquation();
+		int32_t owner = -1;
+		for(j = 0; j < particles.size(); j++)
+			if(eq && eq == (DiffEq*)particles[j]) owner = j;
+		w.putInt(owner);
+		integrators[i]->saveState(w);
+		states.push_back(w.getData());
+	}
+	for(i = 0; i < particles.size(); i++)
+	{
+		w.clear();
+		particles[i]->saveState(w);
+		states.push_back(w.getData());
+	}
+}
+
+void Snapshot::apply(std::vector<std::vector<char> >& states)
+{
+	unsigned i, k = 0;
+	for(i = 0; i < manifolds.size(); i++, k++)
+	{
+		StateReader r(states[k].data(), states[k].size());
+		manifolds[i]->loadState(r);
+	}
+	for(i = 0; i < integrators.size(); i++, k++)
+	{
+		StateReader r(states[k].data(), states[k].size());
+		int32_t owner = r.getInt();
+		integrators[i]->loadState(r);
+		if(owner >= 0 && owner < (int32_t)particles.size())
+			integrators[i]->setLastEquation(particles[owner]);
+	}
+	for(i = 0; i < particles.size(); i++, k++)
+	{
+		StateReader r(states[k].data(), states[k].size());
+		particles[i]->loadState(r);
+	}
+}
+
+bool Snapshot::save(const char* file)
+{
+	bool ok = wait();
+
+	std::vector<std::vector<char> > states;
+	capture(states);
+
+	//a new file (or a changed set of objects) starts with all of them
+	bool full = (filename != file) || (written.size() != states.size());
+	if(full) seq = 0;
+
+	SnapshotFrameHeader header;
+	memcpy(header.magic, "GRSF", 4);
+	header.version = 2;
+	header.nObjects = states.size();
+	header.nEntries = 0;
+	header.seq = seq;
+	header.size = 0;
+
+	pending.assign(sizeof(header), 0);
+	unsigned i;
+	for(i = 0; i < states.size(); i++)
+	{
+		if(!full && states[i] == written[i]) continue;
+		uint32_t entry[2] = { i, (uint32_t)states[i].size() };
+		pending.insert(pending.end(), (char*)entry, (char*)entry + sizeof(entry));
+		pending.insert(pending.end(), states[i].begin(), states[i].end());
+		header.nEntries++;
+	}
+	header.size = pending.size() - sizeof(header);
+	memcpy(&pending[0], &header, sizeof(header));
+	uint64_t sum = checksum(&pending[0], pending.size());
+	pending.insert(pending.end(), (char*)&sum, (char*)&sum + sizeof(sum));
+	lastFrameSize = pending.size();
+
+	written.swap(states);
+	filename = file;
+	seq++;
+
+	writer = std::thread(&Snapshot::writeFrame, this, filename, full);
+	return ok;
+}
+
+void Snapshot::writeFrame(std::string file, bool full)
+{
+	//a full frame replaces the file - it is written to a temporary file first, so that the old checkpoints survive a failure
+	std::string target = full ? file + ".tmp" : file;
+	FILE* f = fopen(target.c_str(), full ? "wb" : "ab");
+	if(!f)
+	{
+		writeOk = false;
+		return;
+	}
+	bool ok = fwrite(&pending[0], 1, pending.size(), f) == pending.size();
+	if(full) ok = ok && (fflush(f) == 0) && (fsync(fileno(f)) == 0);
+	ok = (fclose(f) == 0) && ok;
+	if(full)
+	{
+		if(ok) ok = (rename(target.c_str(), file.c_str()) == 0);
+		else remove(target.c_str());
+	}
+	writeOk = ok;
+}
+
+bool Snapshot::wait()
+{
+	if(writer.joinable()) writer.join();
+	bool ok = writeOk;
+	writeOk = true;
+	return ok;
+}
+
+bool Snapshot::restore(const char* file, int frame)
+{
+	wait();
+
+	FILE* f = fopen(file, "rb");
+	if(!f) return false;
+	std::vector<char> data;
+	char buffer[1 << 16];
+	size_t n;
+	while((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		data.insert(data.end(), buffer, buffer + n);
+	fclose(f);
+
+	uint64_t nObjects = manifolds.size() + integrators.size() + particles.size();
+	std::vector<std::vector<char> > states(nObjects);
+	std::vector<bool> present(nObjects, false);
+	uint64_t pos = 0;
+	int frames = 0;
+
+	//the frames are applied one over another
+	while(pos + sizeof(SnapshotFrameHeader) + sizeof(uint64_t) <= data.size() && (frame < 0 || frames <= frame))
+	{
+		SnapshotFrameHeader header;
+		memcpy(&header, &data[pos], sizeof(header));
+		if(memcmp(header.magic, "GRSF", 4) != 0 || header.version != 2 || header.nObjects != nObjects) break;
+		if(header.size > data.size() - pos - sizeof(header) - sizeof(uint64_t)) break;
+
+		uint64_t end = pos + sizeof(header) + header.size;
+		uint64_t sum;
+		memcpy(&sum, &data[end], sizeof(sum));
+		if(sum != checksum(&data[pos], end - pos)) break;
+
+		uint64_t p = pos + sizeof(header);
+		uint32_t i;
+		bool ok = true;
+		for(i = 0; i < header.nEntries && ok; i++)
+		{
+			uint32_t entry[2];
+			if(p + sizeof(entry) > end)
+			{
+				ok = false;
+				break;
+			}
+			memcpy(entry, &data[p], sizeof(entry));
+			p += sizeof(entry);
+			if(entry[0] >= nObjects || p + entry[1] > end)
+			{
+				ok = false;
+				break;
+			}
+			states[entry[0]].assign(data.begin() + p, data.begin() + p + entry[1]);
+			present[entry[0]] = true;
+			p += entry[1];
+		}
+		if(!ok) return false;
+
+		pos = end + sizeof(sum);
+		frames++;
+	}
+
+	if(frames == 0 || (frame >= 0 && frames <= frame)) return false;
+	uint64_t i;
+	for(i = 0; i < nObjects; i++)
+		if(!present[i]) return false;
+
+	apply(states);
+
+	//the next frame contains all objects again
+	written.clear();
+	filename.clear();
+	return true;
+}
+
+uint64_t Snapshot::getLastFrameSize()
+{
+	return lastFrameSize;
+}
+
+uint64_t Snapshot::getNFrames()
+{
+	return seq;
+}
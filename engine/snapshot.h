@@ -0,0 +1,108 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+/*! \file snapshot.h
+ * \brief Checkpoints of the state of a simulation
+ *
+ * A snapshot file is a sequence of frames, every one appended by a single call to Snapshot::save. A frame consists of
+ * a SnapshotFrameHeader, the serialized states of the objects which changed since the previous frame (the index of the object,
+ * the size and the data) and a checksum of the frame. The first frame written by a Snapshot object (and the first one after
+ * \a restore) contains all objects and replaces the file - it is written to a temporary file, synced and renamed over the old
+ * one, so a failure while writing it leaves the old checkpoints intact. The following frames are appended, and a frame which
+ * was not written completely (e.g. the program was killed while writing it) is ignored.
+ */
+
+#include "geometry.h"
+#include "numeric.h"
+#include "particle.h"
+#include <vector>
+#include <thread>
+#include <string>
+
+/*! \struct SnapshotFrameHeader
+ * \brief The header of a frame of a snapshot file
+ */
+struct SnapshotFrameHeader
+{
+	char magic[4];		///< "GRSF"
+	uint32_t version;	///< Format version (2)
+	uint32_t nObjects;	///< Number of the objects in the snapshot
+	uint32_t nEntries;	///< Number of the objects stored in the frame
+	uint64_t seq;		///< Number of the frame
+	uint64_t size;		///< Size of the entries in bytes
+};
+
+/*! \class Snapshot
+ * \brief Saves and restores the state of a set of simulation objects
+ *
+ * The manifolds, integrators and particles (or entities) are registered once, in the same order in the simulation which saves
+ * the snapshots and in the one which restores them. Restoring is bit-exact, so a resumed run continues exactly like the
+ * uninterrupted one. The attached objects (which integrator a particle uses, its stop conditions etc.) are not saved -
+ * they are a part of the setup of the simulation.
+ *
+ * \a save only serializes the objects into memory, which is fast, and compares them with the previous frame; the changed ones
+ * are appended to the file by a background thread while the simulation continues. The objects must not be modified during
+ * \a save itself.
+ */
+class Snapshot
+{
+	std::vector<Manifold*> manifolds;
+	std::vector<Integrator*> integrators;
+	std::vector<Particle*> particles;
+
+	std::vector<std::vector<char> > written;	///< The states in the last frame
+	std::string filename;	///< The file to which the last frame was written
+	uint64_t seq;
+
+	std::thread writer;
+	std::vector<char> pending;	///< The frame being written
+	bool writeOk;
+	uint64_t lastFrameSize;
+
+	//! Serializes all objects
+	void capture(std::vector<std::vector<char> >& states);
+	//! Restores all objects
+	void apply(std::vector<std::vector<char> >& states);
+	//! Appends the pending frame to the file, or replaces the file with it if it is a full frame (runs in the background thread)
+	void writeFrame(std::string file, bool full);
+
+	Snapshot(const Snapshot&);
+	Snapshot& operator=(const Snapshot&);
+public:
+	//! Constructor
+	Snapshot();
+	//! Destructor - waits for the last frame to be written
+	~Snapshot();
+
+	//! Registers a manifold (its parameters are saved)
+	void addManifold(Manifold*);
+	//! Registers an integrator
+	void addIntegrator(Integrator*);
+	//! Registers a particle or an entity
+	void addParticle(Particle*);
+
+	//! Saves the state of all registered objects
+	/*! The frame is written in the background - call \a wait to make sure it is on the disk. A different file than in the previous
+	 *  call starts with a frame containing all objects.
+	 *  \param file The name of the file
+	 *  \return false if writing the previous frame failed
+	 */
+	bool save(const char* file);
+	//! Waits until the last frame is written
+	/*! \return true if it was written successfully
+	 */
+	bool wait();
+	//! Restores the state of all registered objects
+	/*! \param file The name of the file
+	 *  \param frame Number of the frame to restore (-1 - the last complete one)
+	 *  \return false if the file cannot be read or does not match the registered objects (nothing is restored then)
+	 */
+	bool restore(const char* file, int frame = -1);
+
+	//! Returns the size in bytes of the last frame
+	uint64_t getLastFrameSize();
+	//! Returns the number of the frames saved so far
+	uint64_t getNFrames();
+};
+
+#endif
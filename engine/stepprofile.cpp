@@ -0,0 +1,53 @@
+#include "stepprofile.h"
+#include <math.h>
+
+StepProfile::StepProfile(double xMin, double xMax, int _binsPerDecade, int coordinate)
+{
+	if(xMin <= 0.0 || xMax <= xMin) throw "StepProfile: Invalid range.";
+
+	coord = coordinate;
+	logMin = log10(xMin);
+	binsPerDecade = _binsPerDecade;
+	steps.assign((int)ceil((log10(xMax) - logMin)*binsPerDecade), 0.0);
+}
+
+StepProfile::~StepProfile()
+{
+}
+
+int StepProfile::bin(double x)
+{
+	if(x <= 0.0) return -1;
+	int i = (int)floor((log10(x) - logMin)*binsPerDecade);
+	if(i < 0 || i >= (int)steps.size()) return -1;
+	return i;
+}
+
+void StepProfile::record(Point p, double h)
+{
+	int i = bin(p[coord]);
+	if(i < 0 || h <= 0.0) return;
+	if(h > steps[i]) steps[i] = h;
+}
+
+double StepProfile::predict(Point p)
+{
+	int i = bin(p[coord]);
+	if(i < 0) return 0.0;
+	return steps[i];
+}
+
+void StepProfile::clear()
+{
+	unsigned i;
+	for(i = 0; i < steps.size(); i++)
+		steps[i] = 0.0;
+}
+
+bool StepProfile::isEmpty()
+{
+	unsigned i;
+	for(i = 0; i < steps.size(); i++)
+		if(steps[i] != 0.0) return false;
+	return true;
+}
@@ -0,0 +1,60 @@
+#ifndef __STEPPROFILE_H__
+#define __STEPPROFILE_H__
+
+/*! \file stepprofile.h
+ * \brief Step size schedules for warm-starting the integration of neighbouring trajectories
+ */
+
+#include "geometry.h"
+#include <vector>
+
+/*! \class StepProfile
+ * \brief Class recording accepted step sizes as a function of one coordinate
+ *
+ * Neighbouring trajectories (e.g. rays through neighbouring pixels, or particles of an ensemble) go through almost the same
+ * sequence of step sizes. A profile recorded along one trajectory can be used to predict the step size for another one,
+ * so that the adaptive integrator doesn't have to find it again through a series of rejected steps.
+ *
+ * The profile is a histogram with bins of equal width in log10 of the chosen coordinate (by default coordinate 1, which is
+ * the radius in Schwarzschild and Kerr manifolds). Every bin keeps the largest step size accepted in it. The prediction is meant
+ * as the initial step - starting too small costs many steps while the integrator grows the step, while starting from the largest
+ * step which was accepted nearby costs at most a rejection or two. See Particle::setStepPredictor and Particle::setStepRecorder.
+ */
+class StepProfile
+{
+	int coord;
+	double logMin;
+	double binsPerDecade;
+	std::vector<double> steps;
+
+	//! Returns the number of the bin containing the value, or -1 if it is out of range
+	int bin(double x);
+public:
+	//! Constructor
+	/*! \param xMin Lower end of the range of the coordinate (must be positive)
+	 *  \param xMax Upper end of the range of the coordinate
+	 *  \param _binsPerDecade Number of bins per factor of 10 in the coordinate
+	 *  \param coordinate The coordinate indexing the profile
+	 */
+	StepProfile(double xMin, double xMax, int _binsPerDecade = 32, int coordinate = 1);
+	//! Destructor
+	~StepProfile();
+
+	//! Records an accepted step
+	/*! \param p The position at the beginning of the step
+	 *  \param h The step size
+	 */
+	void record(Point p, double h);
+	//! Predicts the step size
+	/*! \param p The position
+	 *  \return The predicted step size, or 0 if nothing was recorded near the position
+	 */
+	double predict(Point p);
+
+	//! Removes all recorded steps
+	void clear();
+	//! Returns true if no step was recorded
+	bool isEmpty();
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "steptrace.h"
+
+StepTrace::StepTrace(int capacity)
+	: head(0), triggered(false)
+{
+	if(capacity < 1) throw "StepTrace: Capacity must be positive.";
+	unsigned n = 1;
+	while(n < (unsigned)capacity) n <<= 1;
+	mask = n - 1;
+	slots = new Slot[n];
+	unsigned i;
+	for(i = 0; i < n; i++)
+		slots[i].seq.store(0, std::memory_order_relaxed);
+
+	triggerSteps = 0;
+	triggerMinStep = 0.0;
+	minRun = 0;
+	triggerStep = 0;
+}
+
+StepTrace::~StepTrace()
+{
+	delete[] slots;
+}
+
+void StepTrace::record(Point p, double h, double err, int rejections)
+{
+	uint64_t n = head.load(std::memory_order_relaxed);
+	Slot& s = slots[n & mask];
+
+	//seqlock - readers discard the slot if the number changes while they copy it
+	s.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	s.record.step = n;
+	s.record.h = h;
+	s.record.err = err;
+	s.record.rejections = rejections;
+	s.record.chart = p.getCoordSystem();
+	int i;
+	for(i = 0; i < 4; i++)
+		s.record.x[i] = p[i];
+	s.seq.store(n + 1, std::memory_order_release);
+	head.store(n + 1, std::memory_order_release);
+
+	if(triggerSteps > 0)
+	{
+		if(h <= triggerMinStep*(1.0 + 1e-9)) minRun++;
+		else minRun = 0;
+		if(minRun == triggerSteps && !triggered.load(std::memory_order_relaxed))
+		{
+			triggerStep = n;
+			triggered.store(true, std::memory_order_release);
+		}
+	}
+}
+
+void StepTrace::clear()
+{
+	unsigned i;
+	for(i = 0; i <= mask; i++)
+		slots[i].seq.store(0, std::memory_order_relaxed);
+	head.store(0, std::memory_order_release);
+	minRun = 0;
+	triggerStep = 0;
+	triggered.store(false, std::memory_order_release);
+}
+
+std::vector<StepRecord> StepTrace::snapshot()
+{
+	std::vector<StepRecord> result;
+	uint64_t end = head.load(std::memory_order_acquire);
+	uint64_t begin = (end > mask + 1) ? end - (mask + 1) : 0;
+	uint64_t n;
+	for(n = begin; n < end; n++)
+	{
+		Slot& s = slots[n & mask];
+		if(s.seq.load(std::memory_order_acquire) != n + 1) continue;
+		StepRecord r = s.record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(s.seq.load(std::memory_order_relaxed) != n + 1) continue;
+		result.push_back(r);
+	}
+	return result;
+}
+
+void StepTrace::dump(std::ostream& out)
+{
+	std::vector<StepRecord> records = snapshot();
+	unsigned i;
+	for(i = 0; i < records.size(); i++)
+	{
+		StepRecord& r = records[i];
+		out << r.step << " " << r.h << " " << r.err << " " << r.rejections << " " << r.chart << " "
+			<< r.x[0] << " " << r.x[1] << " " << r.x[2] << " " << r.x[3] << std::endl;
+	}
+}
+
+void StepTrace::setAnomalyTrigger(int steps, double minStep)
+{
+	triggerSteps = steps;
+	triggerMinStep = minStep;
+	minRun = 0;
+}
+
+bool StepTrace::isTriggered()
+{
+	return triggered.load(std::memory_order_acquire);
+}
+
+uint64_t StepTrace::getTriggerStep()
+{
+	return triggerStep;
+}
+
+int StepTrace::getCapacity()
+{
+	return mask + 1;
+}
+
+uint64_t StepTrace::getRecorded()
+{
+	return head.load(std::memory_order_acquire);
+}
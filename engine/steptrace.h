@@ -0,0 +1,101 @@
+#ifndef __STEPTRACE_H__
+#define __STEPTRACE_H__
+
+/*! \file steptrace.h
+ * \brief Ring buffer of the last integration steps of a trajectory
+ */
+
+#include "geometry.h"
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <stdint.h>
+
+/*! \struct StepRecord
+ * \brief A single accepted integration step
+ */
+struct StepRecord
+{
+	uint64_t step;		///< Number of the step since the trace was cleared
+	double h;			///< The accepted step size
+	double err;			///< Error estimate of the accepted step (0 for fixed-step integrators)
+	int rejections;		///< Number of rejected attempts before the step was accepted
+	int chart;			///< Coordinate system in which the step was made
+	double x[4];		///< Position at the end of the step (in \a chart)
+};
+
+/*! \class StepTrace
+ * \brief Fixed-size ring buffer of the last steps of a trajectory
+ *
+ * Meant for diagnosing trajectories which stall at the minimal step size (near a horizon or a coordinate singularity) - attach
+ * it with Particle::setStepTrace and dump it when something goes wrong. Recording a step costs a few stores, so the trace can be
+ * left enabled in production runs.
+ *
+ * The trace has a single writer (the thread propagating the particle), but can be read from any thread at any time: every slot
+ * carries a sequence number, so \a snapshot skips the slots overwritten while it was copying them. No locks are taken on either side.
+ *
+ * An anomaly trigger can be set with \a setAnomalyTrigger - once the given number of consecutive steps is made with the minimal
+ * step size, the trace is marked as triggered. The trace only reports it; the caller decides whether to dump or stop.
+ */
+class StepTrace
+{
+	struct Slot
+	{
+		std::atomic<uint64_t> seq;	///< Number of the stored step + 1, 0 while the slot is being written
+		StepRecord record;
+	};
+
+	Slot* slots;
+	unsigned mask;
+	std::atomic<uint64_t> head;	///< Number of the steps recorded so far
+
+	int triggerSteps;
+	double triggerMinStep;
+	int minRun;			///< Current number of consecutive minimal steps
+	std::atomic<bool> triggered;
+	uint64_t triggerStep;
+
+	StepTrace(const StepTrace&);
+	StepTrace& operator=(const StepTrace&);
+public:
+	//! Constructor
+	/*! \param capacity Number of the kept steps (rounded up to a power of 2)
+	 */
+	StepTrace(int capacity = 256);
+	//! Destructor
+	~StepTrace();
+
+	//! Records a step - must be called only from a single thread
+	/*! \param p The position at the end of the step
+	 *  \param h The accepted step size
+	 *  \param err The error estimate of the step
+	 *  \param rejections The number of rejected attempts
+	 */
+	void record(Point p, double h, double err, int rejections);
+	//! Removes all steps and clears the trigger - must not be called while another thread records
+	void clear();
+
+	//! Returns the kept steps, from the oldest one
+	/*! Safe to call from any thread while the steps are being recorded.
+	 */
+	std::vector<StepRecord> snapshot();
+	//! Writes the kept steps as text, one step per line (step, h, err, rejections, chart, x[0..3])
+	void dump(std::ostream&);
+
+	//! Sets the anomaly trigger
+	/*! \param steps Number of consecutive steps with the minimal size which triggers the anomaly (0 - disabled)
+	 *  \param minStep The minimal step size of the integrator (steps not larger than it count)
+	 */
+	void setAnomalyTrigger(int steps, double minStep);
+	//! Returns true if the anomaly was triggered since the trace was cleared
+	bool isTriggered();
+	//! Returns the number of the step at which the anomaly was triggered
+	uint64_t getTriggerStep();
+
+	//! Returns the number of the kept steps
+	int getCapacity();
+	//! Returns the number of the steps recorded since the trace was cleared
+	uint64_t getRecorded();
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "stopcondition.h"
+#include "particle.h"
+#include "kerr_coords.h"
+#include <math.h>
+
+/*
+ * StopCondition
+ */
+
+StopCondition::StopCondition()
+{
+}
+
+StopCondition::~StopCondition()
+{
+}
+
+/*
+ * HorizonCondition
+ */
+
+HorizonCondition::HorizonCondition(double r)
+{
+	rStop = r;
+}
+
+HorizonCondition::~HorizonCondition()
+{
+}
+
+int HorizonCondition::check(Particle* p)
+{
+	if(p->getPos()[1] < rStop) return Horizon;
+	return NotStopped;
+}
+
+/*
+ * EscapeCondition
+ */
+
+EscapeCondition::EscapeCondition(double r)
+{
+	rMax = r;
+}
+
+EscapeCondition::~EscapeCondition()
+{
+}
+
+int EscapeCondition::check(Particle* p)
+{
+	if(p->getPos()[1] > rMax && p->getVel()[1] > 0.0) return Escape;
+	return NotStopped;
+}
+
+/*
+ * DiskCondition
+ */
+
+DiskCondition::DiskCondition(double _rIn, double _rOut)
+{
+	rIn = _rIn;
+	rOut = _rOut;
+}
+
+DiskCondition::~DiskCondition()
+{
+}
+
+int DiskCondition::check(Particle* p)
+{
+	Point c = crossingPoint(p);
+	if(c.getCoordSystem() == -1) return NotStopped;
+	if(c[1] >= rIn && c[1] <= rOut) return Disk;
+	return NotStopped;
+}
+
+Point DiskCondition::crossingPoint(Particle* p)
+{
+	Point last = p->getLastPos();
+	if(last.getCoordSystem() == -1) return Point();
+	
+	Manifold* m = p->getManifold();
+	Point p1 = m->convertPointTo(last, EF);
+	Point p2 = m->convertPointTo(p->getPos(), EF);
+	
+	double c1 = cos(p1[2]);
+	double c2 = cos(p2[2]);
+	if(c1 == 0.0 || (c1 > 0.0) == (c2 > 0.0)) return Point();
+	
+	double f = c1/(c1 - c2);
+	Point result(EF);
+	for(int i=0; i<4; i++)
+		result[i] = p1[i] + f*(p2[i] - p1[i]);
+	result[2] = M_PI/2;
+	return result;
+}
@@ -0,0 +1,103 @@
+#ifndef __STOPCONDITION_H__
+#define __STOPCONDITION_H__
+
+/*! \file stopcondition.h
+ * \brief Conditions terminating the propagation of a particle
+ */
+
+#include "geometry.h"
+
+class Particle;
+
+/*! \class StopCondition
+ * \brief Base class for conditions ending the propagation of a particle.
+ *
+ * Conditions are attached to a particle with Particle::addStopCondition. They are checked before every step - once one of them
+ * is fulfilled, the particle is marked as stopped and further calls to Particle::propagate do nothing.
+ * Implementations must not modify their own state in \a check, so that one condition object can be shared by many particles
+ * (also between threads).
+ */
+class StopCondition
+{
+public:
+	//! Reasons of stopping
+	enum { NotStopped = 0, Horizon, Escape, Disk, Custom = 100 };
+
+	//! Constructor
+	StopCondition();
+	//! Virtual destructor
+	virtual ~StopCondition();
+
+	//! Checks the condition
+	/*! \param p The particle being propagated
+	 *  \return NotStopped if the propagation should continue, otherwise the reason of stopping
+	 */
+	virtual int check(Particle* p) = 0;
+};
+
+/*! \class HorizonCondition
+ * \brief Stops the particle when it gets below a given radius
+ *
+ * Meant to be used with Schwarzschild and Kerr manifolds, in which coordinate 1 is the radius in every coordinate system.
+ * The radius should be chosen slightly above the horizon - rays traced backwards in time only approach it asymptotically.
+ */
+class HorizonCondition : public StopCondition
+{
+	double rStop;
+public:
+	//! Constructor
+	/*! \param r The radius below which the particle is stopped
+	 */
+	HorizonCondition(double r);
+	~HorizonCondition();
+
+	int check(Particle* p);
+};
+
+/*! \class EscapeCondition
+ * \brief Stops the particle when it is above a given radius and moving outwards
+ *
+ * Meant to be used with Schwarzschild and Kerr manifolds, in which coordinate 1 is the radius in every coordinate system.
+ */
+class EscapeCondition : public StopCondition
+{
+	double rMax;
+public:
+	//! Constructor
+	/*! \param r The radius above which the outgoing particle is considered to have escaped
+	 */
+	EscapeCondition(double r);
+	~EscapeCondition();
+
+	int check(Particle* p);
+};
+
+/*! \class DiskCondition
+ * \brief Stops the particle when it crosses a thin disk in the equatorial plane
+ *
+ * The crossing is detected by comparing the position before and after the last step (Particle::getLastPos), so the particle
+ * ends up slightly behind the disk - the crossing point itself is available through \a crossingPoint.
+ * Meant to be used with Schwarzschild and Kerr manifolds.
+ */
+class DiskCondition : public StopCondition
+{
+	double rIn, rOut;
+public:
+	//! Constructor
+	/*! \param _rIn Inner radius of the disk
+	 *  \param _rOut Outer radius of the disk
+	 */
+	DiskCondition(double _rIn, double _rOut);
+	~DiskCondition();
+
+	int check(Particle* p);
+
+	//! Finds the point where the last step crossed the equatorial plane
+	/*! The point is interpolated linearly in cos(theta) between the last and the current position.
+	 *  \param p The particle
+	 *  \return The crossing point in EF coordinates, or a point with an invalid coordinate system if the last step did not cross the plane
+	 */
+	static Point crossingPoint(Particle* p);
+};
+
+#endif
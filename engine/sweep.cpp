@@ -0,0 +1,220 @@
+#include "sweep.h"
+#include <stdio.h>
+#include <math.h>
+#include <thread>
+#include <chrono>
+
+/*******************************************************************************
+ *
+ *  SweepTask class implementation
+ *
+ *******************************************************************************/
+
+SweepTask::SweepTask()
+{
+}
+
+SweepTask::~SweepTask()
+{
+}
+
+std::string SweepTask::getResultName(int i)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "result%d", i);
+	return name;
+}
+
+/*******************************************************************************
+ *
+ *  ParameterSweep class implementation
+ *
+ *******************************************************************************/
+
+ParameterSweep::ParameterSweep(SweepTask* _task, int _nConditions)
+{
+	if(!_task) throw "ParameterSweep: No task.";
+	if(_nConditions < 1) throw "ParameterSweep: Invalid number of initial conditions.";
+	task = _task;
+	nConditions = _nConditions;
+	nResults = task->getNResults();
+	masses.push_back(1.0);
+	spins.push_back(0.0);
+	nThreads = 0;
+	threadsUsed = 0;
+	blockSize = 8;
+	totalTime = 0.0;
+	failedPoints = 0;
+}
+
+ParameterSweep::~ParameterSweep()
+{
+}
+
+void ParameterSweep::setMasses(const std::vector<double>& m)
+{
+	if(m.empty()) throw "ParameterSweep: No masses.";
+	masses = m;
+}
+
+void ParameterSweep::setAngMomenta(const std::vector<double>& a)
+{
+	if(a.empty()) throw "ParameterSweep: No angular momenta.";
+	spins = a;
+}
+
+void ParameterSweep::setThreads(int n)
+{
+	nThreads = n;
+}
+
+void ParameterSweep::setBlockSize(int n)
+{
+	blockSize = (n < 1) ? 1 : n;
+}
+
+void ParameterSweep::worker(std::atomic<int>* nextItem, std::atomic<int>* failed)
+{
+	int nPoints = order.size();
+	int nBlocks = (nPoints + blockSize - 1)/blockSize;
+	int nItems = nBlocks*nConditions;
+	KerrManifold m(masses[0], spins[0]);
+	std::vector<double> previous(nResults);
+
+	int item;
+	while((item = (*nextItem)++) < nItems)
+	{
+		int block = item/nConditions;
+		int condition = item%nConditions;
+		int first = block*blockSize;
+		int last = (first + blockSize < nPoints) ? first + blockSize : nPoints;
+
+		int i, k;
+		bool warm = false;
+		for(i = first; i < last; i++)
+		{
+			int point = order[i];
+			m.setMass(getMass(point));
+			m.setAngMomentum(getAngMomentum(point));
+			double* out = &results[((uint64_t)point*nConditions + condition)*nResults];
+			try
+			{
+				task->run(&m, condition, warm ? &previous[0] : NULL, out);
+			}
+			catch(...)
+			{
+				//a failed point must not bring down the whole sweep - the next point starts cold
+				for(k = 0; k < nResults; k++)
+					out[k] = NAN;
+				(*failed)++;
+				warm = false;
+				continue;
+			}
+			if(nResults) previous.assign(out, out + nResults);
+			warm = true;
+		}
+	}
+}
+
+void ParameterSweep::run()
+{
+	int nSpins = spins.size();
+	int nPoints = masses.size()*nSpins;
+
+	//snake ordering - consecutive points differ in one parameter by one step
+	order.clear();
+	int i, j;
+	for(i = 0; i < (int)masses.size(); i++)
+		for(j = 0; j < nSpins; j++)
+			order.push_back(i*nSpins + ((i % 2) ? nSpins - 1 - j : j));
+
+	results.assign((uint64_t)nPoints*nConditions*nResults, 0.0);
+
+	int nItems = ((nPoints + blockSize - 1)/blockSize)*nConditions;
+	int n = nThreads;
+	if(n <= 0) n = std::thread::hardware_concurrency();
+	if(n > nItems) n = nItems;
+	if(n < 1) n = 1;
+	threadsUsed = n;
+
+	std::atomic<int> nextItem(0), failed(0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for(i = 1; i < threadsUsed; i++)
+		threads.push_back(std::thread(&ParameterSweep::worker, this, &nextItem, &failed));
+	worker(&nextItem, &failed);
+	for(i = 0; i < (int)threads.size(); i++)
+		threads[i].join();
+
+	totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	failedPoints = failed;
+}
+
+int ParameterSweep::getNPoints()
+{
+	return masses.size()*spins.size();
+}
+
+double ParameterSweep::getMass(int point)
+{
+	if(point < 0 || point >= getNPoints()) throw "ParameterSweep: Invalid point.";
+	return masses[point/spins.size()];
+}
+
+double ParameterSweep::getAngMomentum(int point)
+{
+	if(point < 0 || point >= getNPoints()) throw "ParameterSweep: Invalid point.";
+	return spins[point%spins.size()];
+}
+
+const std::vector<int>& ParameterSweep::getOrder()
+{
+	return order;
+}
+
+double ParameterSweep::getResult(int point, int condition, int i)
+{
+	if(results.empty()) throw "ParameterSweep: No results.";
+	if(point < 0 || point >= getNPoints() || condition < 0 || condition >= nConditions || i < 0 || i >= nResults)
+		throw "ParameterSweep: Index out of bounds.";
+	return results[((uint64_t)point*nConditions + condition)*nResults + i];
+}
+
+bool ParameterSweep::writeTable(const char* filename)
+{
+	if(results.empty()) return false;
+	FILE* f = fopen(filename, "w");
+	if(!f) return false;
+
+	fprintf(f, "# M a condition");
+	int i, c, k;
+	for(k = 0; k < nResults; k++)
+		fprintf(f, " %s", task->getResultName(k).c_str());
+	fprintf(f, "\n");
+
+	for(i = 0; i < getNPoints(); i++)
+		for(c = 0; c < nConditions; c++)
+		{
+			fprintf(f, "%.17g %.17g %d", getMass(i), getAngMomentum(i), c);
+			for(k = 0; k < nResults; k++)
+				fprintf(f, " %.17g", getResult(i, c, k));
+			fprintf(f, "\n");
+		}
+	return fclose(f) == 0;
+}
+
+int ParameterSweep::getThreadsUsed()
+{
+	return threadsUsed;
+}
+
+double ParameterSweep::getTime()
+{
+	return totalTime;
+}
+
+int ParameterSweep::getFailedPoints()
+{
+	return failedPoints;
+}
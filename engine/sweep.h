@@ -0,0 +1,118 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+/*! \file sweep.h
+ * \brief Parallel sweeps of computations over a grid of Kerr parameters (M, a)
+ */
+
+#include "kerr.h"
+#include <vector>
+#include <string>
+#include <atomic>
+
+/*! \class SweepTask
+ * \brief Base class for computations run by ParameterSweep
+ *
+ * \a run is called from many threads at once (with different manifolds), so implementations must not modify their own state in it.
+ */
+class SweepTask
+{
+public:
+	//! Constructor
+	SweepTask();
+	//! Virtual destructor
+	virtual ~SweepTask();
+
+	//! Returns the number of the values computed for a single initial condition
+	virtual int getNResults() = 0;
+	//! Returns the name of a computed value (used in the header of the table, default implementation - "result<i>")
+	virtual std::string getResultName(int i);
+
+	//! Computes the values for an initial condition at a point of the grid
+	/*! \param m The manifold with the parameters of the point - it belongs to the calling thread and is the same object for
+	 *         the consecutive points of a block. Setting its parameters empties the caches of its metrics, so no cached values
+	 *         carry over from the previous point
+	 *  \param condition Number of the initial condition
+	 *  \param previous The values computed for the same condition at the previous point of the block (a neighbour on the grid),
+	 *         e.g. for a warm start of a search; NULL at the first point of the block
+	 *  \param results The computed values (getNResults of them)
+	 */
+	virtual void run(KerrManifold* m, int condition, const double* previous, double* results) = 0;
+};
+
+/*! \class ParameterSweep
+ * \brief Runs a SweepTask for every initial condition at every point of a grid of masses and angular momenta
+ *
+ * The points of the grid are ordered like a snake - the angular momentum goes up for one mass and down for the next one, so that
+ * consecutive points differ in a single parameter by a single step of the grid. The ordered points are split into blocks of
+ * consecutive points; a work item is a block for a single initial condition. The threads take the items one after another and
+ * run the points of an item in order on their own manifold, changing only its parameters.
+ */
+class ParameterSweep
+{
+	SweepTask* task;
+	int nConditions;
+	int nResults;
+	std::vector<double> masses, spins;
+	std::vector<int> order;
+	int nThreads, threadsUsed;
+	int blockSize;
+
+	std::vector<double> results;
+	double totalTime;
+	int failedPoints;
+
+	//! Worker thread - runs the work items until there are none left
+	/*! A point whose task throws gets NaN for all its values and is counted in failed.
+	 */
+	void worker(std::atomic<int>* nextItem, std::atomic<int>* failed);
+public:
+	//! Constructor
+	/*! \param _task The computation
+	 *  \param _nConditions Number of the initial conditions
+	 */
+	ParameterSweep(SweepTask* _task, int _nConditions);
+	//! Destructor
+	~ParameterSweep();
+
+	//! Sets the masses of the grid
+	void setMasses(const std::vector<double>&);
+	//! Sets the angular momenta of the grid
+	void setAngMomenta(const std::vector<double>&);
+	//! Sets the number of threads (0 - default, one per hardware thread)
+	void setThreads(int);
+	//! Sets the number of the consecutive points in a work item (default 8)
+	void setBlockSize(int);
+
+	//! Runs the sweep
+	void run();
+
+	//! Returns the number of the points of the grid
+	int getNPoints();
+	//! Returns the mass at a point of the grid (points are numbered mass-major: iM*nSpins + iA)
+	double getMass(int point);
+	//! Returns the angular momentum at a point of the grid
+	double getAngMomentum(int point);
+	//! Returns the order in which the points are visited
+	const std::vector<int>& getOrder();
+	//! Returns a computed value
+	/*! \param point Number of the point of the grid
+	 *  \param condition Number of the initial condition
+	 *  \param i Number of the value
+	 */
+	double getResult(int point, int condition, int i);
+	//! Writes the results as a text table
+	/*! Every line contains M, a, the number of the initial condition and the computed values, separated by spaces.
+	 *  \return true on success
+	 */
+	bool writeTable(const char* filename);
+
+	//! Returns the number of threads used in the last run
+	int getThreadsUsed();
+	//! Returns the time of the last run in seconds
+	double getTime();
+	//! Returns the number of the runs of the task that threw in the last run (their values are NaN)
+	int getFailedPoints();
+};
+
+#endif
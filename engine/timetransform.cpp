@@ -0,0 +1,61 @@
+#include "timetransform.h"
+#include "kerr_coords.h"
+#include <math.h>
+
+/*
+ * TimeTransform
+ */
+
+TimeTransform::TimeTransform()
+{
+}
+
+TimeTransform::~TimeTransform()
+{
+}
+
+/*
+ * RadialTime
+ */
+
+RadialTime::RadialTime(double _power, double _r0)
+{
+	power = _power;
+	r0 = _r0;
+}
+
+RadialTime::~RadialTime()
+{
+}
+
+double RadialTime::factor(Point p, vector4 u)
+{
+	return pow(fabs(p[1])/r0, power);
+}
+
+/*
+ * MinoTime
+ */
+
+MinoTime::MinoTime(double _a)
+{
+	a = _a;
+}
+
+MinoTime::~MinoTime()
+{
+}
+
+double MinoTime::factor(Point p, vector4 u)
+{
+	double c;
+	if(p.getCoordSystem() == EF)
+		c = cos(p[2]);
+	else
+	{
+		//the stereographic coordinates - |cos(theta)| = (1 - s)/(1 + s)
+		double s = p[2]*p[2] + p[3]*p[3];
+		c = (1.0 - s)/(1.0 + s);
+	}
+	return p[1]*p[1] + a*a*c*c;
+}
@@ -0,0 +1,75 @@
+#ifndef __TIMETRANSFORM_H__
+#define __TIMETRANSFORM_H__
+
+/*! \file timetransform.h
+ * \brief Transformations of the parameter in which particles are propagated
+ */
+
+#include "geometry.h"
+
+/*! \class TimeTransform
+ * \brief Base class for the transformations d tau = f(x) d lambda of the parameter of propagation
+ *
+ * A transformation is attached to a particle with Particle::setTimeTransform. The integrator then makes its steps in lambda
+ * and the proper time (affine parameter for photons) is integrated as an additional component of the state. With f small
+ * where the motion is quick (e.g. near the periapsis) and large where it is slow, the steps in lambda are much more uniform
+ * than the steps in tau. Implementations must not modify their own state in \a factor, so that one transformation can be
+ * shared by many particles (also between threads).
+ */
+class TimeTransform
+{
+public:
+	//! Constructor
+	TimeTransform();
+	//! Virtual destructor
+	virtual ~TimeTransform();
+
+	//! The factor f = d tau / d lambda
+	/*! \param p The position
+	 *  \param u The 4-velocity (with respect to tau)
+	 *  \return The factor, which must be positive
+	 */
+	virtual double factor(Point p, vector4 u) = 0;
+};
+
+/*! \class RadialTime
+ * \brief d tau = (r/r0)^n d lambda
+ *
+ * Meant to be used with Schwarzschild and Kerr manifolds, in which coordinate 1 is the radius in every coordinate system.
+ * With n = 1.5 a step in lambda is a constant fraction of the local Keplerian period - a Sundman transformation.
+ */
+class RadialTime : public TimeTransform
+{
+	double power;
+	double r0;
+public:
+	//! Constructor
+	/*! \param _power The power n
+	 *  \param _r0 The radius at which the steps in lambda and tau are equal
+	 */
+	RadialTime(double _power, double _r0 = 1.0);
+	~RadialTime();
+
+	double factor(Point p, vector4 u);
+};
+
+/*! \class MinoTime
+ * \brief The Mino time of the Kerr metric - d tau = Sigma d lambda, Sigma = r^2 + a^2 cos^2(theta)
+ *
+ * In the Mino time the radial and polar motions of a geodesic decouple and are periodic with constant periods. Meant to be used
+ * with the coordinate systems of Kerr and Schwarzschild manifolds (kerr_coords.h).
+ */
+class MinoTime : public TimeTransform
+{
+	double a;
+public:
+	//! Constructor
+	/*! \param _a Angular momentum per unit mass of the black hole
+	 */
+	MinoTime(double _a);
+	~MinoTime();
+
+	double factor(Point p, vector4 u);
+};
+
+#endif
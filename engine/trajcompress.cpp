@@ -0,0 +1,445 @@
+#include "trajcompress.h"
+#include <string.h>
+#include <math.h>
+
+static_assert(sizeof(CompressionParams) == 32, "CompressionParams must have no padding");
+static_assert(sizeof(CompressedBlock) == 16, "CompressedBlock must have no padding");
+
+/*
+ * Encoding of the samples - 10 integers (chart, tau, x[4], u[4]), every one as the difference from the previous sample,
+ * zigzag-mapped to an unsigned number and written in 7-bit groups (LEB128)
+ */
+
+static void putVarint(std::vector<unsigned char>& out, int64_t value)
+{
+	uint64_t v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	while(v >= 0x80)
+	{
+		out.push_back((unsigned char)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((unsigned char)v);
+}
+
+static bool getVarint(const unsigned char*& p, const unsigned char* end, int64_t& value)
+{
+	uint64_t v = 0;
+	int shift = 0;
+	for(;;)
+	{
+		if(p >= end || shift > 63) return false;
+		unsigned char c = *p++;
+		v |= (uint64_t)(c & 0x7f) << shift;
+		if(!(c & 0x80)) break;
+		shift += 7;
+	}
+	value = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+	return true;
+}
+
+static int64_t quantizeValue(double v, double step)
+{
+	double q = floor(v/step + 0.5);
+	if(fabs(q) > 9e18) throw "TrajectoryCompressor: Value out of range of the quantization.";
+	return (int64_t)q;
+}
+
+//the quantized values of a record
+static void toIntegers(const TrajectoryRecord& r, const CompressionParams& params, int64_t* q)
+{
+	int i;
+	q[0] = r.chart;
+	q[1] = quantizeValue(r.tau, params.tauStep);
+	for(i = 0; i < 4; i++)
+	{
+		q[2+i] = quantizeValue(r.x[i], params.xStep);
+		q[6+i] = quantizeValue(r.u[i], params.uStep);
+	}
+}
+
+static void fromIntegers(const int64_t* q, const CompressionParams& params, uint64_t traj, TrajectoryRecord& r)
+{
+	int i;
+	r.traj = traj;
+	r.chart = q[0];
+	r.tau = q[1]*params.tauStep;
+	for(i = 0; i < 4; i++)
+	{
+		r.x[i] = q[2+i]*params.xStep;
+		r.u[i] = q[6+i]*params.uStep;
+	}
+}
+
+/*******************************************************************************
+ *
+ *  TrajectoryCompressor class implementation
+ *
+ *******************************************************************************/
+
+TrajectoryCompressor::TrajectoryCompressor(const char* filename, double M, double a, int nCharts, double tolerance, int _maxSegment, int _blockBytes)
+{
+	if(nCharts < 1 || nCharts > 8) throw "TrajectoryCompressor: Invalid number of coordinate systems.";
+	if(tolerance <= 0.0) throw "TrajectoryCompressor: The tolerance must be positive.";
+
+	//the quantization error of the ends is included in the check, so the steps only decide how much of the tolerance it eats up
+	params.tolerance = tolerance;
+	params.tauStep = tolerance/1024;
+	params.xStep = tolerance/16;
+	params.uStep = tolerance/1024;
+	maxSegment = (_maxSegment < 2) ? 2 : _maxSegment;
+	blockBytes = _blockBytes;
+
+	f = fopen(filename, "wb");
+	if(!f) throw "TrajectoryCompressor: Cannot create the file.";
+
+	TrajectoryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "GRTC", 4);
+	header.version = 1;
+	header.recordSize = 0;
+	header.nCharts = nCharts;
+	header.M = M;
+	header.a = a;
+	int i;
+	for(i = 0; i < 8; i++)
+		header.charts[i] = (i < nCharts) ? i : -1;
+
+	ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	ok = ok && fwrite(&params, sizeof(params), 1, f) == 1;
+	offset = nBytes = sizeof(header) + sizeof(params);
+	nRecords = nSamples = 0;
+}
+
+TrajectoryCompressor::~TrajectoryCompressor()
+{
+	close();
+}
+
+TrajectoryRecord TrajectoryCompressor::quantize(const TrajectoryRecord& r)
+{
+	int64_t q[10];
+	TrajectoryRecord result;
+	toIntegers(r, params, q);
+	fromIntegers(q, params, r.traj, result);
+	return result;
+}
+
+bool TrajectoryCompressor::check(const TrajectoryRecord& a, const TrajectoryRecord& b, std::vector<TrajectoryRecord>& records)
+{
+	unsigned i;
+	int j;
+	for(i = 0; i < records.size(); i++)
+	{
+		TrajectoryRecord r = CompressedTrajectoryReader::hermite(a, b, records[i].tau);
+		for(j = 0; j < 4; j++)
+			if(!(fabs(r.x[j] - records[i].x[j]) <= params.tolerance)) return false;
+	}
+	return true;
+}
+
+void TrajectoryCompressor::keep(Stream& s, const TrajectoryRecord& r)
+{
+	int64_t q[10];
+	int i;
+	toIntegers(r, params, q);
+	//a new block starts from zero
+	if(s.nSamples == 0)
+		for(i = 0; i < 10; i++)
+			s.last[i] = 0;
+	for(i = 0; i < 10; i++)
+	{
+		putVarint(s.bytes, q[i] - s.last[i]);
+		s.last[i] = q[i];
+	}
+	s.nSamples++;
+	nSamples++;
+
+	s.key = r;
+	s.hasKey = true;
+	if((int)s.bytes.size() >= blockBytes) flush(r.traj, s);
+}
+
+void TrajectoryCompressor::flush(uint32_t traj, Stream& s)
+{
+	if(!s.nSamples) return;
+
+	CompressedBlock block;
+	block.traj = traj;
+	block.nSamples = s.nSamples;
+	block.nBytes = s.bytes.size();
+
+	CompressedIndexEntry entry;
+	entry.traj = traj;
+	entry.offset = offset;
+	entry.nSamples = s.nSamples;
+	index.push_back(entry);
+
+	ok = ok && fwrite(&block, sizeof(block), 1, f) == 1;
+	ok = ok && fwrite(&s.bytes[0], 1, s.bytes.size(), f) == s.bytes.size();
+	offset += sizeof(block) + s.bytes.size();
+	nBytes = offset;
+
+	s.bytes.clear();
+	s.nSamples = 0;
+}
+
+void TrajectoryCompressor::write(const TrajectoryRecord& record)
+{
+	if(!f) throw "TrajectoryCompressor: The file is closed.";
+	nRecords++;
+
+	std::map<uint32_t, Stream>::iterator it = streams.find(record.traj);
+	if(it == streams.end())
+	{
+		Stream s;
+		s.hasKey = false;
+		memset(&s.key, 0, sizeof(s.key));
+		s.nSamples = 0;
+		memset(s.last, 0, sizeof(s.last));
+		it = streams.insert(std::make_pair(record.traj, s)).first;
+	}
+	Stream& s = it->second;
+
+	if(!s.hasKey)
+	{
+		keep(s, quantize(record));
+		return;
+	}
+
+	//the segments don't cross the changes of the coordinate system - both sides of the change are kept
+	if(record.chart != s.key.chart)
+	{
+		if(!s.pending.empty()) keep(s, quantize(s.pending.back()));
+		s.pending.clear();
+		keep(s, quantize(record));
+		return;
+	}
+
+	TrajectoryRecord end = quantize(record);
+	if(check(s.key, end, s.pending))
+	{
+		s.pending.push_back(record);
+		if((int)s.pending.size() >= maxSegment)
+		{
+			keep(s, end);
+			s.pending.clear();
+		}
+	}
+	else
+	{
+		//the last record which passed the check ends the segment, the new one starts the next segment
+		keep(s, quantize(s.pending.back()));
+		s.pending.clear();
+		s.pending.push_back(record);
+	}
+}
+
+void TrajectoryCompressor::finish(uint32_t traj)
+{
+	std::map<uint32_t, Stream>::iterator it = streams.find(traj);
+	if(it == streams.end()) return;
+	Stream& s = it->second;
+	if(!s.pending.empty()) keep(s, quantize(s.pending.back()));
+	flush(traj, s);
+	streams.erase(it);
+}
+
+bool TrajectoryCompressor::close()
+{
+	if(!f) return ok;
+
+	while(!streams.empty())
+		finish(streams.begin()->first);
+
+	TrajectoryTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	trailer.indexOffset = offset;
+	trailer.nRuns = index.size();
+	memcpy(trailer.magic, "GRCI", 4);
+
+	if(!index.empty())
+		ok = ok && fwrite(&index[0], sizeof(CompressedIndexEntry), index.size(), f) == index.size();
+	ok = ok && fwrite(&trailer, sizeof(trailer), 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	f = NULL;
+	nBytes = offset + index.size()*sizeof(CompressedIndexEntry) + sizeof(trailer);
+	index.clear();
+	return ok;
+}
+
+uint64_t TrajectoryCompressor::getNRecords()
+{
+	return nRecords;
+}
+
+uint64_t TrajectoryCompressor::getNSamples()
+{
+	return nSamples;
+}
+
+uint64_t TrajectoryCompressor::getNBytes()
+{
+	return nBytes;
+}
+
+/*******************************************************************************
+ *
+ *  CompressedTrajectoryReader class implementation
+ *
+ *******************************************************************************/
+
+CompressedTrajectoryReader::CompressedTrajectoryReader()
+{
+	memset(&header, 0, sizeof(header));
+	memset(&params, 0, sizeof(params));
+}
+
+CompressedTrajectoryReader::~CompressedTrajectoryReader()
+{
+}
+
+bool CompressedTrajectoryReader::open(const char* filename)
+{
+	data.clear();
+	blocks.clear();
+
+	FILE* f = fopen(filename, "rb");
+	if(!f) return false;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if(size < (long)(sizeof(header) + sizeof(params) + sizeof(TrajectoryTrailer)))
+	{
+		fclose(f);
+		return false;
+	}
+	data.resize(size);
+	bool ok = fread(&data[0], 1, size, f) == (size_t)size;
+	fclose(f);
+	if(!ok) return false;
+
+	memcpy(&header, &data[0], sizeof(header));
+	memcpy(&params, &data[sizeof(header)], sizeof(params));
+	if(memcmp(header.magic, "GRTC", 4) != 0 || header.version != 1 || header.nCharts < 1 || header.nCharts > 8) return false;
+
+	TrajectoryTrailer trailer;
+	memcpy(&trailer, &data[size - sizeof(trailer)], sizeof(trailer));
+	//the bounds are checked before the sum, which could wrap around for a corrupt trailer
+	uint64_t room = size - sizeof(trailer);
+	if(memcmp(trailer.magic, "GRCI", 4) != 0 || trailer.indexOffset > room ||
+		trailer.nRuns > (room - trailer.indexOffset)/sizeof(CompressedIndexEntry) ||
+		trailer.indexOffset + trailer.nRuns*sizeof(CompressedIndexEntry) != room) return false;
+
+	uint64_t i;
+	for(i = 0; i < trailer.nRuns; i++)
+	{
+		CompressedIndexEntry entry;
+		memcpy(&entry, &data[trailer.indexOffset + i*sizeof(entry)], sizeof(entry));
+		if(entry.offset > trailer.indexOffset || trailer.indexOffset - entry.offset < sizeof(CompressedBlock)) return false;
+		blocks[entry.traj].push_back(entry);
+	}
+	return true;
+}
+
+double CompressedTrajectoryReader::getMass()
+{
+	return header.M;
+}
+
+double CompressedTrajectoryReader::getAngMomentum()
+{
+	return header.a;
+}
+
+int CompressedTrajectoryReader::getNCharts()
+{
+	return header.nCharts;
+}
+
+CompressionParams CompressedTrajectoryReader::getParams()
+{
+	return params;
+}
+
+std::vector<uint64_t> CompressedTrajectoryReader::getTrajectories()
+{
+	std::vector<uint64_t> result;
+	std::map<uint64_t, std::vector<CompressedIndexEntry> >::iterator it;
+	for(it = blocks.begin(); it != blocks.end(); it++)
+		result.push_back(it->first);
+	return result;
+}
+
+bool CompressedTrajectoryReader::decode(uint64_t traj, std::vector<TrajectoryRecord>& samples)
+{
+	samples.clear();
+	std::map<uint64_t, std::vector<CompressedIndexEntry> >::iterator it = blocks.find(traj);
+	if(it == blocks.end()) return false;
+
+	unsigned i;
+	uint32_t j;
+	int k;
+	for(i = 0; i < it->second.size(); i++)
+	{
+		CompressedBlock block;
+		memcpy(&block, &data[it->second[i].offset], sizeof(block));
+		const unsigned char* p = &data[it->second[i].offset + sizeof(block)];
+		const unsigned char* end = p + block.nBytes;
+		if(end > &data[0] + data.size()) return false;
+
+		int64_t q[10] = { 0 };
+		for(j = 0; j < block.nSamples; j++)
+		{
+			for(k = 0; k < 10; k++)
+			{
+				int64_t d;
+				if(!getVarint(p, end, d)) return false;
+				q[k] += d;
+			}
+			TrajectoryRecord r;
+			fromIntegers(q, params, traj, r);
+			samples.push_back(r);
+		}
+	}
+	return true;
+}
+
+TrajectoryRecord CompressedTrajectoryReader::hermite(const TrajectoryRecord& a, const TrajectoryRecord& b, double tau)
+{
+	TrajectoryRecord r = a;
+	r.tau = tau;
+	double h = b.tau - a.tau;
+	if(h == 0.0) return r;
+
+	double s = (tau - a.tau)/h;
+	double s2 = s*s, s3 = s2*s;
+	double h00 = 2*s3 - 3*s2 + 1, h10 = s3 - 2*s2 + s, h01 = 3*s2 - 2*s3, h11 = s3 - s2;
+	double d00 = 6*s2 - 6*s, d10 = 3*s2 - 4*s + 1, d01 = 6*s - 6*s2, d11 = 3*s2 - 2*s;
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		r.x[i] = h00*a.x[i] + h10*h*a.u[i] + h01*b.x[i] + h11*h*b.u[i];
+		r.u[i] = (d00*a.x[i] + d01*b.x[i])/h + d10*a.u[i] + d11*b.u[i];
+	}
+	return r;
+}
+
+TrajectoryRecord CompressedTrajectoryReader::interpolate(const std::vector<TrajectoryRecord>& samples, double tau)
+{
+	if(samples.empty()) throw "CompressedTrajectoryReader: No samples.";
+	if(tau <= samples[0].tau) return samples[0];
+	if(tau >= samples.back().tau) return samples.back();
+
+	//binary search for the segment
+	unsigned lo = 0, hi = samples.size() - 1;
+	while(hi - lo > 1)
+	{
+		unsigned mid = (lo + hi)/2;
+		if(samples[mid].tau <= tau) lo = mid;
+		else hi = mid;
+	}
+	//the kept samples at a change of the coordinate system are not connected - nothing was recorded between them
+	if(samples[lo].chart != samples[hi].chart)
+		return (tau - samples[lo].tau < samples[hi].tau - tau) ? samples[lo] : samples[hi];
+	return hermite(samples[lo], samples[hi], tau);
+}
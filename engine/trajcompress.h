@@ -0,0 +1,176 @@
+#ifndef __TRAJCOMPRESS_H__
+#define __TRAJCOMPRESS_H__
+
+/*! \file trajcompress.h
+ * \brief Error-bounded compression of trajectories
+ *
+ * Only the samples needed for the cubic Hermite interpolation (from the positions and 4-velocities, which are the derivatives
+ * of the positions with respect to the proper time) to reproduce every recorded position within a given tolerance are kept.
+ * The kept samples are quantized, and the differences between consecutive samples of a trajectory are stored as variable-length
+ * integers.
+ *
+ * The file has the header of a trajectory file (see trajectory.h) with the magic "GRTC", followed by the quantization steps
+ * (CompressionParams), the blocks of the trajectories (CompressedBlock followed by the encoded samples) and an index of the blocks
+ * followed by a trailer (TrajectoryTrailer with the magic "GRCI").
+ */
+
+#include "trajectory.h"
+#include <vector>
+#include <map>
+
+/*! \struct CompressionParams
+ * \brief Tolerance and quantization steps of a compressed file
+ */
+struct CompressionParams
+{
+	double tolerance;	///< Largest allowed error of the reconstructed coordinates
+	double tauStep;		///< Quantization step of the proper time
+	double xStep;		///< Quantization step of the coordinates
+	double uStep;		///< Quantization step of the 4-velocity components
+};
+
+/*! \struct CompressedBlock
+ * \brief Header of a block of samples of one trajectory
+ *
+ * The first sample of a block is stored relative to zero, so every block can be decoded on its own.
+ */
+struct CompressedBlock
+{
+	uint32_t traj;		///< ID of the trajectory
+	uint32_t nSamples;	///< Number of the samples
+	uint64_t nBytes;	///< Size of the encoded samples
+};
+
+/*! \struct CompressedIndexEntry
+ * \brief Entry of the index of a compressed file
+ */
+struct CompressedIndexEntry
+{
+	uint64_t traj;		///< ID of the trajectory
+	uint64_t offset;	///< Position of the block header in the file
+	uint64_t nSamples;	///< Number of the samples in the block
+};
+
+/*! \class TrajectoryCompressor
+ * \brief Trajectory sink keeping only the samples needed for the reconstruction within a tolerance
+ *
+ * The samples are chosen greedily: a segment from the last kept sample is extended as long as the Hermite interpolation between
+ * its ends reproduces all skipped records within the tolerance, in every coordinate. The check uses the quantized values of the
+ * ends, exactly as they will be decoded, so the bound holds for the decompressed trajectory. A segment never crosses a change
+ * of the coordinate system and is limited to \a maxSegment records (the check costs O(n^2) in the segment length).
+ *
+ * The tolerance applies to the positions at the recorded proper times. The 4-velocity is reconstructed as the derivative of the
+ * interpolant, which is less accurate.
+ * The encoded samples of every trajectory are buffered and written in blocks, so the records of many trajectories may come in
+ * any order. The compressor is not thread-safe.
+ */
+class TrajectoryCompressor : public TrajectorySink
+{
+	//! The state of a single trajectory
+	struct Stream
+	{
+		bool hasKey;
+		TrajectoryRecord key;					///< The last kept sample (quantized)
+		std::vector<TrajectoryRecord> pending;	///< The records after it, which are not kept yet
+		std::vector<unsigned char> bytes;		///< Encoded samples which are not written yet
+		uint32_t nSamples;
+		int64_t last[10];						///< Quantized values of the last encoded sample
+	};
+
+	FILE* f;
+	CompressionParams params;
+	int maxSegment;
+	int blockBytes;
+	std::map<uint32_t, Stream> streams;
+	std::vector<CompressedIndexEntry> index;
+	uint64_t offset;
+	uint64_t nRecords, nSamples, nBytes;
+	bool ok;
+
+	//! Quantizes a record
+	TrajectoryRecord quantize(const TrajectoryRecord&);
+	//! Checks whether the segment reproduces the pending records
+	bool check(const TrajectoryRecord& a, const TrajectoryRecord& b, std::vector<TrajectoryRecord>& records);
+	//! Keeps a sample (already quantized)
+	void keep(Stream& s, const TrajectoryRecord& r);
+	//! Writes the encoded samples of a trajectory
+	void flush(uint32_t traj, Stream& s);
+
+	TrajectoryCompressor(const TrajectoryCompressor&);
+	TrajectoryCompressor& operator=(const TrajectoryCompressor&);
+public:
+	//! Constructor - creates the file and writes the header
+	/*! \param filename Name of the file
+	 *  \param M Mass of the central body
+	 *  \param a Angular momentum parameter
+	 *  \param nCharts Number of the coordinate systems (at most 8)
+	 *  \param tolerance Largest allowed error of the reconstructed coordinates
+	 *  \param _maxSegment Largest number of the records between two kept samples
+	 *  \param _blockBytes Size of the encoded samples of a trajectory buffered before they are written
+	 */
+	TrajectoryCompressor(const char* filename, double M, double a, int nCharts, double tolerance, int _maxSegment = 1024, int _blockBytes = 1 << 16);
+	//! Destructor - closes the file if it is still open
+	~TrajectoryCompressor();
+
+	void write(const TrajectoryRecord&);
+	//! Ends a trajectory - keeps its last record and writes its samples
+	void finish(uint32_t traj);
+	//! Ends all trajectories, writes the index and closes the file
+	/*! \return true if all writes succeeded
+	 */
+	bool close();
+
+	//! Returns the number of the received records
+	uint64_t getNRecords();
+	//! Returns the number of the kept samples
+	uint64_t getNSamples();
+	//! Returns the size of the file so far in bytes
+	uint64_t getNBytes();
+};
+
+/*! \class CompressedTrajectoryReader
+ * \brief Reader of compressed trajectory files
+ */
+class CompressedTrajectoryReader
+{
+	TrajectoryHeader header;
+	CompressionParams params;
+	std::vector<unsigned char> data;
+	std::map<uint64_t, std::vector<CompressedIndexEntry> > blocks;
+public:
+	//! Constructor - no file
+	CompressedTrajectoryReader();
+	//! Destructor
+	~CompressedTrajectoryReader();
+
+	//! Reads a file
+	/*! \return true on success
+	 */
+	bool open(const char* filename);
+
+	//! Returns the mass of the central body
+	double getMass();
+	//! Returns the angular momentum parameter
+	double getAngMomentum();
+	//! Returns the number of the coordinate systems
+	int getNCharts();
+	//! Returns the tolerance and the quantization steps
+	CompressionParams getParams();
+
+	//! Returns the IDs of all trajectories
+	std::vector<uint64_t> getTrajectories();
+	//! Decodes the kept samples of a trajectory
+	/*! \return false if the trajectory does not exist or the data are damaged
+	 */
+	bool decode(uint64_t traj, std::vector<TrajectoryRecord>& samples);
+
+	//! Reconstructs the state of a trajectory at a proper time
+	/*! \param samples The decoded samples
+	 *  \param tau The proper time (clamped to the range of the samples)
+	 */
+	static TrajectoryRecord interpolate(const std::vector<TrajectoryRecord>& samples, double tau);
+	//! Cubic Hermite interpolation between two samples in the same coordinate system
+	static TrajectoryRecord hermite(const TrajectoryRecord& a, const TrajectoryRecord& b, double tau);
+};
+
+#endif
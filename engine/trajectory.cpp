@@ -0,0 +1,400 @@
+#include "trajectory.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(TrajectoryHeader) == 64, "TrajectoryHeader must have no padding");
+static_assert(sizeof(TrajectoryRecord) == 80, "TrajectoryRecord must have no padding");
+
+/*******************************************************************************
+ *
+ *  TrajectorySink class implementation
+ *
+ *******************************************************************************/
+
+TrajectorySink::TrajectorySink()
+{
+}
+
+TrajectorySink::~TrajectorySink()
+{
+}
+
+/*******************************************************************************
+ *
+ *  TrajectoryWriter class implementation
+ *
+ *******************************************************************************/
+
+TrajectoryWriter::TrajectoryWriter(const char* filename, double M, double a, int nCharts, int bufferSize)
+{
+	if(nCharts < 1 || nCharts > 8) throw "TrajectoryWriter: Invalid number of coordinate systems.";
+
+	f = fopen(filename, "wb");
+	if(!f) throw "TrajectoryWriter: Cannot create the file.";
+	buffer = new char[bufferSize];
+	setvbuf(f, buffer, _IOFBF, bufferSize);
+
+	TrajectoryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "GRTR", 4);
+	header.version = 1;
+	header.recordSize = sizeof(TrajectoryRecord);
+	header.nCharts = nCharts;
+	header.M = M;
+	header.a = a;
+	int i;
+	for(i = 0; i < 8; i++)
+		header.charts[i] = (i < nCharts) ? i : -1;
+
+	ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	nRecords = 0;
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+	close();
+}
+
+void TrajectoryWriter::write(const TrajectoryRecord& record)
+{
+	write(&record, 1);
+}
+
+void TrajectoryWriter::write(const TrajectoryRecord* records, int n)
+{
+	if(!f) throw "TrajectoryWriter: The file is closed.";
+	if(n <= 0) return;
+
+	ok = ok && fwrite(records, sizeof(TrajectoryRecord), n, f) == (size_t)n;
+
+	int i;
+	for(i = 0; i < n; i++)
+	{
+		if(runs.empty() || runs.back().traj != records[i].traj)
+		{
+			TrajectoryRun run;
+			run.traj = records[i].traj;
+			run.first = nRecords;
+			run.count = 0;
+			runs.push_back(run);
+		}
+		runs.back().count++;
+		nRecords++;
+	}
+}
+
+bool TrajectoryWriter::close()
+{
+	if(!f) return ok;
+
+	TrajectoryTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	trailer.indexOffset = sizeof(TrajectoryHeader) + nRecords*sizeof(TrajectoryRecord);
+	trailer.nRuns = runs.size();
+	memcpy(trailer.magic, "GRTI", 4);
+
+	if(!runs.empty())
+		ok = ok && fwrite(&runs[0], sizeof(TrajectoryRun), runs.size(), f) == runs.size();
+	ok = ok && fwrite(&trailer, sizeof(trailer), 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	f = NULL;
+
+	delete[] buffer;
+	buffer = NULL;
+	runs.clear();
+	return ok;
+}
+
+uint64_t TrajectoryWriter::getNRecords()
+{
+	return nRecords;
+}
+
+/*******************************************************************************
+ *
+ *  TrajectoryReader class implementation
+ *
+ *******************************************************************************/
+
+TrajectoryReader::TrajectoryReader()
+{
+	fd = -1;
+	data = NULL;
+	fileSize = 0;
+	header = NULL;
+	records = NULL;
+	nRecords = 0;
+	complete = false;
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+	close();
+}
+
+bool TrajectoryReader::open(const char* filename)
+{
+	close();
+
+	fd = ::open(filename, O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(TrajectoryHeader))
+	{
+		close();
+		return false;
+	}
+	fileSize = st.st_size;
+
+	void* p = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	if(p == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	data = (const char*)p;
+
+	header = (const TrajectoryHeader*)data;
+	if(memcmp(header->magic, "GRTR", 4) != 0 || header->version != 1 || header->recordSize != sizeof(TrajectoryRecord) ||
+		header->nCharts < 1 || header->nCharts > 8)
+	{
+		close();
+		return false;
+	}
+	records = (const TrajectoryRecord*)(data + sizeof(TrajectoryHeader));
+
+	//complete file - the index is read from the end
+	const TrajectoryTrailer* trailer = NULL;
+	if(fileSize >= sizeof(TrajectoryHeader) + sizeof(TrajectoryTrailer))
+		trailer = (const TrajectoryTrailer*)(data + fileSize - sizeof(TrajectoryTrailer));
+	if(trailer && memcmp(trailer->magic, "GRTI", 4) == 0 && trailer->indexOffset >= sizeof(TrajectoryHeader) &&
+		(trailer->indexOffset - sizeof(TrajectoryHeader)) % sizeof(TrajectoryRecord) == 0 &&
+		trailer->indexOffset + trailer->nRuns*sizeof(TrajectoryRun) + sizeof(TrajectoryTrailer) == fileSize)
+	{
+		nRecords = (trailer->indexOffset - sizeof(TrajectoryHeader))/sizeof(TrajectoryRecord);
+		const TrajectoryRun* index = (const TrajectoryRun*)(data + trailer->indexOffset);
+		runs.assign(index, index + trailer->nRuns);
+		complete = true;
+	}
+	else
+	{
+		//unfinished file - the whole records are used and the index is rebuilt
+		nRecords = (fileSize - sizeof(TrajectoryHeader))/sizeof(TrajectoryRecord);
+		uint64_t i;
+		for(i = 0; i < nRecords; i++)
+		{
+			if(runs.empty() || runs.back().traj != records[i].traj)
+			{
+				TrajectoryRun run;
+				run.traj = records[i].traj;
+				run.first = i;
+				run.count = 0;
+				runs.push_back(run);
+			}
+			runs.back().count++;
+		}
+		complete = false;
+	}
+
+	uint64_t i;
+	for(i = 0; i < runs.size(); i++)
+		trajRuns[runs[i].traj].push_back(i);
+	return true;
+}
+
+void TrajectoryReader::close()
+{
+	if(data) munmap((void*)data, fileSize);
+	if(fd >= 0) ::close(fd);
+	fd = -1;
+	data = NULL;
+	fileSize = 0;
+	header = NULL;
+	records = NULL;
+	nRecords = 0;
+	runs.clear();
+	trajRuns.clear();
+	complete = false;
+}
+
+double TrajectoryReader::getMass()
+{
+	if(!header) throw "TrajectoryReader: No file.";
+	return header->M;
+}
+
+double TrajectoryReader::getAngMomentum()
+{
+	if(!header) throw "TrajectoryReader: No file.";
+	return header->a;
+}
+
+int TrajectoryReader::getNCharts()
+{
+	if(!header) throw "TrajectoryReader: No file.";
+	return header->nCharts;
+}
+
+int TrajectoryReader::getChart(int i)
+{
+	if(!header) throw "TrajectoryReader: No file.";
+	if(i < 0 || i >= (int)header->nCharts) throw "TrajectoryReader: Index out of bounds.";
+	return header->charts[i];
+}
+
+bool TrajectoryReader::isComplete()
+{
+	return complete;
+}
+
+uint64_t TrajectoryReader::getNRecords()
+{
+	return nRecords;
+}
+
+const TrajectoryRecord* TrajectoryReader::getRecords()
+{
+	return records;
+}
+
+const TrajectoryRecord& TrajectoryReader::getRecord(uint64_t i)
+{
+	if(i >= nRecords) throw "TrajectoryReader: Index out of bounds.";
+	return records[i];
+}
+
+uint64_t TrajectoryReader::getNRuns()
+{
+	return runs.size();
+}
+
+TrajectoryRun TrajectoryReader::getRun(uint64_t i)
+{
+	if(i >= runs.size()) throw "TrajectoryReader: Index out of bounds.";
+	return runs[i];
+}
+
+std::vector<TrajectoryRun> TrajectoryReader::findRuns(uint64_t traj)
+{
+	std::vector<TrajectoryRun> result;
+	std::map<uint64_t, std::vector<uint64_t> >::iterator it = trajRuns.find(traj);
+	if(it == trajRuns.end()) return result;
+	unsigned i;
+	for(i = 0; i < it->second.size(); i++)
+		result.push_back(runs[it->second[i]]);
+	return result;
+}
+
+std::vector<uint64_t> TrajectoryReader::getTrajectories()
+{
+	std::vector<uint64_t> result;
+	std::map<uint64_t, std::vector<uint64_t> >::iterator it;
+	for(it = trajRuns.begin(); it != trajRuns.end(); it++)
+		result.push_back(it->first);
+	return result;
+}
+
+Point TrajectoryReader::getPos(const TrajectoryRecord& r)
+{
+	return Point(r.chart, r.x[0], r.x[1], r.x[2], r.x[3]);
+}
+
+vector4 TrajectoryReader::getVel(const TrajectoryRecord& r)
+{
+	return vector4(r.u[0], r.u[1], r.u[2], r.u[3]);
+}
+
+/*******************************************************************************
+ *
+ *  AsyncTrajectoryWriter class implementation
+ *
+ *******************************************************************************/
+
+AsyncTrajectoryWriter::AsyncTrajectoryWriter(TrajectoryWriter* _out, int capacity, int _batchSize)
+	: queue(capacity), stopping(false), failed(false), closed(false), records(0), batches(0), fullWaits(0), occupancySum(0), occupancyMax(0)
+{
+	if(!_out) throw "AsyncTrajectoryWriter: No output.";
+	out = _out;
+	batchSize = (_batchSize < 1) ? 1 : _batchSize;
+	startTime = stopTime = std::chrono::steady_clock::now();
+	thread = std::thread(&AsyncTrajectoryWriter::run, this);
+}
+
+AsyncTrajectoryWriter::~AsyncTrajectoryWriter()
+{
+	close();
+}
+
+void AsyncTrajectoryWriter::write(const TrajectoryRecord& record)
+{
+	if(closed) throw "AsyncTrajectoryWriter: The writer is closed.";
+	if(queue.push(record)) return;
+
+	fullWaits.fetch_add(1, std::memory_order_relaxed);
+	while(!queue.push(record))
+		std::this_thread::yield();
+}
+
+void AsyncTrajectoryWriter::run()
+{
+	std::vector<TrajectoryRecord> batch(batchSize);
+	for(;;)
+	{
+		//read before popping - once it is set, an empty queue means there is nothing more to come
+		bool last = stopping.load(std::memory_order_acquire);
+
+		uint64_t occupancy = queue.size();
+		int n = 0;
+		while(n < batchSize && queue.pop(batch[n]))
+			n++;
+
+		if(n > 0)
+		{
+			occupancySum.fetch_add(occupancy, std::memory_order_relaxed);
+			if(occupancy > occupancyMax.load(std::memory_order_relaxed))
+				occupancyMax.store(occupancy, std::memory_order_relaxed);
+			try
+			{
+				out->write(&batch[0], n);
+				records.fetch_add(n, std::memory_order_relaxed);
+				batches.fetch_add(1, std::memory_order_relaxed);
+			}
+			catch(...)
+			{
+				failed = true;
+			}
+		}
+		else if(last) break;
+		else std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+bool AsyncTrajectoryWriter::close()
+{
+	if(closed.exchange(true)) return !failed;
+	stopping.store(true, std::memory_order_release);
+	thread.join();
+	stopTime = std::chrono::steady_clock::now();
+	if(!out->close()) failed = true;
+	return !failed;
+}
+
+AsyncWriterStats AsyncTrajectoryWriter::getStats()
+{
+	AsyncWriterStats s;
+	s.records = records.load(std::memory_order_relaxed);
+	s.batches = batches.load(std::memory_order_relaxed);
+	s.fullWaits = fullWaits.load(std::memory_order_relaxed);
+
+	std::chrono::steady_clock::time_point end = closed ? stopTime : std::chrono::steady_clock::now();
+	s.time = std::chrono::duration<double>(end - startTime).count();
+	s.recordsPerSecond = (s.time > 0.0) ? s.records/s.time : 0.0;
+	s.bytesPerSecond = s.recordsPerSecond*sizeof(TrajectoryRecord);
+	s.meanOccupancy = s.batches ? (double)occupancySum.load(std::memory_order_relaxed)/s.batches/queue.capacity() : 0.0;
+	s.maxOccupancy = (double)occupancyMax.load(std::memory_order_relaxed)/queue.capacity();
+	return s;
+}
@@ -0,0 +1,260 @@
+#ifndef __TRAJECTORY_H__
+#define __TRAJECTORY_H__
+
+/*! \file trajectory.h
+ * \brief Binary output of trajectories and its memory-mapped reader
+ *
+ * The file consists of a fixed 64-byte header (TrajectoryHeader), fixed-size records (TrajectoryRecord) in the order in which
+ * they were written, and an index of the runs of consecutive records of one trajectory followed by a trailer (TrajectoryTrailer).
+ * The index is written when the file is closed - if it is missing (the writer did not finish), the reader rebuilds it by scanning
+ * the records. All values are stored in the native byte order.
+ */
+
+#include "geometry.h"
+#include "boundedqueue.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+/*! \struct TrajectoryHeader
+ * \brief The header of a trajectory file
+ */
+struct TrajectoryHeader
+{
+	char magic[4];		///< "GRTR"
+	uint32_t version;	///< Format version (1)
+	uint32_t recordSize;	///< sizeof(TrajectoryRecord)
+	uint32_t nCharts;	///< Number of the coordinate systems of the manifold
+	double M;			///< Mass of the central body
+	double a;			///< Angular momentum parameter (0 for Schwarzschild)
+	int32_t charts[8];	///< IDs of the coordinate systems used in the records (-1 - unused)
+};
+
+/*! \struct TrajectoryRecord
+ * \brief The state of a trajectory after a step
+ */
+struct TrajectoryRecord
+{
+	uint32_t traj;		///< ID of the trajectory
+	int32_t chart;		///< Coordinate system of the position and velocity
+	double tau;			///< Proper time (affine parameter for photons)
+	double x[4];		///< Position
+	double u[4];		///< 4-velocity
+};
+
+/*! \struct TrajectoryRun
+ * \brief Entry of the index - consecutive records of a single trajectory
+ */
+struct TrajectoryRun
+{
+	uint64_t traj;		///< ID of the trajectory
+	uint64_t first;		///< Number of the first record
+	uint64_t count;		///< Number of the records
+};
+
+/*! \struct TrajectoryTrailer
+ * \brief The end of a complete trajectory file
+ */
+struct TrajectoryTrailer
+{
+	uint64_t indexOffset;	///< Position of the index in the file
+	uint64_t nRuns;			///< Number of the entries in the index
+	char magic[4];			///< "GRTI"
+	uint32_t reserved;
+};
+
+/*! \class TrajectorySink
+ * \brief Base class for the outputs of trajectory records
+ *
+ * See Particle::setTrajectorySink.
+ */
+class TrajectorySink
+{
+public:
+	//! Constructor
+	TrajectorySink();
+	//! Virtual destructor
+	virtual ~TrajectorySink();
+
+	//! Writes a record
+	virtual void write(const TrajectoryRecord&) = 0;
+};
+
+/*! \class TrajectoryWriter
+ * \brief Append-only writer of trajectory files
+ *
+ * The records are buffered and written sequentially, the index is kept in memory and written by \a close. The index has an entry
+ * for every change of the trajectory between consecutive records, so it stays small when trajectories are written one after
+ * another, and grows up to a third of the data when many particles are propagated in lockstep.
+ * The writer is not thread-safe - see AsyncTrajectoryWriter for writing from many threads.
+ */
+class TrajectoryWriter : public TrajectorySink
+{
+	FILE* f;
+	char* buffer;
+	uint64_t nRecords;
+	std::vector<TrajectoryRun> runs;
+	bool ok;
+
+	TrajectoryWriter(const TrajectoryWriter&);
+	TrajectoryWriter& operator=(const TrajectoryWriter&);
+public:
+	//! Constructor - creates the file and writes the header
+	/*! \param filename Name of the file
+	 *  \param M Mass of the central body
+	 *  \param a Angular momentum parameter
+	 *  \param nCharts Number of the coordinate systems (at most 8, see Manifold::getNCoordSystems)
+	 *  \param bufferSize Size of the write buffer in bytes
+	 */
+	TrajectoryWriter(const char* filename, double M, double a, int nCharts, int bufferSize = 1 << 20);
+	//! Destructor - closes the file if it is still open
+	~TrajectoryWriter();
+
+	void write(const TrajectoryRecord&);
+	//! Writes a block of records
+	void write(const TrajectoryRecord* records, int n);
+	//! Writes the index and closes the file
+	/*! \return true if all writes succeeded
+	 */
+	bool close();
+
+	//! Returns the number of the records written so far
+	uint64_t getNRecords();
+};
+
+/*! \struct AsyncWriterStats
+ * \brief Statistics of an asynchronous writer
+ */
+struct AsyncWriterStats
+{
+	uint64_t records;		///< Number of the written records (the records of the failed writes are not counted)
+	uint64_t batches;		///< Number of the successful writes to the file
+	uint64_t fullWaits;		///< Number of the records whose producers had to wait for space in the queue
+	double time;			///< Time since the writer was started in seconds
+	double recordsPerSecond;	///< Average throughput
+	double bytesPerSecond;	///< Average throughput
+	double meanOccupancy;	///< Average fraction of the queue in use, sampled before every batch
+	double maxOccupancy;	///< Largest sampled fraction of the queue in use
+};
+
+/*! \class AsyncTrajectoryWriter
+ * \brief Writes trajectory records from many threads through a background thread
+ *
+ * The propagating threads only push the records into a bounded lock-free queue (BoundedQueue); a background thread pops them
+ * in batches and passes every batch to a TrajectoryWriter in a single call, so the propagation never waits for the disk.
+ * If the queue is full, the producers yield until there is space (backpressure) - the waits are counted in the statistics,
+ * and a high count means the disk cannot keep up with the propagation.
+ * The records of one producer stay in order, but the records of different producers are interleaved - the index of the file
+ * grows with the number of interleavings.
+ */
+class AsyncTrajectoryWriter : public TrajectorySink
+{
+	TrajectoryWriter* out;
+	BoundedQueue<TrajectoryRecord> queue;
+	int batchSize;
+	std::thread thread;
+	std::atomic<bool> stopping;
+	std::atomic<bool> failed;
+	std::atomic<bool> closed;
+
+	std::atomic<uint64_t> records, batches, fullWaits;
+	std::atomic<uint64_t> occupancySum, occupancyMax;
+	std::chrono::steady_clock::time_point startTime, stopTime;
+
+	//! The background thread
+	void run();
+
+	AsyncTrajectoryWriter(const AsyncTrajectoryWriter&);
+	AsyncTrajectoryWriter& operator=(const AsyncTrajectoryWriter&);
+public:
+	//! Constructor - starts the background thread
+	/*! \param _out The writer of the file (not owned, must not be used directly until \a close)
+	 *  \param capacity Number of the records fitting in the queue
+	 *  \param _batchSize Largest number of the records written in one call
+	 */
+	AsyncTrajectoryWriter(TrajectoryWriter* _out, int capacity = 1 << 16, int _batchSize = 4096);
+	//! Destructor - closes the writer if it is still open
+	~AsyncTrajectoryWriter();
+
+	//! Pushes a record into the queue - can be called from many threads
+	void write(const TrajectoryRecord&);
+	//! Writes the remaining records, stops the background thread and closes the file
+	/*! \return true if all records were written
+	 */
+	bool close();
+
+	//! Returns the statistics (can be called while writing)
+	AsyncWriterStats getStats();
+};
+
+/*! \class TrajectoryReader
+ * \brief Reader of trajectory files
+ *
+ * The file is memory-mapped, so the records are accessed in place, without copying - only the pages which are actually read
+ * are loaded, which makes files much larger than the memory usable.
+ */
+class TrajectoryReader
+{
+	int fd;
+	const char* data;
+	uint64_t fileSize;
+	const TrajectoryHeader* header;
+	const TrajectoryRecord* records;
+	uint64_t nRecords;
+	std::vector<TrajectoryRun> runs;
+	std::map<uint64_t, std::vector<uint64_t> > trajRuns;	///< Numbers of the runs of every trajectory
+	bool complete;
+
+	TrajectoryReader(const TrajectoryReader&);
+	TrajectoryReader& operator=(const TrajectoryReader&);
+public:
+	//! Constructor - no file
+	TrajectoryReader();
+	//! Destructor
+	~TrajectoryReader();
+
+	//! Maps a file
+	/*! \return true on success
+	 */
+	bool open(const char* filename);
+	//! Unmaps the file
+	void close();
+
+	//! Returns the mass of the central body
+	double getMass();
+	//! Returns the angular momentum parameter
+	double getAngMomentum();
+	//! Returns the number of the coordinate systems
+	int getNCharts();
+	//! Returns the ID of a coordinate system
+	int getChart(int i);
+	//! Returns true if the file has its index (it was closed properly)
+	bool isComplete();
+
+	//! Returns the number of the records
+	uint64_t getNRecords();
+	//! Returns all records
+	const TrajectoryRecord* getRecords();
+	//! Returns a record
+	const TrajectoryRecord& getRecord(uint64_t i);
+
+	//! Returns the number of the runs of consecutive records of single trajectories
+	uint64_t getNRuns();
+	//! Returns a run
+	TrajectoryRun getRun(uint64_t i);
+	//! Returns the runs of a trajectory, in the order of writing
+	std::vector<TrajectoryRun> findRuns(uint64_t traj);
+	//! Returns the IDs of all trajectories
+	std::vector<uint64_t> getTrajectories();
+
+	//! Returns the position of a record
+	static Point getPos(const TrajectoryRecord&);
+	//! Returns the 4-velocity of a record
+	static vector4 getVel(const TrajectoryRecord&);
+};
+
+#endif
@@ -0,0 +1,382 @@
+#include "transfer.h"
+#include "entity.h"
+#include "dpintegrator.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <thread>
+#include <chrono>
+
+/*
+ * Emissivity
+ */
+
+Emissivity::Emissivity()
+{
+}
+
+Emissivity::~Emissivity()
+{
+}
+
+PowerLawEmissivity::PowerLawEmissivity(double _q)
+{
+	q = _q;
+}
+
+PowerLawEmissivity::~PowerLawEmissivity()
+{
+}
+
+double PowerLawEmissivity::operator()(double r, double)
+{
+	return pow(r, -q);
+}
+
+/*
+ * TransferFunction
+ */
+
+TransferFunction::TransferFunction(KerrManifold* _m, double _rIn, double _rOut, int _n, double _size, double _rObs)
+	: totalSteps(0)
+{
+	m = _m;
+	M = m ? m->getMass() : 0.0;
+	a = m ? m->getAngMomentum() : 0.0;
+	rIn = _rIn;
+	rOut = _rOut;
+	n = _n;
+	size = _size;
+	rObs = _rObs;
+
+	nThreads = 0;
+	maxErr = 1e-8;
+	initStep = 1.0;
+	minStep = 1e-5;
+	maxStep = 100.0;
+	maxSteps = 100000;
+
+	totalTime = 0.0;
+}
+
+TransferFunction::~TransferFunction()
+{
+}
+
+void TransferFunction::setThreads(int _n)
+{
+	nThreads = _n;
+}
+
+void TransferFunction::setIntegrator(double _maxErr, double _initStep, double _minStep, double _maxStep)
+{
+	maxErr = _maxErr;
+	initStep = _initStep;
+	minStep = _minStep;
+	maxStep = _maxStep;
+}
+
+void TransferFunction::setMaxSteps(int _n)
+{
+	maxSteps = _n;
+}
+
+void TransferFunction::addInclination(double deg)
+{
+	if(deg <= 0.0 || deg >= 180.0) throw "TransferFunction: Invalid inclination.";
+	inclinations.push_back(deg);
+	tables.push_back(std::vector<TransferRecord>());
+}
+
+TransferRecord TransferFunction::traceRay(KerrManifold* man, GeodesicClassifier* cl, Integrator* integrator, std::vector<StopCondition*>& conditions, int incl, int x, int y)
+{
+	TransferRecord rec;
+	rec.r = rec.g = rec.cosEm = 0.0f;
+
+	//impact parameters of the pixel center
+	double alpha = (2*(x + 0.5)/n - 1.0)*size;
+	double beta = (1.0 - 2*(y + 0.5)/n)*size;
+
+	vector4* basis = &camBasis[4*incl];
+	double tx = alpha/rObs, ty = beta/rObs;
+	vector4 dir = (basis[1] + tx*basis[2] + ty*basis[3])/sqrt(1.0 + tx*tx + ty*ty);
+	vector4 k = dir - basis[0];		//past-directed - the photon is traced backwards
+
+	Particle ray(man, camPos[incl], k);
+	ray.setIntegrator(integrator);
+	integrator->resetStepSize();
+	unsigned i;
+	for(i = 0; i < conditions.size(); i++)
+		ray.addStopCondition(conditions[i]);
+
+	int steps = 0;
+	try
+	{
+		while(steps < maxSteps)
+		{
+			ray.propagate();
+			if(ray.isStopped()) break;
+			steps++;
+		}
+	}
+	catch(...)
+	{
+		totalSteps += steps;
+		return rec;
+	}
+	totalSteps += steps;
+
+	if(ray.getStopReason() != StopCondition::Disk) return rec;
+	double r = DiskCondition::crossingPoint(&ray)[1];
+
+	//the constants of motion are the same as at the observer
+	double E, L, Q, mu2;
+	cl->constantsOfMotion(camPos[incl], k, E, L, Q, mu2);
+
+	double Omega = sqrt(M)/(r*sqrt(r) + a*sqrt(M));
+	double norm = (1.0 - 2*M/r) + 2*(2*M*a/r)*Omega - (r*r + a*a + 2*M*a*a/r)*Omega*Omega;
+	if(norm <= 0.0) return rec;		//no timelike circular orbit
+	double ut = 1.0/sqrt(norm);
+
+	double kuEm = ut*(E - Omega*L);
+	double kuObs = man->getMetric(camPos[incl].getCoordSystem())->g(k, basis[0], camPos[incl]);
+
+	rec.r = r;
+	rec.g = kuObs/kuEm;
+	rec.cosEm = sqrt(fabs(Q))/r/fabs(kuEm);
+	return rec;
+}
+
+void TransferFunction::worker(KerrManifold* man, std::atomic<int>* nextRow)
+{
+	DPIntegrator dp(maxErr, initStep, minStep, maxStep);
+
+	//rays which are going to escape are stopped as soon as they leave the disk behind
+	GeodesicClassifier classifier(man);
+	FateCondition fate(&classifier);
+	fate.setExcludedShell(rIn, rOut);
+	DiskCondition disk(rIn, rOut);
+	HorizonCondition horizon(m->getHorizonRadius()*1.01);
+	EscapeCondition escape(2*rObs);
+
+	std::vector<StopCondition*> conditions;
+	conditions.push_back(&disk);
+	if(m->getHorizonRadius() > 0.0) conditions.push_back(&horizon);
+	conditions.push_back(&escape);
+	conditions.push_back(&fate);
+
+	int row, x;
+	while((row = (*nextRow)++) < n*(int)inclinations.size())
+	{
+		int incl = row/n;
+		int y = row%n;
+		for(x = 0; x < n; x++)
+			tables[incl][y*n + x] = traceRay(man, &classifier, &dp, conditions, incl, x, y);
+	}
+}
+
+void TransferFunction::compute()
+{
+	if(!m) throw "TransferFunction: No manifold.";
+
+	unsigned j;
+	int i;
+
+	//static observers looking at the black hole - local X towards the center, Y along phi, Z "up"
+	camPos.clear();
+	camBasis.clear();
+	for(j = 0; j < inclinations.size(); j++)
+	{
+		Point p(EF, 0.0, rObs, inclinations[j]*M_PI/180, 0.0);
+		double ut = 1.0/sqrt(m->getMetric(EF)->g(0, 0, p));
+		Entity camera(m, p, vector4(ut, 0.0, 0.0, 0.0),
+			vector4(0.0, -1.0, 0.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), vector4(0.0, 0.0, -1.0, 0.0));
+		camPos.push_back(camera.getPos());
+		for(i = 0; i < 4; i++)
+			camBasis.push_back(camera.getStateVector(i));
+		tables[j].assign(n*n, TransferRecord());
+	}
+
+	int nt = nThreads;
+	if(nt <= 0) nt = std::thread::hardware_concurrency();
+	if(nt > n*(int)inclinations.size()) nt = n*inclinations.size();
+	if(nt < 1) nt = 1;
+
+	//every thread needs its own manifold - the metrics cache their values
+	std::vector<KerrManifold*> copies;
+	copies.push_back(m);
+	for(i = 1; i < nt; i++)
+	{
+		KerrManifold* c = m->clone();
+		if(!c) break;
+		copies.push_back(c);
+	}
+
+	totalSteps = 0;
+	std::atomic<int> nextRow(0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for(i = 1; i < (int)copies.size(); i++)
+		threads.push_back(std::thread(&TransferFunction::worker, this, copies[i], &nextRow));
+	worker(m, &nextRow);
+	for(i = 0; i < (int)threads.size(); i++)
+		threads[i].join();
+
+	totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for(i = 1; i < (int)copies.size(); i++)
+		delete copies[i];
+}
+
+bool TransferFunction::save(const char* filename)
+{
+	unsigned i;
+	uint32_t header[3];
+	double params[6];
+
+	FILE* f = fopen(filename, "wb");
+	if(!f) return false;
+
+	header[0] = 1;
+	header[1] = n;
+	header[2] = inclinations.size();
+	params[0] = M;
+	params[1] = a;
+	params[2] = rIn;
+	params[3] = rOut;
+	params[4] = size;
+	params[5] = rObs;
+
+	bool ok = fwrite("GRTF", 1, 4, f) == 4;
+	ok = ok && fwrite(header, sizeof(uint32_t), 3, f) == 3;
+	ok = ok && fwrite(params, sizeof(double), 6, f) == 6;
+
+	uint64_t offset = 4 + 3*sizeof(uint32_t) + 6*sizeof(double) + inclinations.size()*(sizeof(double) + sizeof(uint64_t));
+	for(i = 0; i < inclinations.size(); i++)
+	{
+		ok = ok && fwrite(&inclinations[i], sizeof(double), 1, f) == 1;
+		ok = ok && fwrite(&offset, sizeof(uint64_t), 1, f) == 1;
+		offset += (uint64_t)n*n*sizeof(TransferRecord);
+	}
+
+	for(i = 0; i < tables.size(); i++)
+	{
+		if((int)tables[i].size() != n*n)
+		{
+			ok = false;
+			break;
+		}
+		ok = ok && fwrite(&tables[i][0], sizeof(TransferRecord), n*n, f) == (size_t)(n*n);
+	}
+
+	fclose(f);
+	return ok;
+}
+
+bool TransferFunction::load(const char* filename, int incl)
+{
+	unsigned i;
+	char magic[4];
+	uint32_t header[3];
+	double params[6];
+
+	FILE* f = fopen(filename, "rb");
+	if(!f) return false;
+
+	bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, "GRTF", 4) == 0;
+	ok = ok && fread(header, sizeof(uint32_t), 3, f) == 3 && header[0] == 1;
+	ok = ok && fread(params, sizeof(double), 6, f) == 6;
+	if(!ok)
+	{
+		fclose(f);
+		return false;
+	}
+
+	n = header[1];
+	M = params[0];
+	a = params[1];
+	rIn = params[2];
+	rOut = params[3];
+	size = params[4];
+	rObs = params[5];
+
+	std::vector<uint64_t> offsets(header[2]);
+	inclinations.assign(header[2], 0.0);
+	for(i = 0; i < header[2] && ok; i++)
+	{
+		ok = fread(&inclinations[i], sizeof(double), 1, f) == 1;
+		ok = ok && fread(&offsets[i], sizeof(uint64_t), 1, f) == 1;
+	}
+
+	tables.assign(header[2], std::vector<TransferRecord>());
+	for(i = 0; i < header[2] && ok; i++)
+	{
+		if(incl >= 0 && (int)i != incl) continue;
+		tables[i].resize(n*n);
+		ok = fseek(f, offsets[i], SEEK_SET) == 0;
+		ok = ok && fread(&tables[i][0], sizeof(TransferRecord), n*n, f) == (size_t)(n*n);
+	}
+
+	fclose(f);
+	return ok;
+}
+
+int TransferFunction::getNInclinations()
+{
+	return inclinations.size();
+}
+
+double TransferFunction::getInclination(int i)
+{
+	if(i < 0 || i >= (int)inclinations.size()) throw "TransferFunction: Index out of bounds.";
+	return inclinations[i];
+}
+
+int TransferFunction::getGridSize()
+{
+	return n;
+}
+
+double TransferFunction::getImageSize()
+{
+	return size;
+}
+
+TransferRecord TransferFunction::getRecord(int incl, int x, int y)
+{
+	if(incl < 0 || incl >= (int)tables.size() || (int)tables[incl].size() != n*n) throw "TransferFunction: Table not available.";
+	if(x < 0 || x >= n || y < 0 || y >= n) throw "TransferFunction: Index out of bounds.";
+	return tables[incl][y*n + x];
+}
+
+void TransferFunction::lineProfile(int incl, Emissivity& e, double gMin, double gMax, int nBins, double* flux)
+{
+	if(incl < 0 || incl >= (int)tables.size() || (int)tables[incl].size() != n*n) throw "TransferFunction: Table not available.";
+
+	int i;
+	for(i = 0; i < nBins; i++)
+		flux[i] = 0.0;
+
+	double area = (2*size/n)*(2*size/n);
+	for(i = 0; i < n*n; i++)
+	{
+		TransferRecord& rec = tables[incl][i];
+		if(rec.r <= 0.0f) continue;
+		int bin = (int)floor((rec.g - gMin)/(gMax - gMin)*nBins);
+		if(bin < 0 || bin >= nBins) continue;
+		double g2 = rec.g*rec.g;
+		flux[bin] += g2*g2*e(rec.r, rec.cosEm)*area;
+	}
+}
+
+double TransferFunction::getTotalTime()
+{
+	return totalTime;
+}
+
+long TransferFunction::getTotalSteps()
+{
+	return totalSteps;
+}
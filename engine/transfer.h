@@ -0,0 +1,182 @@
+#ifndef __TRANSFER_H__
+#define __TRANSFER_H__
+
+/*! \file transfer.h
+ * \brief Transfer functions of thin accretion disks around Kerr black holes
+ */
+
+#include "kerr.h"
+#include "numeric.h"
+#include "classifier.h"
+#include <vector>
+#include <atomic>
+
+/*! \struct TransferRecord
+ * \brief What a distant observer sees through a single point of the image plane
+ */
+struct TransferRecord
+{
+	float r;		///< Radius at which the ray crosses the disk (0 - the ray misses the disk)
+	float g;		///< Redshift factor - ratio of the observed and emitted photon energies
+	float cosEm;	///< Cosine of the emission angle (measured from the disk normal in the frame of the emitting gas)
+};
+
+/*! \class Emissivity
+ * \brief Base class for emissivity laws of the disk
+ */
+class Emissivity
+{
+public:
+	Emissivity();
+	virtual ~Emissivity();
+
+	//! Returns the emitted intensity
+	/*! \param r Radius of the emission point
+	 *  \param cosEm Cosine of the emission angle
+	 */
+	virtual double operator()(double r, double cosEm) = 0;
+};
+
+/*! \class PowerLawEmissivity
+ * \brief Isotropic emissivity proportional to r^-q
+ */
+class PowerLawEmissivity : public Emissivity
+{
+	double q;
+public:
+	//! Constructor
+	/*! \param _q The index of the power law
+	 */
+	PowerLawEmissivity(double _q = 3.0);
+	~PowerLawEmissivity();
+
+	double operator()(double r, double cosEm);
+};
+
+/*! \class TransferFunction
+ * \brief Class computing, storing and using the transfer functions of a thin disk
+ *
+ * The disk lies in the equatorial plane between rIn and rOut and its gas moves on prograde Keplerian orbits,
+ * Omega = sqrt(M)/(r^3/2 + a sqrt(M)). For every inclination of the observer, a square grid of image-plane coordinates
+ * (alpha, beta - impact parameters in units of M, alpha along phi, beta "up") is traced backwards from a static observer
+ * at a large distance until it crosses the disk. The observer's own (small) gravitational redshift is included in g.
+ *
+ * Only the crossing radius is taken from the integration. The redshift factor g = (k.u_obs)/(k.u_em) and the emission angle
+ * follow exactly from the constants of motion of the photon (E, L and the Carter constant Q, see GeodesicClassifier) - at the
+ * equator k.u_em = u^t (E - Omega L) and the momentum along the disk normal equals sqrt(Q)/r.
+ *
+ * The tables are stored in a binary file (native byte order):
+ * - header: "GRTF", uint32 version (1), uint32 grid size n, uint32 number of inclinations, and the doubles M, a, rIn, rOut,
+ *   image half-size and observer distance,
+ * - index: for every inclination the double inclination in degrees and the uint64 offset of its table from the start of the file,
+ * - tables: n*n TransferRecords (3 floats each), row by row from the top of the image.
+ *
+ * A single table can therefore be read without reading the others. Line profiles for any emissivity law are then computed
+ * by summing over the table (\a lineProfile), without any integration.
+ */
+class TransferFunction
+{
+protected:
+	KerrManifold* m;
+	double M, a;
+	double rIn, rOut;
+	int n;
+	double size;
+	double rObs;
+
+	int nThreads;
+	double maxErr, initStep, minStep, maxStep;
+	int maxSteps;
+
+	std::vector<double> inclinations;
+	std::vector< std::vector<TransferRecord> > tables;
+	double totalTime;
+	std::atomic<long> totalSteps;
+
+	std::vector<Point> camPos;		///< Positions of the observers (one per inclination)
+	std::vector<vector4> camBasis;	///< Local bases of the observers (four vectors per inclination)
+
+	//! Traces a single ray
+	/*! \param man The manifold of the calling thread
+	 *  \param cl The classifier of the calling thread
+	 *  \param integrator The integrator of the calling thread
+	 *  \param conditions The stop conditions of the calling thread
+	 *  \param incl Number of the inclination
+	 *  \param x Column of the grid
+	 *  \param y Row of the grid
+	 */
+	TransferRecord traceRay(KerrManifold* man, GeodesicClassifier* cl, Integrator* integrator, std::vector<StopCondition*>& conditions, int incl, int x, int y);
+	//! Worker thread - computes rows until there are none left
+	void worker(KerrManifold* man, std::atomic<int>* nextRow);
+public:
+	//! Constructor
+	/*! \param _m The manifold (may be NULL if the tables are going to be loaded)
+	 *  \param _rIn Inner radius of the disk
+	 *  \param _rOut Outer radius of the disk
+	 *  \param _n Size of the image-plane grid
+	 *  \param _size Half-size of the image plane in units of M
+	 *  \param _rObs Distance of the observer
+	 */
+	TransferFunction(KerrManifold* _m, double _rIn, double _rOut, int _n = 128, double _size = 25.0, double _rObs = 1000.0);
+	//! Destructor
+	virtual ~TransferFunction();
+
+	//! Sets the number of threads (0 - default, one per hardware thread)
+	void setThreads(int);
+	//! Sets the parameters of the Dormand-Prince integrators used for tracing
+	void setIntegrator(double _maxErr, double _initStep, double _minStep, double _maxStep);
+	//! Sets the maximal number of steps for a single ray (default 100000)
+	void setMaxSteps(int);
+
+	//! Adds an inclination of the observer
+	/*! \param deg Inclination in degrees, 0 < deg < 180
+	 */
+	void addInclination(double deg);
+	//! Computes the tables for all inclinations
+	void compute();
+
+	//! Writes the tables to a file
+	/*! \return true on success
+	 */
+	bool save(const char* filename);
+	//! Reads the tables from a file (replaces all the parameters and tables)
+	/*! \param filename The file
+	 *  \param incl Number of the only table to be read (-1 - all); the remaining tables are left empty
+	 *  \return true on success
+	 */
+	bool load(const char* filename, int incl = -1);
+
+	//! Returns the number of inclinations
+	int getNInclinations();
+	//! Returns an inclination in degrees
+	double getInclination(int i);
+	//! Returns the size of the grid
+	int getGridSize();
+	//! Returns the half-size of the image plane
+	double getImageSize();
+	//! Returns a record
+	/*! \param incl Number of the inclination
+	 *  \param x Column (alpha grows with x)
+	 *  \param y Row (beta decreases with y)
+	 */
+	TransferRecord getRecord(int incl, int x, int y);
+
+	//! Computes the profile of a line emitted by the disk
+	/*! Every pixel contributes g^4 * emissivity * (pixel area) to the bin containing g - the observed energy flux of a line
+	 *  emitted at a single energy E0, as a function of E/E0.
+	 *  \param incl Number of the inclination
+	 *  \param e The emissivity law
+	 *  \param gMin Lower end of the energy range (in units of E0)
+	 *  \param gMax Upper end of the energy range
+	 *  \param nBins Number of bins
+	 *  \param flux Array receiving the flux in the bins (the flux per unit energy is flux/bin width)
+	 */
+	void lineProfile(int incl, Emissivity& e, double gMin, double gMax, int nBins, double* flux);
+
+	//! Returns the wall time of the last computation in seconds
+	double getTotalTime();
+	//! Returns the total number of integration steps of the last computation
+	long getTotalSteps();
+};
+
+#endif
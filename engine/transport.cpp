@@ -0,0 +1,142 @@
+#include "transport.h"
+#include "counters.h"
+#include "profiler.h"
+#include <math.h>
+
+TransportParticle::TransportParticle(Manifold* _m, Point _p, vector4 _u)
+	: Particle(_m, _p, _u)
+{
+}
+
+TransportParticle::~TransportParticle()
+{
+}
+
+int TransportParticle::addVector(vector4 v)
+{
+	vectors.push_back(v);
+	return vectors.size() - 1;
+}
+
+void TransportParticle::clearVectors()
+{
+	vectors.clear();
+}
+
+int TransportParticle::getNVectors()
+{
+	return vectors.size();
+}
+
+vector4 TransportParticle::getVector(int i)
+{
+	if(i < 0 || i >= (int)vectors.size()) throw "TransportParticle: Index out of bounds.";
+	return vectors[i];
+}
+
+void TransportParticle::setVector(int i, vector4 v)
+{
+	if(i < 0 || i >= (int)vectors.size()) throw "TransportParticle: Index out of bounds.";
+	vectors[i] = v;
+}
+
+StateVector TransportParticle::constructState()
+{
+	StateVector v = Particle::constructState();
+	unsigned int n;
+	int i;
+	for(n = 0; n < vectors.size(); n++)
+		for(i = 0; i < 4; i++)
+			v.push_back(vectors[n][i]);
+	return v;
+}
+
+void TransportParticle::setState(StateVector v)
+{
+	Particle::setState(v);
+	unsigned int n;
+	int i;
+	for(n = 0; n < vectors.size(); n++)
+		for(i = 0; i < 4; i++)
+			vectors[n][i] = v[8 + 4*n + i];
+}
+
+void TransportParticle::setCoordSystem(int sys)
+{
+	if(sys == p.getCoordSystem()) return;
+	unsigned int n;
+	for(n = 0; n < vectors.size(); n++)
+		vectors[n] = m->convertVectorTo(vectors[n], p, sys);
+	Particle::setCoordSystem(sys);
+}
+
+StateVector TransportParticle::derivative(StateVector v)
+{
+	GR_COUNT(Derivative);
+	GR_PROFILE_SCOPE(Derivative);
+	Point p1 = getPosFromState(v);
+	vector4 u1 = getVelFromState(v);
+	unsigned int n;
+	int i, j, k;
+
+	double gamma[4][4][4], A[4][4];
+	m->getMetric(p.getCoordSystem())->christoffel(p1, gamma);
+	for(i = 0; i < 4; i++)
+		for(k = 0; k < 4; k++)
+		{
+			A[i][k] = 0.0;
+			for(j = 0; j < 4; j++)
+				A[i][k] += gamma[i][j][k]*u1[j];
+		}
+
+	StateVector result(v.size());
+	for(i = 0; i < 4; i++)
+	{
+		double du = 0.0;
+		for(k = 0; k < 4; k++)
+			du -= A[i][k]*u1[k];
+		result[2*i] = u1[i];
+		result[2*i + 1] = du;
+	}
+	for(n = 0; n < vectors.size(); n++)
+	{
+		int base = 8 + 4*n;
+		for(i = 0; i < 4; i++)
+		{
+			double dv = 0.0;
+			for(k = 0; k < 4; k++)
+				dv -= A[i][k]*v[base + k];
+			result[base + i] = dv;
+		}
+	}
+	return result;
+}
+
+double TransportParticle::errorNorm(StateVector error)
+{
+	double result = 0.0;
+	int i;
+	for(i = 0; i < 8; i++)
+		result += error[i]*error[i];
+	return sqrt(result);
+}
+
+void TransportParticle::saveState(StateWriter& w)
+{
+	Particle::saveState(w);
+	unsigned int n;
+	w.putInt(vectors.size());
+	for(n = 0; n < vectors.size(); n++)
+		w.putDoubles(&vectors[n][0], 4);
+}
+
+void TransportParticle::loadState(StateReader& r)
+{
+	Particle::loadState(r);
+	int n = r.getInt();
+	if(n < 0) throw "TransportParticle: Invalid number of vectors.";
+	vectors.resize(n);
+	int i;
+	for(i = 0; i < n; i++)
+		r.getDoubles(&vectors[i][0], 4);
+}
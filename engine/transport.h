@@ -0,0 +1,73 @@
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+
+/*! \file transport.h
+ * \brief Header for the TransportParticle class - a particle parallel transporting vectors along its geodesic.
+ */
+
+#include "particle.h"
+#include <vector>
+
+/*! \class TransportParticle
+ * \brief Particle carrying any number of vectors parallel transported along its geodesic
+ *
+ * The vectors (e.g. polarization vectors, gyroscope spins or frames of Jacobi fields) satisfy dv^i/dtau = -A^i_k v^k with
+ * A^i_k = Gamma^i_jk u^j. The table of the Christoffel symbols is fetched once per evaluation of the equation
+ * (Metric::christoffel(Point, double[4][4][4])), A is formed once, and it is applied to the 4-velocity and all the vectors as a
+ * single matrix product - the cost of a carried vector is 16 multiplications. Tensors can be transported as combinations of
+ * products of carried vectors (e.g. a transported frame).
+ *
+ * The state of the particle is followed by the components of the vectors, one vector after another. The vectors do not take
+ * part in the error control of adaptive integrators (errorNorm), so the steps are the same as those of a Particle.
+ */
+class TransportParticle : public Particle
+{
+	std::vector<vector4> vectors;
+
+	TransportParticle(const TransportParticle&);
+	TransportParticle& operator=(const TransportParticle&);
+protected:
+	//! Constructs a state vector from the internal state.
+	StateVector constructState();
+	//! Sets the internal state to a state represented by a StateVector.
+	void setState(StateVector);
+public:
+	//! Constructor
+	/*! \param _m The manifold on which the particle is defined
+	 *  \param _p The initial position
+	 *  \param _u The initial 4-velocity
+	 */
+	TransportParticle(Manifold* _m, Point _p, vector4 _u);
+	//! Destructor
+	~TransportParticle();
+
+	//! Adds a vector to be transported (in the current coordinate system)
+	/*! \return The index of the vector
+	 */
+	int addVector(vector4 v);
+	//! Removes all the vectors
+	void clearVectors();
+	//! Returns the number of the transported vectors
+	int getNVectors();
+	//! Returns a transported vector (in the current coordinate system)
+	vector4 getVector(int i);
+	//! Replaces a transported vector (in the current coordinate system)
+	void setVector(int i, vector4 v);
+
+	//! Overloaded method from \a DiffEq
+	/*! \param v Current state
+	 *  \return The derivative of the current state as given by the geodesic equation and the parallel transport.
+	 */
+	StateVector derivative(StateVector v);
+	//! Overloaded method from \a DiffEq - the error of the position and 4-velocity only
+	double errorNorm(StateVector error);
+	//! Overloaded method changing the coordinate system in use - converts the vectors too
+	void setCoordSystem(int);
+
+	//! Serializes the state of the particle (the state of Particle and the vectors)
+	void saveState(StateWriter&);
+	//! Restores the state of the particle (the number of the vectors is restored too)
+	void loadState(StateReader&);
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "variational.h"
+#include "counters.h"
+#include "profiler.h"
+#include <math.h>
+
+//relative step of the central differences - about the cube root of the machine epsilon
+static const double diffStep = 6e-6;
+
+/*******************************************************************************
+ *
+ *  GeodesicLinearization class implementation
+ *
+ *******************************************************************************/
+
+GeodesicLinearization::GeodesicLinearization(Manifold* m)
+{
+	nParams = m->getNParameters();
+	params = NULL;
+	if(nParams > 0)
+	{
+		params = m->clone();
+		if(!params) throw "GeodesicLinearization: The manifold cannot be copied.";
+	}
+	dGammaParam.resize(4*nParams);
+}
+
+GeodesicLinearization::~GeodesicLinearization()
+{
+	delete params;
+}
+
+int GeodesicLinearization::getNParameters()
+{
+	return nParams;
+}
+
+void GeodesicLinearization::compute(Manifold* m, Point p, vector4 u)
+{
+	int chart = p.getCoordSystem();
+	int i, j, k;
+
+	//the shifted points go first, so that the cache of the metric keeps the values at p for the rest
+	Metric* metric = m -> getMetric(chart);
+	for(k = 0; k < 4; k++)
+	{
+		if(metric -> isIgnorable(k))
+		{
+			for(i = 0; i < 4; i++)
+				dGamma[k][i] = 0.0;
+			continue;
+		}
+		double h = diffStep*(1.0 + fabs(p[k]));
+		Point p1 = p, p2 = p;
+		p1[k] += h;
+		p2[k] -= h;
+		vector4 d = (metric -> christoffel(u, u, p1) - metric -> christoffel(u, u, p2))/(2*h);
+		for(i = 0; i < 4; i++)
+			dGamma[k][i] = d[i];
+	}
+	//the copy follows the parameters of the manifold
+	for(k = 0; k < nParams; k++)
+		params -> setParameter(k, m -> getParameter(k));
+	for(k = 0; k < nParams; k++)
+	{
+		double value = m -> getParameter(k);
+		double h = diffStep*(1.0 + fabs(value));
+		params -> setParameter(k, value + h);
+		vector4 g1 = params -> getMetric(chart) -> christoffel(u, u, p);
+		params -> setParameter(k, value - h);
+		vector4 g2 = params -> getMetric(chart) -> christoffel(u, u, p);
+		params -> setParameter(k, value);
+		for(i = 0; i < 4; i++)
+			dGammaParam[4*k + i] = (g1[i] - g2[i])/(2*h);
+	}
+
+	for(i = 0; i < 4; i++)
+	{
+		gamma[i] = 0.0;
+		for(j = 0; j < 4; j++)
+		{
+			gammaU[i][j] = 0.0;
+			for(k = 0; k < 4; k++)
+				gammaU[i][j] += metric -> christoffel(i, j, k, p)*u[k];
+			gamma[i] += gammaU[i][j]*u[j];
+		}
+	}
+}
+
+void stateConversionJacobian(Manifold* m, Point p, vector4 u, int system, double J[8][8])
+{
+	//dx'/dx, du'/dx (the conversion of u differentiated numerically), du'/du = dx'/dx
+	CoordinateConversion* c = m->getConversion(p.getCoordSystem(), system);
+	int i, j, k;
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < 8; j++)
+			J[i][j] = 0.0;
+	for(i = 0; i < 4; i++)
+		for(j = 0; j < 4; j++)
+			J[i][j] = J[i + 4][j + 4] = c->inv_jacobian(i, j, p);
+	for(k = 0; k < 4; k++)
+	{
+		double h = diffStep*(1.0 + fabs(p[k]));
+		Point p1 = p, p2 = p;
+		p1[k] += h;
+		p2[k] -= h;
+		vector4 du = (m->convertVectorTo(u, p1, system) - m->convertVectorTo(u, p2, system))/(2*h);
+		for(i = 0; i < 4; i++)
+			J[i + 4][k] = du[i];
+	}
+}
+
+/*******************************************************************************
+ *
+ *  VariationalParticle class implementation
+ *
+ *******************************************************************************/
+
+VariationalParticle::VariationalParticle(Manifold* _m, Point _p, vector4 _u)
+	: Particle(_m, _p, _u), jacobian(_m)
+{
+	nParams = jacobian.getNParameters();
+	sens.resize(8*nParams);
+	resetVariations();
+}
+
+VariationalParticle::~VariationalParticle()
+{
+}
+
+void VariationalParticle::resetVariations()
+{
+	int i, j;
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < 8; j++)
+			phi[i][j] = (i == j) ? 1.0 : 0.0;
+	for(i = 0; i < 8*nParams; i++)
+		sens[i] = 0.0;
+}
+
+int VariationalParticle::getNParameters()
+{
+	return nParams;
+}
+
+double VariationalParticle::getTransition(int i, int j)
+{
+	if(i < 0 || i >= 8 || j < 0 || j >= 8) throw "VariationalParticle: Index out of bounds.";
+	return phi[i][j];
+}
+
+double VariationalParticle::getSensitivity(int i, int k)
+{
+	if(i < 0 || i >= 8 || k < 0 || k >= nParams) throw "VariationalParticle: Index out of bounds.";
+	return sens[i*nParams + k];
+}
+
+StateVector VariationalParticle::constructState()
+{
+	StateVector v = Particle::constructState();
+	int i, j;
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < 8; j++)
+			v.push_back(phi[i][j]);
+	for(i = 0; i < 8*nParams; i++)
+		v.push_back(sens[i]);
+	return v;
+}
+
+void VariationalParticle::setState(StateVector v)
+{
+	Particle::setState(v);
+	int i, j;
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < 8; j++)
+			phi[i][j] = v[8 + 8*i + j];
+	for(i = 0; i < 8*nParams; i++)
+		sens[i] = v[72 + i];
+}
+
+void VariationalParticle::setPosVel(Point _p, vector4 _u)
+{
+	Particle::setPosVel(_p, _u);
+	resetVariations();
+}
+
+void VariationalParticle::setVel(vector4 _u)
+{
+	Particle::setVel(_u);
+	resetVariations();
+}
+
+void VariationalParticle::setCoordSystem(int sys)
+{
+	if(sys == p.getCoordSystem()) return;
+
+	double J[8][8];
+	int i, j, k;
+	stateConversionJacobian(m, p, u, sys, J);
+
+	double old[8][8];
+	std::vector<double> oldSens = sens;
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < 8; j++)
+			old[i][j] = phi[i][j];
+	for(i = 0; i < 8; i++)
+	{
+		for(j = 0; j < 8; j++)
+		{
+			phi[i][j] = 0.0;
+			for(k = 0; k < 8; k++)
+				phi[i][j] += J[i][k]*old[k][j];
+		}
+		for(j = 0; j < nParams; j++)
+		{
+			sens[i*nParams + j] = 0.0;
+			for(k = 0; k < 8; k++)
+				sens[i*nParams + j] += J[i][k]*oldSens[k*nParams + j];
+		}
+	}
+
+	Particle::setCoordSystem(sys);
+}
+
+StateVector VariationalParticle::derivative(StateVector v)
+{
+	GR_COUNT(Derivative);
+	GR_PROFILE_SCOPE(Derivative);
+	Point p1 = getPosFromState(v);
+	vector4 u1 = getVelFromState(v);
+	int i, j, l;
+	jacobian.compute(m, p1, u1);
+
+	StateVector result;
+	for(i = 0; i < 4; i++)
+	{
+		result.push_back(u1[i]);
+		result.push_back(-jacobian.gamma[i]);
+	}
+
+	//d(dx)/dtau = du, d(du)/dtau = -d_k Gamma(u,u) dx^k - 2 Gamma(u,du) (- d_p Gamma(u,u) for the sensitivities)
+	int nCols = 8 + nParams;
+	std::vector<double> dx(4*nCols), ddu(4*nCols);
+	for(j = 0; j < nCols; j++)
+	{
+		double x[4], w[4];
+		for(i = 0; i < 4; i++)
+		{
+			x[i] = (j < 8) ? v[8 + 8*i + j] : v[72 + i*nParams + j - 8];
+			w[i] = (j < 8) ? v[8 + 8*(i + 4) + j] : v[72 + (i + 4)*nParams + j - 8];
+		}
+		for(i = 0; i < 4; i++)
+		{
+			double d = (j >= 8) ? -jacobian.dGammaParam[4*(j - 8) + i] : 0.0;
+			for(l = 0; l < 4; l++)
+				d -= 2*jacobian.gammaU[i][l]*w[l] + x[l]*jacobian.dGamma[l][i];
+			dx[4*j + i] = w[i];
+			ddu[4*j + i] = d;
+		}
+	}
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < 8; j++)
+			result.push_back((i < 4) ? dx[4*j + i] : ddu[4*j + i - 4]);
+	for(i = 0; i < 8; i++)
+		for(j = 0; j < nParams; j++)
+			result.push_back((i < 4) ? dx[4*(8 + j) + i] : ddu[4*(8 + j) + i - 4]);
+	return result;
+}
+
+double VariationalParticle::errorNorm(StateVector error)
+{
+	double result = 0.0;
+	int i;
+	for(i = 0; i < 8; i++)
+		result += error[i]*error[i];
+	return sqrt(result);
+}
+
+void VariationalParticle::saveState(StateWriter& w)
+{
+	Particle::saveState(w);
+	w.putDoubles(phi[0], 64);
+	if(nParams > 0) w.putDoubles(&sens[0], 8*nParams);
+}
+
+void VariationalParticle::loadState(StateReader& r)
+{
+	Particle::loadState(r);
+	r.getDoubles(phi[0], 64);
+	if(nParams > 0) r.getDoubles(&sens[0], 8*nParams);
+}
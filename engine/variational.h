@@ -0,0 +1,133 @@
+#ifndef __VARIATIONAL_H__
+#define __VARIATIONAL_H__
+
+/*! \file variational.h
+ * \brief Header for the VariationalParticle class - a particle propagating its sensitivities along with the geodesic.
+ */
+
+#include "particle.h"
+#include <vector>
+
+/*! \class GeodesicLinearization
+ * \brief The Jacobian of the geodesic equation at a state, used by the variational and the adjoint equations
+ *
+ * The derivatives of the Christoffel symbols are calculated by central differences of Metric::christoffel, with respect to
+ * the coordinates on the manifold and with respect to the parameters on a private copy of it (Manifold::clone). The
+ * coordinates the metric does not depend on (Metric::isIgnorable) are skipped.
+ */
+class GeodesicLinearization
+{
+	int nParams;
+	Manifold* params;	///< Copy of the manifold for differentiating with respect to the parameters (NULL if there are none)
+
+	GeodesicLinearization(const GeodesicLinearization&);
+	GeodesicLinearization& operator=(const GeodesicLinearization&);
+public:
+	double gamma[4];			///< Gamma^i(u,u)
+	double gammaU[4][4];		///< Gamma^i_jk u^k - [i][j]
+	double dGamma[4][4];		///< d Gamma^i(u,u) / dx^k - [k][i]
+	std::vector<double> dGammaParam;	///< d Gamma^i(u,u) / dp_k - [4*k + i]
+
+	//! Constructor
+	/*! \param m The manifold - it must support clone() if it has parameters
+	 */
+	GeodesicLinearization(Manifold* m);
+	//! Destructor
+	~GeodesicLinearization();
+
+	//! Returns the number of the parameters of the manifold
+	int getNParameters();
+	//! Calculates the Jacobian
+	/*! \param m The manifold (its current parameters are used)
+	 *  \param p The position
+	 *  \param u The 4-velocity
+	 */
+	void compute(Manifold* m, Point p, vector4 u);
+};
+
+//! Jacobian of the conversion of a state (position and 4-velocity, coordinates first) to another coordinate system
+/*! \param m The manifold
+ *  \param p The position
+ *  \param u The 4-velocity
+ *  \param system The target coordinate system
+ *  \param J The Jacobian - J[i][j] = dy'^i/dy^j
+ */
+void stateConversionJacobian(Manifold* m, Point p, vector4 u, int system, double J[8][8]);
+
+/*! \class VariationalParticle
+ * \brief Particle integrating the variational equations of the geodesic in the same integrator steps
+ *
+ * Besides the position and the 4-velocity, the state contains the state transition matrix (the derivatives of the current
+ * state with respect to the initial one) and the sensitivities of the current state to the parameters of the manifold
+ * (Manifold::getParameter). Both satisfy linear equations with the Jacobian of the geodesic equation (GeodesicLinearization).
+ * An evaluation of the equation costs up to 9 + 2*getNParameters() evaluations of the Christoffel symbols instead of 1, but
+ * a single integration replaces the 2*(8 + getNParameters()) integrations of finite differences of whole trajectories.
+ *
+ * The states are indexed with the coordinates first: 0-3 - x^i, 4-7 - u^(i-4). The rows of the matrices are expressed in
+ * the current coordinate system (they are transformed at the changes of the coordinate system), the columns of the
+ * transition matrix - in the coordinate system of the initial state. The variational components do not take part in the error
+ * control of adaptive integrators (errorNorm), so the steps are the same as those of a Particle.
+ */
+class VariationalParticle : public Particle
+{
+	GeodesicLinearization jacobian;
+	int nParams;
+	double phi[8][8];
+	std::vector<double> sens;	///< Sensitivities to the parameters - 8 rows of nParams
+
+	VariationalParticle(const VariationalParticle&);
+	VariationalParticle& operator=(const VariationalParticle&);
+protected:
+	//! Constructs a state vector from the internal state.
+	StateVector constructState();
+	//! Sets the internal state to a state represented by a StateVector.
+	void setState(StateVector);
+public:
+	//! Constructor
+	/*! \param _m The manifold on which the particle is defined - it must support clone() if it has parameters
+	 *  \param _p The initial position
+	 *  \param _u The initial 4-velocity
+	 */
+	VariationalParticle(Manifold* _m, Point _p, vector4 _u);
+	//! Destructor
+	~VariationalParticle();
+
+	//! Overloaded method from \a DiffEq
+	/*! \param v Current state
+	 *  \return The derivative of the current state as given by the geodesic equation and its variational equations.
+	 */
+	StateVector derivative(StateVector v);
+	//! Overloaded method from \a DiffEq - the error of the position and 4-velocity only
+	double errorNorm(StateVector error);
+	//! Overloaded method changing the coordinate system in use - transforms the rows of the matrices too
+	void setCoordSystem(int);
+
+	//! Makes the current state the initial one - the transition matrix is set to identity and the sensitivities to 0
+	void resetVariations();
+	//! Returns the number of the parameters of the manifold
+	int getNParameters();
+	//! Returns an element of the state transition matrix
+	/*! \param i Index of the current state
+	 *  \param j Index of the initial state
+	 *  \return dy^i/dy0^j
+	 */
+	double getTransition(int i, int j);
+	//! Returns a sensitivity to a parameter of the manifold
+	/*! \param i Index of the current state
+	 *  \param k Number of the parameter
+	 *  \return dy^i/dp_k
+	 */
+	double getSensitivity(int i, int k);
+
+	//! Changes the position and 4-velocity and resets the variations
+	void setPosVel(Point _p, vector4 _u);
+	//! Changes the 4-velocity and resets the variations
+	void setVel(vector4 _u);
+
+	//! Serializes the state of the particle (the state of Particle, the transition matrix and the sensitivities)
+	void saveState(StateWriter&);
+	//! Restores the state of the particle
+	void loadState(StateReader&);
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "../engine/adjoint.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*! \class PositionLoss
+ * \brief Squared distance of the final position from an observed one, in the EF coordinates
+ */
+class PositionLoss
+{
+	Manifold* m;
+	double observed[4];
+public:
+	PositionLoss(Manifold* _m, Point obs) : m(_m)
+	{
+		obs = m->convertPointTo(obs, EF);
+		int i;
+		for(i = 0; i < 4; i++)
+			observed[i] = obs[i];
+	}
+
+	//the loss and its gradient with respect to the state (coordinates first, in the coordinate system of p)
+	double evaluate(Point p, vector4 u, double* gradient)
+	{
+		double J[8][8], g[8];
+		int i, j;
+		if(p.getCoordSystem() != EF) stateConversionJacobian(m, p, u, EF, J);
+		Point q = m->convertPointTo(p, EF);
+		double loss = 0.0;
+		for(i = 0; i < 8; i++)
+			g[i] = 0.0;
+		for(i = 1; i < 4; i++)
+		{
+			loss += (q[i] - observed[i])*(q[i] - observed[i]);
+			g[i] = 2*(q[i] - observed[i]);
+		}
+		for(j = 0; j < 8; j++)
+		{
+			gradient[j] = 0.0;
+			for(i = 0; i < 8; i++)
+				gradient[j] += g[i]*((p.getCoordSystem() == EF) ? (i == j) : J[i][j]);
+		}
+		return loss;
+	}
+};
+
+static double lossOfRun(Manifold* m, Point p0, vector4 u0, double T, double maxErr, PositionLoss& loss)
+{
+	DPIntegrator dp(maxErr, 0.01, 1e-6, 10.0);
+	Particle particle(m, p0, u0);
+	particle.setIntegrator(&dp);
+	while(particle.getProperTime() < T)
+	{
+		if(particle.getProperTime() + dp.getStepSize() > T) particle.propagate(T - particle.getProperTime());
+		else particle.propagate();
+	}
+	double g[8];
+	return loss.evaluate(particle.getPos(), particle.getVel(), g);
+}
+
+int main(int argc, char** argv)
+{
+	double a = 0.5;
+	double r = 20.0;
+	double orbits = 1.0;
+	double maxErr = 1e-10;
+	int i, j;
+
+	cout << "The program computes the gradient of the squared distance of the final position of a polar orbit around a Kerr" << endl;
+	cout << "black hole from the one observed for a slightly different spin, with respect to the initial state and to M and a -" << endl;
+	cout << "by the adjoint method, by the forward variational equations and by central differences of whole runs." << endl;
+	cout << "Usage: adjoint [a [r [orbits [maxErr]]]]" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "r - the initial (largest) radius of the orbit" << endl;
+	cout << "orbits - the approximate number of orbits" << endl;
+	cout << "maxErr - the error tolerance of a step" << endl;
+	cout << "Defaults: a = 0.5, r = 20, orbits = 1, maxErr = 1e-10" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) r = atof(argv[2]);
+	if(argc >= 4) orbits = atof(argv[3]);
+	if(argc >= 5) maxErr = atof(argv[4]);
+
+	KerrManifold kerr(1.0, a);
+	Point p0(EF, 0.0, r, M_PI/2, 0.0);
+	double Omega = 0.9/sqrt(r*r*r);
+	vector4 dir(1.0, 0.0, -Omega, 0.0);
+	vector4 u0 = dir/sqrt(kerr.getMetric(EF)->g(dir, dir, p0));
+	double T = orbits*2*M_PI/Omega;
+
+	//the observation - the same orbit around a black hole with a different spin
+	KerrManifold observed(1.0, a + 0.05);
+	DPIntegrator dpObs(maxErr, 0.01, 1e-6, 10.0);
+	AdjointSolver obs(&observed, &dpObs);
+	obs.forward(p0, u0, T);
+	PositionLoss loss(&kerr, obs.getFinalPos());
+
+	//adjoint
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	DPIntegrator dp(maxErr, 0.01, 1e-6, 10.0);
+	AdjointSolver adjoint(&kerr, &dp);
+	adjoint.forward(p0, u0, T);
+	double dLoss[8];
+	double L = loss.evaluate(adjoint.getFinalPos(), adjoint.getFinalVel(), dLoss);
+	adjoint.backward(dLoss);
+	double tAdjoint = elapsed(start);
+
+	//forward sensitivities
+	start = std::chrono::steady_clock::now();
+	DPIntegrator dpVar(maxErr, 0.01, 1e-6, 10.0);
+	VariationalParticle var(&kerr, p0, u0);
+	var.setIntegrator(&dpVar);
+	while(var.getProperTime() < T)
+	{
+		if(var.getProperTime() + dpVar.getStepSize() > T) var.propagate(T - var.getProperTime());
+		else var.propagate();
+	}
+	double gVar[8];
+	loss.evaluate(var.getPos(), var.getVel(), gVar);
+	double forward[10];
+	for(j = 0; j < 10; j++)
+	{
+		forward[j] = 0.0;
+		for(i = 0; i < 8; i++)
+			forward[j] += gVar[i]*((j < 8) ? var.getTransition(i, j) : var.getSensitivity(i, j - 8));
+	}
+	double tForward = elapsed(start);
+
+	//central differences of whole runs
+	start = std::chrono::steady_clock::now();
+	double fd[10];
+	for(j = 0; j < 10; j++)
+	{
+		double d, L1, L2;
+		if(j < 8)
+		{
+			Point p1 = p0, p2 = p0;
+			vector4 u1 = u0, u2 = u0;
+			if(j < 4)
+			{
+				d = 1e-6*(1.0 + fabs(p0[j]));
+				p1[j] += d;
+				p2[j] -= d;
+			}
+			else
+			{
+				d = 1e-6*(1.0 + fabs(u0[j - 4]));
+				u1[j - 4] += d;
+				u2[j - 4] -= d;
+			}
+			L1 = lossOfRun(&kerr, p1, u1, T, maxErr, loss);
+			L2 = lossOfRun(&kerr, p2, u2, T, maxErr, loss);
+		}
+		else
+		{
+			double value = kerr.getParameter(j - 8);
+			d = 1e-6*(1.0 + fabs(value));
+			KerrManifold m1(1.0, a), m2(1.0, a);
+			m1.setParameter(j - 8, value + d);
+			m2.setParameter(j - 8, value - d);
+			L1 = lossOfRun(&m1, p0, u0, T, maxErr, loss);
+			L2 = lossOfRun(&m2, p0, u0, T, maxErr, loss);
+		}
+		fd[j] = (L1 - L2)/(2*d);
+	}
+	double tFd = elapsed(start);
+
+	const char* names[10] = { "x0", "x1", "x2", "x3", "u0", "u1", "u2", "u3", "M", "a" };
+	cout << "Loss " << L << " after " << adjoint.getNSteps() << " steps, " << adjoint.getNCheckpoints() << " checkpoints" << endl;
+	cout << "Gradient: adjoint, forward sensitivities, central differences" << endl;
+	for(j = 0; j < 10; j++)
+		cout << "  d/d" << names[j] << ": " << ((j < 8) ? adjoint.getGradient(j) : adjoint.getParameterGradient(j - 8))
+			<< ", " << forward[j] << ", " << fd[j] << endl;
+	cout << "Time: adjoint " << tAdjoint << " s, forward sensitivities " << tForward << " s, central differences " << tFd << " s" << endl;
+	return 0;
+}
@@ -0,0 +1,416 @@
+#include "../engine/particle.h"
+#include "../engine/rk4integrator.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/schw.h"
+#include "../engine/kerr.h"
+#include "../engine/stepprofile.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+/*
+ * Benchmarks
+ */
+
+class Benchmark
+{
+public:
+	string name;
+	string unit;
+	bool higherIsBetter;
+
+	Benchmark(string _name, string _unit, bool _higherIsBetter)
+		: name(_name), unit(_unit), higherIsBetter(_higherIsBetter) {}
+	virtual ~Benchmark() {}
+
+	//performs n operations
+	virtual void run(long n) = 0;
+	//checks the result of the last run (for benchmarks of whole computations)
+	virtual bool verify() { return true; }
+};
+
+volatile double sink;	//keeps the compiler from optimizing the work away
+
+//derivative evaluations in one chart - the points vary, so that the metric caches don't hide the cost
+class DerivativeBench : public Benchmark
+{
+	Manifold* m;
+	Particle* particle;
+	vector<StateVector> states;
+public:
+	DerivativeBench(string name, Manifold* _m, int chart)
+		: Benchmark(name, "evals/s", true)
+	{
+		m = _m;
+		int i, j;
+		for(i = 0; i < 256; i++)
+		{
+			double r = 8.0 + 0.01*i;
+			Point p = m->convertPointTo(Point(EF, 0.0, r, (chart == EF) ? M_PI/2 : 0.2, 0.1*i), chart);
+			vector4 u = m->convertVectorTo(vector4(1.2, -0.1, 0.01, 0.03), Point(EF, 0.0, r, (chart == EF) ? M_PI/2 : 0.2, 0.1*i), chart);
+			if(i == 0) particle = new Particle(m, p, u);
+			StateVector v;
+			for(j = 0; j < 4; j++)
+			{
+				v.push_back(p[j]);
+				v.push_back(u[j]);
+			}
+			states.push_back(v);
+		}
+	}
+	~DerivativeBench()
+	{
+		delete particle;
+	}
+
+	void run(long n)
+	{
+		long i;
+		double s = 0.0;
+		for(i = 0; i < n; i++)
+			s += particle->derivative(states[i % states.size()])[1];
+		sink = s;
+	}
+};
+
+//integration steps along a circular orbit at r = 10M in Schwarzschild
+class IntegratorBench : public Benchmark
+{
+	SchwManifold* m;
+	Particle* particle;
+public:
+	IntegratorBench(string name, SchwManifold* _m, Integrator* integrator)
+		: Benchmark(name, "steps/s", true)
+	{
+		m = _m;
+		double r = 10.0;
+		double w = sqrt(1.0/(r*r*r));
+		double ut = 1.0/sqrt(1.0 - 3.0/r);
+		particle = new Particle(m, Point(EF, 0.0, r, M_PI/2, 0.0), vector4(ut, 0.0, 0.0, w*ut));
+		particle->setIntegrator(integrator);
+	}
+	~IntegratorBench()
+	{
+		delete particle;
+	}
+
+	void run(long n)
+	{
+		long i;
+		for(i = 0; i < n; i++)
+			particle->propagate();
+		sink = particle->getPos()[1];
+	}
+};
+
+//round trips EF -> NearPole0 -> EF of a point and a vector
+class ConversionBench : public Benchmark
+{
+	Manifold* m;
+public:
+	ConversionBench(string name, Manifold* _m)
+		: Benchmark(name, "roundtrips/s", true)
+	{
+		m = _m;
+	}
+
+	void run(long n)
+	{
+		long i;
+		double s = 0.0;
+		for(i = 0; i < n; i++)
+		{
+			Point p(EF, 0.0, 10.0, 0.2 + 1e-6*(i % 1000), 0.5);
+			vector4 u(1.2, -0.1, 0.01, 0.03);
+			Point q = m->convertPointTo(p, NearPole0);
+			vector4 v = m->convertVectorTo(u, p, NearPole0);
+			s += m->convertVectorTo(v, q, EF)[2] + m->convertPointTo(q, EF)[2];
+		}
+		sink = s;
+	}
+};
+
+//the Shapiro delay computation of tests/shapiro.cpp with the default data
+class ShapiroBench : public Benchmark
+{
+	SchwManifold schw;
+	double delay;
+public:
+	ShapiroBench()
+		: Benchmark("shapiro_solve", "s", false), schw(4.9e-6), delay(0.0) {}
+
+	static double u(double t, double r, double M)
+	{
+		return t + r + 2*M*log(0.5*(r-2*M)/M);
+	}
+
+	static double t(double u, double r, double M)
+	{
+		return u - r - 2*M*log(0.5*(r-2*M)/M);
+	}
+
+	//time of flight of a photon from the perihelion to the radius rMax
+	static double flight(Particle& photon, double rMax, double M)
+	{
+		vector4 lastPos, pos;
+		while(photon.getPos()[1] < rMax)
+		{
+			lastPos = photon.getPos().toVector4();
+			photon.propagate();
+		}
+		pos = photon.getPos().toVector4();
+		lastPos += (pos - lastPos)/(pos[1] - lastPos[1])*(rMax - lastPos[1]);
+		return t(lastPos[0], lastPos[1], M);
+	}
+
+	void run(long n)
+	{
+		double M = 4.9e-6, d = 2.33, yE = 498.67, yV = 370.7;
+		double u0 = sqrt(d*d*d/(d-2*M));
+		double rE = sqrt(d*d + yE*yE);
+		double rV = sqrt(d*d + yV*yV);
+		long i;
+
+		for(i = 0; i < n; i++)
+		{
+			//the second photon goes back in time from the perihelion, as in tests/shapiro.cpp
+			Particle photon1(&schw, Point(EF, u(0.0, d, M), d, M_PI/2, 0.0), vector4(u0, 0.0, 0.0, 1.0));
+			Particle photon2(&schw, Point(EF, u(0.0, d, M), d, M_PI/2, 0.0), vector4(-u0, 0.0, 0.0, -1.0));
+			DPIntegrator dp(1e-12);
+			photon1.setIntegrator(&dp);
+			photon2.setIntegrator(&dp);
+			StepProfile profile(d/2, 2*rE);
+			photon1.setStepRecorder(&profile);
+			photon2.setStepPredictor(&profile);
+			double t1 = flight(photon1, rE, M);
+			double t2 = flight(photon2, rV, M);
+			delay = 2*(t1 - t2)*sqrt(1.0 - 2*M/rE) - 2*(yE + yV);
+			sink = delay;
+		}
+	}
+
+	//the delay printed by tests/shapiro.cpp
+	bool verify()
+	{
+		return fabs(delay/2.3411725e-4 - 1.0) < 1e-4;
+	}
+};
+
+/*
+ * Measurement
+ */
+
+double timeRun(Benchmark* b, long n)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	b->run(n);
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//best of several repetitions, each taking at least minTime - rate for throughput benchmarks, time per operation otherwise
+double measure(Benchmark* b, double minTime, int repetitions)
+{
+	long n = 1;
+	double t;
+	while((t = timeRun(b, n)) < minTime)
+		n = (t < minTime/64) ? 8*n : 2*n;
+
+	double best = n/t;
+	int i;
+	for(i = 1; i < repetitions; i++)
+	{
+		double rate = n/timeRun(b, n);
+		if(rate > best) best = rate;
+	}
+	return b->higherIsBetter ? best : 1.0/best;
+}
+
+struct Result
+{
+	string name;
+	string unit;
+	bool higherIsBetter;
+	double value;
+};
+
+bool writeJSON(const char* filename, vector<Result>& results)
+{
+	ofstream out(filename);
+	if(!out) return false;
+	out.precision(10);
+	out << "{" << endl << "  \"benchmarks\": [" << endl;
+	unsigned i;
+	for(i = 0; i < results.size(); i++)
+	{
+		out << "    {\"name\": \"" << results[i].name << "\", \"value\": " << results[i].value << ", \"unit\": \"" << results[i].unit
+			<< "\", \"higher_is_better\": " << (results[i].higherIsBetter ? "true" : "false") << "}";
+		if(i + 1 < results.size()) out << ",";
+		out << endl;
+	}
+	out << "  ]" << endl << "}" << endl;
+	return (bool)out;
+}
+
+//reads the name/value pairs from a file written by writeJSON
+bool readJSON(const char* filename, vector<Result>& results)
+{
+	ifstream in(filename);
+	if(!in) return false;
+	stringstream ss;
+	ss << in.rdbuf();
+	string s = ss.str();
+
+	size_t pos = 0;
+	while((pos = s.find("\"name\"", pos)) != string::npos)
+	{
+		size_t b = s.find('"', s.find(':', pos) + 1);
+		size_t e = s.find('"', b + 1);
+		size_t v = s.find("\"value\"", e);
+		if(b == string::npos || e == string::npos || v == string::npos) return false;
+
+		Result r;
+		r.name = s.substr(b + 1, e - b - 1);
+		r.value = strtod(s.c_str() + s.find(':', v) + 1, NULL);
+		r.higherIsBetter = true;
+		results.push_back(r);
+		pos = v;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	double minTime = 0.3;
+	int repetitions = 3;
+	double threshold = 0.1;
+	const char* outFile = "bench.json";
+	const char* baselineFile = NULL;
+	const char* saveFile = NULL;
+	int i;
+
+	cout << "The program measures the performance of the engine and compares it with a baseline." << endl;
+	cout << "Usage: bench [--quick] [--out file] [--baseline file] [--threshold t] [--save file]" << endl;
+	cout << "--quick - shorter measurements (less accurate)" << endl;
+	cout << "--out - the file the results are written to in JSON (default bench.json)" << endl;
+	cout << "--baseline - compare with the results stored in the file, exit with 1 on a regression" << endl;
+	cout << "--threshold - relative slowdown reported as a regression (default 0.1)" << endl;
+	cout << "--save - store the results as a new baseline" << endl << endl;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--quick"))
+		{
+			minTime = 0.05;
+			repetitions = 2;
+		}
+		else if(!strcmp(argv[i], "--out") && i + 1 < argc) outFile = argv[++i];
+		else if(!strcmp(argv[i], "--baseline") && i + 1 < argc) baselineFile = argv[++i];
+		else if(!strcmp(argv[i], "--threshold") && i + 1 < argc) threshold = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--save") && i + 1 < argc) saveFile = argv[++i];
+		else
+		{
+			cout << "Unknown option: " << argv[i] << endl;
+			return 2;
+		}
+	}
+
+	SchwManifold schw(1.0);
+	KerrManifold kerr(1.0, 0.9);
+	SchwManifold schwRK(1.0), schwDP(1.0);
+	RK4Integrator rk4(0.1);
+	DPIntegrator dp(1e-10);
+
+	vector<Benchmark*> benchmarks;
+	benchmarks.push_back(new DerivativeBench("derivative_schw_ef", &schw, EF));
+	benchmarks.push_back(new DerivativeBench("derivative_schw_nearpole", &schw, NearPole0));
+	benchmarks.push_back(new DerivativeBench("derivative_kerr_ef", &kerr, EF));
+	benchmarks.push_back(new DerivativeBench("derivative_kerr_nearpole", &kerr, NearPole0));
+	benchmarks.push_back(new IntegratorBench("steps_rk4", &schwRK, &rk4));
+	benchmarks.push_back(new IntegratorBench("steps_dp", &schwDP, &dp));
+	benchmarks.push_back(new ConversionBench("conversion_schw", &schw));
+	benchmarks.push_back(new ConversionBench("conversion_kerr", &kerr));
+	benchmarks.push_back(new ShapiroBench());
+
+	vector<Result> results;
+	unsigned j;
+	int wrong = 0;
+	for(j = 0; j < benchmarks.size(); j++)
+	{
+		Result r;
+		r.name = benchmarks[j]->name;
+		r.unit = benchmarks[j]->unit;
+		r.higherIsBetter = benchmarks[j]->higherIsBetter;
+		r.value = measure(benchmarks[j], minTime, repetitions);
+		results.push_back(r);
+		cout << r.name << ": " << r.value << " " << r.unit << endl;
+		if(!benchmarks[j]->verify())
+		{
+			cout << r.name << ": the result differs from the reference" << endl;
+			wrong++;
+		}
+		delete benchmarks[j];
+	}
+	if(wrong)
+	{
+		cout << wrong << " benchmark(s) computed wrong results" << endl;
+		return 1;
+	}
+
+	if(!writeJSON(outFile, results))
+		cout << "Could not write " << outFile << endl;
+	if(saveFile)
+	{
+		if(writeJSON(saveFile, results))
+			cout << "Baseline saved to " << saveFile << endl;
+		else
+			cout << "Could not write " << saveFile << endl;
+	}
+
+	if(!baselineFile) return 0;
+
+	vector<Result> baseline;
+	if(!readJSON(baselineFile, baseline))
+	{
+		cout << "Could not read the baseline " << baselineFile << endl;
+		return 2;
+	}
+
+	cout << endl << "Comparison with " << baselineFile << " (threshold " << 100*threshold << "%):" << endl;
+	int regressions = 0;
+	for(j = 0; j < results.size(); j++)
+	{
+		unsigned k;
+		for(k = 0; k < baseline.size(); k++)
+			if(baseline[k].name == results[j].name) break;
+		if(k == baseline.size())
+		{
+			cout << results[j].name << ": not in the baseline" << endl;
+			continue;
+		}
+
+		//positive change - faster than the baseline
+		double change = results[j].higherIsBetter ? results[j].value/baseline[k].value - 1.0 : baseline[k].value/results[j].value - 1.0;
+		cout << results[j].name << ": " << (change >= 0.0 ? "+" : "") << 100*change << "%";
+		if(change < -threshold)
+		{
+			cout << " REGRESSION";
+			regressions++;
+		}
+		cout << endl;
+	}
+
+	if(regressions)
+	{
+		cout << regressions << " regression(s)" << endl;
+		return 1;
+	}
+	cout << "No regressions" << endl;
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include "../engine/continuation.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+/*! \class CountingParticle
+ * \brief Particle counting the evaluations of the geodesic equation
+ */
+class CountingParticle : public Particle
+{
+public:
+	long evaluations;
+	CountingParticle(Manifold* m, Point p, vector4 u) : Particle(m, p, u), evaluations(0) {}
+	StateVector derivative(StateVector v)
+	{
+		evaluations++;
+		return Particle::derivative(v);
+	}
+};
+
+//propagates the particle up to the proper time T, the last step is shortened to end exactly there
+void propagateTo(Particle& p, DPIntegrator& dp, double T, ReferenceTrajectory* ref)
+{
+	if(ref) ref->add(&p);
+	while(p.getProperTime() < T)
+	{
+		if(p.getProperTime() + dp.getStepSize() > T) p.propagate(T - p.getProperTime());
+		else p.propagate();
+		if(ref) ref->add(&p);
+	}
+}
+
+//distance between the states in the Eddington-Finkelstein coordinates
+double distance(KerrManifold& m, Point p, vector4 u, Point q, vector4 v)
+{
+	u = m.convertVectorTo(u, p, EF);
+	p = m.convertPointTo(p, EF);
+	v = m.convertVectorTo(v, q, EF);
+	q = m.convertPointTo(q, EF);
+	double d = 0.0;
+	int i;
+	for(i = 0; i < 4; i++)
+		d += (p[i] - q[i])*(p[i] - q[i]) + (u[i] - v[i])*(u[i] - v[i]);
+	return sqrt(d);
+}
+
+int main(int argc, char** argv)
+{
+	double a = 0.5;
+	double r = 20.0;
+	double orbits = 3.0;
+	double maxErr = 1e-10;
+
+	cout << "The program solves an eccentric polar orbit around a Kerr black hole once, and then re-solves it for slightly" << endl;
+	cout << "different angular momenta of the black hole - from scratch and by continuation from the first solution." << endl;
+	cout << "Usage: continuation [a [r [orbits [maxErr]]]]" << endl;
+	cout << "a - angular momentum per unit mass of the reference black hole" << endl;
+	cout << "r - the initial (largest) radius of the orbit" << endl;
+	cout << "orbits - the approximate number of orbits" << endl;
+	cout << "maxErr - the error tolerance of a step" << endl;
+	cout << "Defaults: a = 0.5, r = 20, orbits = 3, maxErr = 1e-10" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) r = atof(argv[2]);
+	if(argc >= 4) orbits = atof(argv[3]);
+	if(argc >= 5) maxErr = atof(argv[4]);
+
+	KerrManifold kerr(1.0, a);
+	Point p0(EF, 0.0, r, M_PI/2, 0.0);
+	//moving over the poles slightly slower than on a circular orbit
+	double Omega = 0.9/sqrt(r*r*r);
+	vector4 dir(1.0, 0.0, -Omega, 0.0);
+	vector4 u0 = dir/sqrt(kerr.getMetric(EF)->g(dir, dir, p0));
+	double T = orbits*2*M_PI/Omega;
+
+	ReferenceTrajectory ref;
+	DPIntegrator dp(maxErr, 0.01, 1e-6, 10.0);
+	CountingParticle reference(&kerr, p0, u0);
+	reference.setIntegrator(&dp);
+	propagateTo(reference, dp, T, &ref);
+	int switches = 0, i;
+	for(i = 0; i < ref.getNNodes(); i++)
+		if(ref.getNode(i).switched) switches++;
+	cout << "Reference: " << ref.getNNodes() - 1 << " steps, " << reference.evaluations << " evaluations, "
+		<< switches << " changes of the coordinate system" << endl << endl;
+
+	ContinuationSolver solver(maxErr);
+	double deltas[] = { 1e-6, 1e-4, 1e-3, 1e-2, 1e-1 };
+	for(i = 0; i < 5; i++)
+	{
+		KerrManifold changed(1.0, a + deltas[i]);
+
+		DPIntegrator cold(maxErr, 0.01, 1e-6, 10.0);
+		CountingParticle particle(&changed, p0, u0);
+		particle.setIntegrator(&cold);
+		propagateTo(particle, cold, T, NULL);
+
+		solver.solve(ref, &changed, p0, u0);
+		int last = solver.getNNodes() - 1;
+		const ReferenceNode& end = ref.getNode(last);
+		Point refPos(end.chart, end.x[0], end.x[2], end.x[4], end.x[6]);
+		vector4 refVel(end.x[1], end.x[3], end.x[5], end.x[7]);
+
+		cout << "da = " << deltas[i] << ": from scratch " << particle.evaluations << " evaluations, by continuation "
+			<< solver.getEvaluations() << " evaluations in " << solver.getSteps() << " steps ("
+			<< (double)particle.evaluations/solver.getEvaluations() << "x fewer)";
+		if(solver.getFallbackNode() >= 0) cout << ", integrated normally from step " << solver.getFallbackNode();
+		cout << endl;
+		cout << "  change of the final state " << distance(changed, refPos, refVel, particle.getPos(), particle.getVel())
+			<< ", difference from the solution from scratch "
+			<< distance(changed, solver.getPos(last), solver.getVel(last), particle.getPos(), particle.getVel()) << endl;
+	}
+	return 0;
+}
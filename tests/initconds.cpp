@@ -0,0 +1,113 @@
+#include "../engine/initconds.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	int n = 1000000;
+	int threads = 0;
+	int bad = 10;
+	double a = 0.9;
+	int i;
+
+	cout << "The program writes an ensemble of particles on orbits around a Kerr black hole to initconds.dat (columnar binary)" << endl;
+	cout << "and initconds.txt (text), compares the time of constructing the particles from both and checks g(u,u) = 1" << endl;
+	cout << "in parallel on the memory-mapped columns." << endl;
+	cout << "Usage: initconds [n [threads [bad [a]]]]" << endl;
+	cout << "n - the number of particles" << endl;
+	cout << "threads - the number of threads checking the normalization (0 - all hardware threads)" << endl;
+	cout << "bad - the number of particles with a wrong normalization" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "Defaults: n = 1000000, threads = 0, bad = 10, a = 0.9" << endl << endl;
+
+	if(argc >= 2) n = atoi(argv[1]);
+	if(argc >= 3) threads = atoi(argv[2]);
+	if(argc >= 4) bad = atoi(argv[3]);
+	if(argc >= 5) a = atof(argv[4]);
+	if(n < 1) n = 1;
+
+	KerrManifold kerr(1.0, a);
+	Metric* g = kerr.getMetric(EF);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	InitialConditionsWriter writer("initconds.dat");
+	ofstream text("initconds.txt");
+	text.precision(17);
+	for(i = 0; i < n; i++)
+	{
+		double r = 6.0 + 20.0*(i % 1000)/1000;
+		double theta = M_PI/2 + 0.5*sin(0.1*i);
+		double phi = 2*M_PI*((i*0.618034) - floor(i*0.618034));
+		Point p(EF, 0.0, r, theta, phi);
+		double Omega = 1.0/(a + sqrt(r*r*r));
+		double ut = 1.0/sqrt(g->g(0, 0, p) + 2*g->g(0, 3, p)*Omega + g->g(3, 3, p)*Omega*Omega);
+		//every (n/bad)-th particle is not normalized
+		if(bad > 0 && i % (n/bad > 0 ? n/bad : 1) == 0 && i/(n/bad > 0 ? n/bad : 1) < bad) ut *= 1.001;
+		vector4 u(ut, 0.0, 0.0, Omega*ut);
+
+		writer.add(p, u);
+		text << p.getCoordSystem() << " " << p[0] << " " << p[1] << " " << p[2] << " " << p[3] << " "
+			<< u[0] << " " << u[1] << " " << u[2] << " " << u[3] << "\n";
+	}
+	text.close();
+	if(!writer.close())
+	{
+		cout << "Could not write initconds.dat" << endl;
+		return 1;
+	}
+	cout << "Written " << n << " particles in " << elapsed(start) << " s" << endl;
+
+	//the text input
+	start = std::chrono::steady_clock::now();
+	std::vector<Particle> fromText;
+	ifstream in("initconds.txt");
+	int cs;
+	double x[4], v[4];
+	while(in >> cs >> x[0] >> x[1] >> x[2] >> x[3] >> v[0] >> v[1] >> v[2] >> v[3])
+		fromText.push_back(Particle(&kerr, Point(cs, x), vector4(v[0], v[1], v[2], v[3])));
+	double textTime = elapsed(start);
+	cout << "Text: " << fromText.size() << " particles constructed in " << textTime << " s" << endl;
+
+	//the columnar input
+	start = std::chrono::steady_clock::now();
+	InitialConditionsReader reader;
+	if(!reader.open("initconds.dat"))
+	{
+		cout << "Could not read initconds.dat" << endl;
+		return 1;
+	}
+	std::vector<Particle> particles;
+	reader.createParticles(&kerr, particles);
+	double binaryTime = elapsed(start);
+	cout << "Columnar: " << particles.size() << " particles constructed in " << binaryTime << " s (" << textTime/binaryTime << "x faster)" << endl;
+
+	unsigned j;
+	int differences = 0;
+	for(j = 0; j < particles.size() && j < fromText.size(); j++)
+	{
+		Point p = particles[j].getPos(), q = fromText[j].getPos();
+		if(p != q) differences++;
+	}
+	cout << "Positions differing from the text input: " << differences << endl;
+
+	start = std::chrono::steady_clock::now();
+	std::vector<uint64_t> invalid;
+	double deviation;
+	uint64_t count = reader.validate(&kerr, 1.0, 1e-10, threads, &invalid, &deviation);
+	cout << "Normalization checked in " << elapsed(start) << " s: " << count << " invalid particles, largest |g(u,u) - 1| = " << deviation << endl;
+	for(j = 0; j < invalid.size() && j < 5; j++)
+		cout << "  particle " << invalid[j] << ": g(u,u) = "
+			<< g->g(reader.getVel(invalid[j]), reader.getVel(invalid[j]), reader.getPos(invalid[j])) << endl;
+	return 0;
+}
@@ -0,0 +1,107 @@
+#include "../engine/jacobi.h"
+#include "../engine/rk4integrator.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//propagates a particle with fixed steps up to an affine parameter and returns its final position in EF coordinates
+static Point finalPos(Particle& particle, double T, double h)
+{
+	RK4Integrator rk4(h);
+	particle.setIntegrator(&rk4);
+	while(particle.getProperTime() < T - h/2)
+		particle.propagate();
+	return particle.getManifold()->convertPointTo(particle.getPos(), EF);
+}
+
+int main(int argc, char** argv)
+{
+	double a = 0.9;
+	double r = 50.0;
+	double b = 8.0;
+	double h = 0.1;
+	double delta = 1e-6;
+	int A, B, i, j;
+
+	cout << "The program traces a light ray from an observer past a Kerr black hole together with the Jacobi matrix of the bundle" << endl;
+	cout << "of rays around it, and compares the matrix with central differences of neighbouring rays." << endl;
+	cout << "Usage: jacobi [a [r [b [h]]]]" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "r - radius of the observer" << endl;
+	cout << "b - impact parameter of the ray" << endl;
+	cout << "h - the step of the RK4 integrator" << endl;
+	cout << "Defaults: a = 0.9, r = 50, b = 8, h = 0.1" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) r = atof(argv[2]);
+	if(argc >= 4) b = atof(argv[3]);
+	if(argc >= 5) h = atof(argv[4]);
+
+	//a static observer slightly above the equatorial plane, the ray aimed past the hole
+	KerrManifold kerr(1.0, a);
+	Metric* g = kerr.getMetric(EF);
+	Point p0(EF, 0.0, r, M_PI/2 - 0.1, 0.0);
+	vector4 e[4];
+	for(i = 0; i < 4; i++)
+	{
+		e[i] = vector4(0.0, 0.0, 0.0, 0.0);
+		e[i][i] = 1.0;
+		for(j = 0; j < i; j++)
+			e[i] -= g->g(e[i], e[j], p0) * e[j] / g->g(e[j], e[j], p0);
+		e[i] /= sqrt(fabs(g->g(e[i], e[i], p0)));
+	}
+	double alpha = asin(b/r);
+	vector4 k0 = e[0] - cos(alpha)*e[1] + sin(alpha)*e[3];
+	double T = 2*r;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	JacobiParticle ray(&kerr, p0, k0, e[0]);
+	vector4 screen0[2] = { ray.getScreenVector(0), ray.getScreenVector(1) };
+	Point p = finalPos(ray, T, h);
+	double tJacobi = elapsed(start);
+	vector4 screen[2];
+	for(A = 0; A < 2; A++)
+		screen[A] = kerr.convertVectorTo(ray.getScreenVector(A), ray.getPos(), EF);
+
+	//the same by central differences - the initial direction tilted along the screen vectors
+	start = std::chrono::steady_clock::now();
+	double fd[2][2];
+	Particle central(&kerr, p0, k0);
+	finalPos(central, T, h);
+	for(B = 0; B < 2; B++)
+	{
+		Particle q1(&kerr, p0, k0 + delta*screen0[B]), q2(&kerr, p0, k0 - delta*screen0[B]);
+		Point x1 = finalPos(q1, T, h), x2 = finalPos(q2, T, h);
+		vector4 dx;
+		for(i = 0; i < 4; i++)
+			dx[i] = (x1[i] - x2[i])/(2*delta);
+		for(A = 0; A < 2; A++)
+			fd[A][B] = -g->g(dx, screen[A], p);
+	}
+	double tFd = elapsed(start);
+
+	cout << "Final radius " << p[1] << ", affine parameter " << T << endl;
+	cout << "Jacobi matrix:" << endl;
+	double diff = 0.0, largest = 0.0;
+	for(A = 0; A < 2; A++)
+	{
+		cout << "  " << ray.getJacobi(A, 0) << " " << ray.getJacobi(A, 1) << "    (central differences " << fd[A][0] << " " << fd[A][1] << ")" << endl;
+		for(B = 0; B < 2; B++)
+		{
+			if(fabs(ray.getJacobi(A, B) - fd[A][B]) > diff) diff = fabs(ray.getJacobi(A, B) - fd[A][B]);
+			if(fabs(fd[A][B]) > largest) largest = fabs(fd[A][B]);
+		}
+	}
+	cout << "Largest difference " << diff << " (" << diff/largest << " relative)" << endl;
+	cout << "Area distance " << ray.getAreaDistance() << ", magnification " << ray.getMagnification() << ", shear " << ray.getShear() << endl;
+	cout << "Jacobi ray " << tJacobi << " s, 5 rays of central differences " << tFd << " s (" << tFd/tJacobi << "x)" << endl;
+	return 0;
+}
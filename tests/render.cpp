@@ -0,0 +1,84 @@
+#include "../engine/renderer.h"
+#include "../engine/kerr.h"
+#include "../engine/counters.h"
+#include "../engine/profiler.h"
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+int main(int argc, char** argv)
+{
+	int width = 160;
+	int height = 120;
+	int threads = 0;
+	double a = 0.0;
+	double r = 30.0;
+	double inclination = 80.0;
+	int step = 1;
+	
+	cout << "The program renders the image of a black hole with a thin accretion disk, as seen by a static observer." << endl;
+	cout << "Usage: render [width height [threads [a [r [inclination [step]]]]]]" << endl;
+	cout << "a - the angular momentum parameter of the black hole (M = 1)" << endl;
+	cout << "r - the distance of the observer" << endl;
+	cout << "inclination - the polar angle of the observer in degrees" << endl;
+	cout << "step - the coarse grid step for adaptive refinement (1 - every pixel is traced)" << endl;
+	cout << "Defaults: 160 x 120, threads = number of cores, a = 0, r = 30, inclination = 80, step = 1" << endl << endl;
+	
+	if(argc >= 3)
+	{
+		width = atoi(argv[1]);
+		height = atoi(argv[2]);
+	}
+	if(argc >= 4) threads = atoi(argv[3]);
+	if(argc >= 5) a = atof(argv[4]);
+	if(argc >= 6) r = atof(argv[5]);
+	if(argc >= 7) inclination = atof(argv[6]);
+	if(argc >= 8) step = atoi(argv[7]);
+	
+#ifdef GR_PROFILE
+	//before the first profiled scope - the profile of every thread (this one included) reads the hardware counters if they are available
+	Profiler::enablePerf(true);
+#endif
+	KerrManifold kerr(1.0, a);
+	double theta = inclination*M_PI/180;
+	
+	//static observer looking at the black hole - local X towards the center, Y along phi, Z "up"
+	double ut = 1.0/sqrt(kerr.getMetric(EF)->g(0, 0, Point(EF, 0.0, r, theta, 0.0)));
+	Entity camera(&kerr, Point(EF, 0.0, r, theta, 0.0), vector4(ut, 0.0, 0.0, 0.0), 
+		vector4(0.0, -1.0, 0.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), vector4(0.0, 0.0, -1.0, 0.0));
+	
+	GeodesicClassifier classifier(&kerr);
+	
+	Renderer renderer(&kerr, &camera, width, height, 0.8);
+	renderer.setThreads(threads);
+	renderer.setHorizon(kerr.getHorizonRadius()*1.01);
+	renderer.setEscapeRadius(2*r);
+	renderer.setDisk(kerr.getISCORadius(), 20.0);
+	renderer.setClassifier(&classifier);
+	renderer.setAdaptive(step);
+	//rays which crawl with the minimal step size for too long are reported with their last steps
+	renderer.setStallDetection(200, &cout);
+	
+	cout << "Rendering..." << endl;
+	renderer.render();
+	renderer.printReport(cout);
+#ifdef GR_COUNTERS
+	cout << endl << "Counters:" << endl;
+	collectCounters().print(cout);
+#endif
+#ifdef GR_PROFILE
+	ProfileReport profile = Profiler::collect();
+	cout << endl << "Profile:" << endl;
+	profile.print(cout);
+	if(profile.writeFolded("render.folded"))
+		cout << "Call stacks written to render.folded" << endl;
+#endif
+	
+	if(renderer.writePPM("render.ppm"))
+		cout << "Image written to render.ppm" << endl;
+	else
+		cout << "Could not write render.ppm" << endl;
+	
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include "../engine/particle.h"
 #include "../engine/dpintegrator.h"
 #include "../engine/schw.h"
+#include "../engine/stepprofile.h"
 #include <iostream>
 #include <math.h>
 #include <stdlib.h>
@@ -65,6 +66,11 @@ int main(int argc, char** argv)
 	photon1.setIntegrator(&dp);
 	photon2.setIntegrator(&dp);
 	
+	//the photons are mirror images of each other - the second one starts with the step size accepted by the first
+	StepProfile profile(d/2, 2*rE);
+	photon1.setStepRecorder(&profile);
+	photon2.setStepPredictor(&profile);
+	
 	double t1, t2;
 	vector4 lastPos, pos;
 	
@@ -81,8 +87,6 @@ int main(int argc, char** argv)
 	lastPos += (pos - lastPos)/(pos[1] - lastPos[1])*(rE - lastPos[1]);
 	t1 = t(lastPos[0], lastPos[1], M);
 	
-	dp.resetStepSize();
-	
 	cout << "Propagation of photon 2..." << endl;
 	
 	while(photon2.getPos()[1] < rV)
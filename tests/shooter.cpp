@@ -0,0 +1,71 @@
+#include "../engine/shooter.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+int main(int argc, char** argv)
+{
+	double a = 0.5;
+	double rSource = 10.0;
+	double rObserver = 100.0;
+	int nCandidates = 32;
+	int nThreads = 0;
+	int i;
+
+	cout << "The program finds the light rays from a source behind a Kerr black hole to a distant observer (the images of the source)," << endl;
+	cout << "and the free fall trajectories connecting two events near the hole." << endl;
+	cout << "Usage: shooter [a [rSource [rObserver [candidates [threads]]]]]" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "rSource - radius of the source" << endl;
+	cout << "rObserver - radius of the observer" << endl;
+	cout << "candidates - number of the initial directions" << endl;
+	cout << "threads - number of threads (0 - one per hardware thread)" << endl;
+	cout << "Defaults: a = 0.5, rSource = 10, rObserver = 100, candidates = 32, threads = 0" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) rSource = atof(argv[2]);
+	if(argc >= 4) rObserver = atof(argv[3]);
+	if(argc >= 5) nCandidates = atoi(argv[4]);
+	if(argc >= 6) nThreads = atoi(argv[5]);
+
+	KerrManifold kerr(1.0, a);
+	HorizonCondition horizon(kerr.getHorizonRadius()*1.01);
+	EscapeCondition escape(1.5*rObserver);
+
+	GeodesicShooter shooter(&kerr);
+	shooter.addStopCondition(&horizon);
+	shooter.addStopCondition(&escape);
+	shooter.setPeriodic(3, 2*M_PI);
+	shooter.setCandidates(nCandidates);
+	shooter.setThreads(nThreads);
+	shooter.setMaxParameter(10*rObserver);
+	shooter.setIntegrator(1e-9, 10.0);
+
+	Point source(EF, 0.0, rSource, M_PI/2 - 0.1, M_PI);
+	Point observer(EF, 0.0, rObserver, M_PI/2, 0.0);
+	int n = shooter.findNull(source, observer);
+	cout << "Images of the source (" << n << " found in " << shooter.getTime() << " s, " << shooter.getThreadsUsed() << " threads):" << endl;
+	for(i = 0; i < n; i++)
+	{
+		ShootingSolution s = shooter.getSolution(i);
+		cout << "  arrival " << s.end[0] << " (delay " << s.end[0] - shooter.getSolution(0).end[0] << "), affine parameter "
+			<< s.parameter << ", final direction (" << s.endVel[2]/s.endVel[0] << ", " << s.endVel[3]/s.endVel[0] << "), "
+			<< s.iterations << " iterations, distance " << s.distance << endl;
+	}
+
+	Point start(EF, 0.0, rSource, M_PI/2, 0.0);
+	Point end(EF, 10*rSource, rSource, M_PI/2 + 0.2, M_PI/2);
+	shooter.setMaxParameter(20*rSource);
+	n = shooter.findTimelike(start, end);
+	cout << "Free fall trajectories from (" << start[0] << ", " << start[1] << ", " << start[2] << ", " << start[3] << ") to ("
+		<< end[0] << ", " << end[1] << ", " << end[2] << ", " << end[3] << ") (" << n << " found in " << shooter.getTime() << " s):" << endl;
+	for(i = 0; i < n; i++)
+	{
+		ShootingSolution s = shooter.getSolution(i);
+		cout << "  proper time " << s.parameter << ", initial 4-velocity (" << s.u[0] << ", " << s.u[1] << ", " << s.u[2] << ", "
+			<< s.u[3] << "), " << s.iterations << " iterations, distance " << s.distance << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include "../engine/entity.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/kerr.h"
+#include "../engine/snapshot.h"
+#include <iostream>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+/*! \class Simulation
+ * \brief A few particles on orbits around a Kerr black hole and a falling observer
+ */
+class Simulation
+{
+public:
+	KerrManifold kerr;
+	std::vector<DPIntegrator*> integrators;
+	std::vector<Particle*> particles;
+	Snapshot snapshot;
+
+	Simulation(double a, int n) : kerr(1.0, a)
+	{
+		int i;
+		for(i = 0; i < n; i++)
+		{
+			double r = 6.0 + 2.0*i;
+			double Omega = 1.0/(a + sqrt(r*r*r));
+			Point p(EF, 0.0, r, M_PI/2 - 0.1*i, 0.0);
+			Metric* g = kerr.getMetric(EF);
+			double ut = 1.0/sqrt(g->g(0, 0, p) + 2*g->g(0, 3, p)*Omega + g->g(3, 3, p)*Omega*Omega);
+
+			DPIntegrator* dp = new DPIntegrator(1e-10, 0.1, 1e-5, 10.0);
+			Particle* particle = new Particle(&kerr, p, vector4(ut, 0.0, 0.0, 1.1*Omega*ut));
+			particle->setIntegrator(dp);
+			integrators.push_back(dp);
+			particles.push_back(particle);
+		}
+
+		//the observer shares the integrator of the first particle
+		Point p(EF, 0.0, 15.0, M_PI/3, 0.0);
+		double ut = 1.0/sqrt(kerr.getMetric(EF)->g(0, 0, p));
+		Entity* observer = new Entity(&kerr, p, vector4(ut, 0.0, 0.0, 0.0),
+			vector4(0.0, -1.0, 0.0, 0.0), vector4(0.0, 0.0, 0.0, 1.0), vector4(0.0, 0.0, -1.0, 0.0));
+		observer->setIntegrator(integrators[0]);
+		particles.push_back(observer);
+
+		snapshot.addManifold(&kerr);
+		for(i = 0; i < (int)integrators.size(); i++)
+			snapshot.addIntegrator(integrators[i]);
+		for(i = 0; i < (int)particles.size(); i++)
+			snapshot.addParticle(particles[i]);
+	}
+
+	~Simulation()
+	{
+		snapshot.wait();
+		unsigned i;
+		for(i = 0; i < particles.size(); i++)
+			delete particles[i];
+		for(i = 0; i < integrators.size(); i++)
+			delete integrators[i];
+	}
+
+	void step()
+	{
+		unsigned i;
+		for(i = 0; i < particles.size(); i++)
+			particles[i]->propagate();
+	}
+
+	//the serialized states of all particles
+	std::vector<std::vector<char> > state()
+	{
+		std::vector<std::vector<char> > result;
+		unsigned i;
+		for(i = 0; i < particles.size(); i++)
+		{
+			StateWriter w;
+			particles[i]->saveState(w);
+			result.push_back(w.getData());
+		}
+		return result;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	int n = 4;
+	int steps = 2000;
+	int interval = 100;
+	double a = 0.9;
+	int i;
+
+	cout << "The program propagates particles around a Kerr black hole, saving snapshots to snapshot.grs," << endl;
+	cout << "then restores the snapshot from the middle of the run in a new simulation, continues it and compares" << endl;
+	cout << "the final states bit by bit with the uninterrupted run." << endl;
+	cout << "Usage: snapshot [n [steps [interval [a]]]]" << endl;
+	cout << "n - the number of particles (and an observer)" << endl;
+	cout << "steps - the number of steps" << endl;
+	cout << "interval - the number of steps between the snapshots" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "Defaults: n = 4, steps = 2000, interval = 100, a = 0.9" << endl << endl;
+
+	if(argc >= 2) n = atoi(argv[1]);
+	if(argc >= 3) steps = atoi(argv[2]);
+	if(argc >= 4) interval = atoi(argv[3]);
+	if(argc >= 5) a = atof(argv[4]);
+	if(n < 1) n = 1;
+	if(interval < 1) interval = 1;
+
+	//the snapshot from which the run is resumed
+	int frame = steps/2/interval;
+	int resume = frame*interval;
+
+	std::vector<std::vector<char> > reference;
+	{
+		Simulation sim(a, n);
+		for(i = 0; i <= steps; i++)
+		{
+			if(i % interval == 0)
+			{
+				if(!sim.snapshot.save("snapshot.grs"))
+				{
+					cout << "Could not write snapshot.grs" << endl;
+					return 1;
+				}
+				if(i == 0 || i == interval)
+					cout << "Frame " << sim.snapshot.getNFrames() - 1 << ": " << sim.snapshot.getLastFrameSize() << " bytes" << endl;
+			}
+			if(i < steps) sim.step();
+		}
+		if(!sim.snapshot.wait())
+		{
+			cout << "Could not write snapshot.grs" << endl;
+			return 1;
+		}
+		cout << "Saved " << sim.snapshot.getNFrames() << " frames" << endl;
+		reference = sim.state();
+	}
+
+	//a different black hole - its parameters are restored too
+	Simulation sim(0.0, n);
+	if(!sim.snapshot.restore("snapshot.grs", frame))
+	{
+		cout << "Could not restore snapshot.grs" << endl;
+		return 1;
+	}
+	cout << "Restored frame " << frame << " (step " << resume << "), a = " << sim.kerr.getAngMomentum() << endl;
+	for(i = resume; i < steps; i++)
+		sim.step();
+
+	std::vector<std::vector<char> > resumed = sim.state();
+	int differences = 0;
+	unsigned j;
+	for(j = 0; j < reference.size(); j++)
+		if(resumed[j] != reference[j]) differences++;
+	cout << "Particles differing from the uninterrupted run: " << differences << " of " << reference.size() << endl;
+	return differences ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+#include "../engine/particle.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/rosenbrockintegrator.h"
+#include "../engine/autointegrator.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//the Van der Pol oscillator - stiff for large mu, except for the quick jumps
+class VanDerPol : public DiffEq
+{
+public:
+	double mu;
+	long evals;
+
+	VanDerPol(double _mu) : mu(_mu), evals(0) {}
+
+	StateVector derivative(StateVector v)
+	{
+		if(v.size() != 3) throw StateLengthError();
+		evals++;
+		StateVector result(3);
+		result[0] = 1.0;
+		result[1] = v[2];
+		result[2] = mu*(1.0 - v[1]*v[1])*v[2] - v[1];
+		return result;
+	}
+};
+
+//particle counting the evaluations of the right-hand side and its Jacobian
+class CountingParticle : public Particle
+{
+public:
+	long evals;
+	long jacobians;
+
+	CountingParticle(Manifold* m, Point p, vector4 u)
+		: Particle(m, p, u), evals(0), jacobians(0) {}
+
+	StateVector derivative(StateVector v)
+	{
+		evals++;
+		return Particle::derivative(v);
+	}
+
+	void jacobian(StateVector v, std::vector<double>& J)
+	{
+		jacobians++;
+		Particle::jacobian(v, J);
+	}
+};
+
+static void vanDerPol(const char* name, Integrator* integrator, double mu, double T)
+{
+	VanDerPol eq(mu);
+	StateVector v(3);
+	v[0] = 0.0;
+	v[1] = 2.0;
+	v[2] = 0.0;
+	long steps = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(v[0] < T)
+	{
+		if(v[0] + integrator->getStepSize() > T)
+			v = integrator->next(v, &eq, T - v[0]);
+		else
+			v = integrator->next(v, &eq);
+		steps++;
+	}
+	double t = elapsed(start);
+	cout << "  " << name << ": x = " << v[1] << ", " << steps << " steps, " << eq.evals << " evaluations, " << t << " s" << endl;
+}
+
+//a particle falling from rest at r0 in the equatorial plane, propagated up to the proper time T (if T > 0) or to rEnd
+static CountingParticle* plunge(Integrator* integrator, KerrManifold* kerr, double r0, double rEnd, double T)
+{
+	Point p0(EF, 0.0, r0, M_PI/2, 0.0);
+	Metric* g = kerr->getMetric(EF);
+	vector4 u0(1.0, 0.0, 0.0, 0.0);
+	u0 /= sqrt(g->g(u0, u0, p0));
+	CountingParticle* particle = new CountingParticle(kerr, p0, u0);
+	particle->setIntegrator(integrator);
+	if(T <= 0.0)
+	{
+		while(particle->getPos()[1] > rEnd)
+			particle->propagate();
+		return particle;
+	}
+	double tau = 0.0;
+	while(tau < T)
+	{
+		if(tau + integrator->getStepSize() > T)
+			particle->propagate(T - tau);
+		else
+			particle->propagate();
+		tau = particle->getProperTime();
+	}
+	return particle;
+}
+
+static void plunge(const char* name, Integrator* integrator, KerrManifold* kerr, double r0, double T, Point reference)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CountingParticle* particle = plunge(integrator, kerr, r0, 0.0, T);
+	double t = elapsed(start);
+	Point p = kerr->convertPointTo(particle->getPos(), EF);
+	cout << "  " << name << ": " << particle->evals << " evaluations, " << particle->jacobians << " Jacobians, " << t << " s, error of r "
+		<< p[1] - reference[1] << ", of phi " << p[3] - reference[3] << endl;
+	delete particle;
+}
+
+int main(int argc, char** argv)
+{
+	double mu = 100.0;
+	double a = 0.9;
+	double r0 = 10.0;
+	double rEnd = 1.0;
+	double maxErr = 1e-6;
+
+	cout << "The program compares the Dormand-Prince, the Rosenbrock and the switching integrator on the Van der Pol oscillator" << endl;
+	cout << "and on a particle plunging into a Kerr black hole through the horizon." << endl;
+	cout << "Usage: stiff [mu [a [r0 [rEnd [maxErr]]]]]" << endl;
+	cout << "mu - the parameter of the Van der Pol oscillator" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "r0 - initial radius of the particle" << endl;
+	cout << "rEnd - final radius of the particle" << endl;
+	cout << "maxErr - the error margin of the integrators" << endl;
+	cout << "Defaults: mu = 100, a = 0.9, r0 = 10, rEnd = 1, maxErr = 1e-6" << endl << endl;
+
+	if(argc >= 2) mu = atof(argv[1]);
+	if(argc >= 3) a = atof(argv[2]);
+	if(argc >= 4) r0 = atof(argv[3]);
+	if(argc >= 5) rEnd = atof(argv[4]);
+	if(argc >= 6) maxErr = atof(argv[5]);
+
+	cout << "Van der Pol oscillator, mu = " << mu << ", t = 0.." << 2*mu << endl;
+	DPIntegrator dp1(maxErr, 0.01, 1e-9, 10.0);
+	RosenbrockIntegrator ros1(maxErr, 0.01, 1e-9, 10.0);
+	AutoIntegrator auto1(maxErr, 0.01, 1e-9, 10.0);
+	vanDerPol("Dormand-Prince", &dp1, mu, 2*mu);
+	vanDerPol("Rosenbrock    ", &ros1, mu, 2*mu);
+	vanDerPol("switching     ", &auto1, mu, 2*mu);
+	cout << "  the switching integrator changed the method " << auto1.getSwitches() << " times" << endl << endl;
+
+	KerrManifold kerr(1.0, a);
+	cout << "Plunge into a Kerr black hole, a = " << a << ", r = " << r0 << ".." << rEnd << " (horizon " << 1.0 + sqrt(1.0 - a*a) << ")" << endl;
+	//the proper time of reaching rEnd, and the reference position at that time
+	DPIntegrator dpRef(maxErr*1e-4, 0.01, 1e-9, 1.0);
+	CountingParticle* particle = plunge(&dpRef, &kerr, r0, rEnd, 0.0);
+	double T = particle->getProperTime();
+	delete particle;
+	particle = plunge(&dpRef, &kerr, r0, rEnd, T);
+	Point ref = kerr.convertPointTo(particle->getPos(), EF);
+	delete particle;
+	cout << "  proper time " << T << ", final r = " << ref[1] << endl;
+	DPIntegrator dp2(maxErr, 0.01, 1e-9, 1.0);
+	RosenbrockIntegrator ros2(maxErr, 0.01, 1e-9, 1.0);
+	AutoIntegrator auto2(maxErr, 0.01, 1e-9, 1.0);
+	plunge("Dormand-Prince", &dp2, &kerr, r0, T, ref);
+	plunge("Rosenbrock    ", &ros2, &kerr, r0, T, ref);
+	plunge("switching     ", &auto2, &kerr, r0, T, ref);
+	cout << "  the switching integrator changed the method " << auto2.getSwitches() << " times" << endl;
+	return 0;
+}
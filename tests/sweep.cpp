@@ -0,0 +1,158 @@
+#include "../engine/sweep.h"
+#include "../engine/particle.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/stopcondition.h"
+#include <iostream>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+/*! \class DeflectionTask
+ * \brief Deflection angle and time delay of photons passing a Kerr black hole in the equatorial plane
+ *
+ * The initial conditions are impact parameters (negative - retrograde photons). A photon starts at the radius R moving
+ * inwards and is propagated until it gets back to R, or falls into the black hole (the results are NaN then).
+ */
+class DeflectionTask : public SweepTask
+{
+	std::vector<double> impact;
+	double R;
+public:
+	enum { Deflection = 0, Delay, Steps, FirstStep, NResults };
+
+	DeflectionTask(const std::vector<double>& b, double _R) : impact(b), R(_R) {}
+
+	int getNResults() { return NResults; }
+	std::string getResultName(int i)
+	{
+		const char* names[NResults] = { "deflection", "delay", "steps", "first_step" };
+		return names[i];
+	}
+
+	void run(KerrManifold* m, int condition, const double* previous, double* results)
+	{
+		double b = impact[condition];
+		Point p(EF, 0.0, R, M_PI/2, 0.0);
+		Metric* g = m->getMetric(EF);
+
+		//the time component from g(u,u) = 0 (the future-directed root), the angular one corrected until the impact parameter
+		//-p_phi/p_u is b - the coordinate direction alone is off by about a, because the coordinates rotate with r
+		double ur = -sqrt(1.0 - b*b/(R*R));
+		double uphi = b/(R*R);
+		double u0 = 0.0;
+		int k;
+		for(k = 0; k < 20; k++)
+		{
+			double A = g->g(0, 0, p);
+			double B = g->g(0, 1, p)*ur + g->g(0, 3, p)*uphi;
+			double C = g->g(1, 1, p)*ur*ur + 2*g->g(1, 3, p)*ur*uphi + g->g(3, 3, p)*uphi*uphi;
+			u0 = (-B + sqrt(B*B - A*C))/A;
+			vector4 u(u0, ur, 0.0, uphi);
+			double E = g->g(u, vector4(1.0, 0.0, 0.0, 0.0), p);
+			double L = -g->g(u, vector4(0.0, 0.0, 0.0, 1.0), p);
+			if(fabs(L/E - b) < 1e-12*R) break;
+			uphi += (b - L/E)/(R*R);
+		}
+
+		DPIntegrator dp(1e-11, 1.0, 1e-6, 50.0);
+		//the neighbouring point of the grid needed a similar first step
+		if(previous && previous[FirstStep] > 0.0) dp.setStepSize(previous[FirstStep]);
+		HorizonCondition horizon(m->getHorizonRadius()*1.01);
+		EscapeCondition escape(R);
+
+		Particle photon(m, p, vector4(u0, ur, 0.0, uphi));
+		photon.setIntegrator(&dp);
+		photon.addStopCondition(&horizon);
+		photon.addStopCondition(&escape);
+
+		int steps = 0;
+		double firstStep = 0.0;
+		while(!photon.isStopped() && steps < 100000)
+		{
+			photon.propagate();
+			if(steps == 0) firstStep = dp.getLastStep();
+			steps++;
+		}
+		results[Steps] = steps;
+		results[FirstStep] = firstStep;
+		if(photon.getStopReason() != StopCondition::Escape)
+		{
+			results[Deflection] = results[Delay] = NAN;
+			return;
+		}
+
+		//the crossing of R, interpolated between the last two positions
+		vector4 last = photon.getLastPos().toVector4(), pos = photon.getPos().toVector4();
+		last += (pos - last)/(pos[1] - last[1])*(R - last[1]);
+		//v = t + r* and the shift of phi depend only on r, so their differences at equal radii are the differences of t and phi
+		double straight = M_PI - 2*asin(fabs(b)/R);
+		results[Deflection] = ((b > 0) ? last[3] : -last[3]) - straight;
+		results[Delay] = last[0] - 2*sqrt(R*R - b*b);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	int threads = 0;
+	int nSpins = 7;
+	double R = 1000.0;
+	int i;
+
+	cout << "The program computes the deflection angle and the time delay of photons passing Kerr black holes in the equatorial" << endl;
+	cout << "plane over a grid of masses and angular momenta, and writes them to sweep.txt." << endl;
+	cout << "Usage: sweep [threads [nSpins [R]]]" << endl;
+	cout << "threads - the number of threads (0 - all hardware threads)" << endl;
+	cout << "nSpins - the number of angular momenta from 0 to 0.9" << endl;
+	cout << "R - the initial and final radius of the photons" << endl;
+	cout << "Defaults: threads = 0, nSpins = 7, R = 1000" << endl << endl;
+
+	if(argc >= 2) threads = atoi(argv[1]);
+	if(argc >= 3) nSpins = atoi(argv[2]);
+	if(argc >= 4) R = atof(argv[3]);
+	if(nSpins < 1) nSpins = 1;
+
+	std::vector<double> masses, spins, impact;
+	masses.push_back(1.0);
+	masses.push_back(1.5);
+	masses.push_back(2.0);
+	for(i = 0; i < nSpins; i++)
+		spins.push_back((nSpins > 1) ? 0.9*i/(nSpins - 1) : 0.0);
+	double b[] = { 8.0, 15.0, 30.0, 60.0 };
+	for(i = 0; i < 4; i++)
+	{
+		impact.push_back(b[i]);
+		impact.push_back(-b[i]);
+	}
+
+	DeflectionTask task(impact, R);
+	ParameterSweep sweep(&task, impact.size());
+	sweep.setMasses(masses);
+	sweep.setAngMomenta(spins);
+	sweep.setThreads(threads);
+	sweep.run();
+
+	cout << sweep.getNPoints() << " points x " << impact.size() << " photons in " << sweep.getTime() << " s using "
+		<< sweep.getThreadsUsed() << " threads" << endl;
+	if(sweep.getFailedPoints())
+		cout << sweep.getFailedPoints() << " runs failed" << endl;
+	if(!sweep.writeTable("sweep.txt"))
+	{
+		cout << "Could not write sweep.txt" << endl;
+		return 1;
+	}
+
+	//the weak-field deflection 4M/b + 15 pi M^2/4b^2 -+ 4aM/b^2 for the widest photons
+	int last = impact.size() - 2;
+	double bw = impact[last];
+	cout << "Deflection at b = " << bw << " (weak field in parentheses)" << endl;
+	for(i = 0; i < sweep.getNPoints(); i++)
+	{
+		double M = sweep.getMass(i), a = sweep.getAngMomentum(i);
+		double weak = 4*M/bw + 15*M_PI*M*M/(4*bw*bw);
+		cout << "  M = " << M << ", a = " << a
+			<< ": prograde " << sweep.getResult(i, last, DeflectionTask::Deflection) << " (" << weak - 4*a*M/(bw*bw) << ")"
+			<< ", retrograde " << sweep.getResult(i, last + 1, DeflectionTask::Deflection) << " (" << weak + 4*a*M/(bw*bw) << ")" << endl;
+	}
+	return 0;
+}
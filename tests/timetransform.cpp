@@ -0,0 +1,105 @@
+#include "../engine/particle.h"
+#include "../engine/rk4integrator.h"
+#include "../engine/timetransform.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+struct Drift
+{
+	long steps;
+	double energy, angMomentum, norm;	///< The largest relative errors of the conserved quantities
+	double minStep, maxStep;			///< The shortest and the longest step in proper time
+};
+
+//propagates an orbit with RK4 until the proper time T and measures the conservation of E, L and u.u
+static Drift orbit(KerrManifold* kerr, Point p0, vector4 u0, TimeTransform* transform, double h, double T)
+{
+	Metric* g = kerr->getMetric(EF);
+	vector4 ev(1.0, 0.0, 0.0, 0.0), ephi(0.0, 0.0, 0.0, 1.0);
+	double E0 = g->g(u0, ev, p0), L0 = -g->g(u0, ephi, p0);
+	RK4Integrator rk4(h);
+	Particle particle(kerr, p0, u0);
+	particle.setIntegrator(&rk4);
+	particle.setTimeTransform(transform);
+	Drift d;
+	d.steps = 0;
+	d.energy = d.angMomentum = d.norm = 0.0;
+	d.minStep = 1e300;
+	d.maxStep = 0.0;
+	while(particle.getProperTime() < T)
+	{
+		double tau = particle.getProperTime();
+		particle.propagate();
+		d.steps++;
+		double dt = particle.getProperTime() - tau;
+		if(dt < d.minStep) d.minStep = dt;
+		if(dt > d.maxStep) d.maxStep = dt;
+
+		Point p = kerr->convertPointTo(particle.getPos(), EF);
+		vector4 u = kerr->convertVectorTo(particle.getVel(), particle.getPos(), EF);
+		double e = fabs(g->g(u, ev, p)/E0 - 1.0);
+		double l = fabs(-g->g(u, ephi, p)/L0 - 1.0);
+		double n = fabs(g->g(u, u, p) - 1.0);
+		if(e > d.energy) d.energy = e;
+		if(l > d.angMomentum) d.angMomentum = l;
+		if(n > d.norm) d.norm = n;
+	}
+	return d;
+}
+
+static void print(const char* name, Drift d)
+{
+	cout << "  " << name << ": " << d.steps << " steps, proper time steps " << d.minStep << ".." << d.maxStep << ", errors of E " << d.energy
+		<< ", L " << d.angMomentum << ", u.u " << d.norm << endl;
+}
+
+int main(int argc, char** argv)
+{
+	double a = 0.5;
+	double ra = 40.0;
+	double omega = 0.6;
+	double T = 20000.0;
+	double h = 0.002;
+
+	cout << "The program propagates an eccentric equatorial orbit around a Kerr black hole with RK4 in the proper time, in the Mino" << endl;
+	cout << "time and in an r-scaled time, with the same number of steps, and compares the conservation of energy, angular momentum" << endl;
+	cout << "and the norm of the 4-velocity." << endl;
+	cout << "Usage: timetransform [a [ra [omega [T [h]]]]]" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "ra - apoapsis radius" << endl;
+	cout << "omega - angular velocity at the apoapsis, relative to the circular orbit" << endl;
+	cout << "T - proper time of the propagation" << endl;
+	cout << "h - the step in the Mino time" << endl;
+	cout << "Defaults: a = 0.5, ra = 40, omega = 0.6, T = 20000, h = 0.002" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) ra = atof(argv[2]);
+	if(argc >= 4) omega = atof(argv[3]);
+	if(argc >= 5) T = atof(argv[4]);
+	if(argc >= 6) h = atof(argv[5]);
+
+	//at the apoapsis u^r = 0, and u^v, u^phi are the same as in Boyer-Lindquist coordinates
+	KerrManifold kerr(1.0, a);
+	Metric* g = kerr.getMetric(EF);
+	Point p0(EF, 0.0, ra, M_PI/2, 0.0);
+	vector4 u0(1.0, 0.0, 0.0, omega/(pow(ra, 1.5) + a));
+	u0 /= sqrt(g->g(u0, u0, p0));
+
+	MinoTime mino(a);
+	Drift dm = orbit(&kerr, p0, u0, &mino, h, T);
+
+	//the other parametrizations with the same number of steps - the step in lambda found from a trial run
+	RadialTime sundman(1.5, ra);
+	Drift trial = orbit(&kerr, p0, u0, &sundman, 1.0, T);
+	Drift ds = orbit(&kerr, p0, u0, &sundman, (double)trial.steps/dm.steps, T);
+	Drift dt = orbit(&kerr, p0, u0, NULL, T/dm.steps, T);
+
+	cout << "Orbit from r = " << ra << ", proper time " << T << endl;
+	print("proper time        ", dt);
+	print("Mino time          ", dm);
+	print("r^1.5-scaled time  ", ds);
+	return 0;
+}
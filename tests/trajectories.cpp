@@ -0,0 +1,192 @@
+#include "../engine/particle.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/schw.h"
+#include "../engine/trajectory.h"
+#include "../engine/trajcompress.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+//propagates the particles i = first, first + stride, ... of the ensemble
+void propagateEnsemble(Manifold* m, TrajectorySink* sink, int n, double orbits, int first, int stride)
+{
+	DPIntegrator dp(1e-10, 0.1, 1e-5, 10.0);
+	int i;
+	for(i = first; i < n; i += stride)
+	{
+		double r = 8.0 + 12.0*i/n;
+		double incl = 80*M_PI/180*i/n;
+		double Omega = sqrt(1.0/(r*r*r));
+		double ut = 1.0/sqrt(1.0 - 3.0/r);
+
+		Particle p(m, Point(EF, 0.0, r, M_PI/2, 0.0), vector4(ut, 0.0, -Omega*ut*sin(incl), Omega*ut*cos(incl)));
+		p.setIntegrator(&dp);
+		dp.resetStepSize();
+		p.setTrajectorySink(sink, i);
+
+		//the period in proper time
+		double T = orbits*2*M_PI/(Omega*ut);
+		while(p.getProperTime() < T)
+			p.propagate();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int n = 100;
+	double orbits = 2.0;
+	int threads = 0;
+	double tolerance = 1e-6;
+	int i;
+
+	cout << "The program propagates an ensemble of particles on inclined circular orbits around a Schwarzschild black hole," << endl;
+	cout << "writes their trajectories to trajectories.dat and analyses the file through the memory-mapped reader." << endl;
+	cout << "Usage: trajectories [n [orbits [threads [tolerance]]]]" << endl;
+	cout << "n - the number of particles (radii from 8M to 20M, inclinations from 0 to 80 degrees)" << endl;
+	cout << "orbits - the number of orbits of every particle" << endl;
+	cout << "threads - the number of propagating threads writing through the asynchronous writer (0 - synchronous writing)" << endl;
+	cout << "tolerance - the error of the positions reconstructed from the compressed file trajectories.grtc (0 - no compression)" << endl;
+	cout << "Defaults: n = 100, orbits = 2, threads = 0, tolerance = 1e-6" << endl << endl;
+
+	if(argc >= 2) n = atoi(argv[1]);
+	if(argc >= 3) orbits = atof(argv[2]);
+	if(argc >= 4) threads = atoi(argv[3]);
+	if(argc >= 5) tolerance = atof(argv[4]);
+	if(n < 1) n = 1;
+
+	SchwManifold schw(1.0);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	TrajectoryWriter writer("trajectories.dat", 1.0, 0.0, schw.getNCoordSystems());
+	if(threads <= 0)
+	{
+		propagateEnsemble(&schw, &writer, n, orbits, 0, 1);
+		if(!writer.close())
+		{
+			cout << "Could not write trajectories.dat" << endl;
+			return 1;
+		}
+	}
+	else
+	{
+		//every thread needs its own manifold - the metrics cache their values
+		AsyncTrajectoryWriter async(&writer);
+		std::vector<Manifold*> copies;
+		std::vector<std::thread> workers;
+		for(i = 0; i < threads; i++)
+		{
+			copies.push_back(schw.clone());
+			workers.push_back(std::thread(propagateEnsemble, copies[i], &async, n, orbits, i, threads));
+		}
+		for(i = 0; i < threads; i++)
+		{
+			workers[i].join();
+			delete copies[i];
+		}
+		if(!async.close())
+		{
+			cout << "Could not write trajectories.dat" << endl;
+			return 1;
+		}
+		AsyncWriterStats stats = async.getStats();
+		cout << "Writer: " << stats.records << " records in " << stats.batches << " batches, " << stats.bytesPerSecond/1e6 << " MB/s, "
+			<< "queue occupancy mean " << stats.meanOccupancy << " max " << stats.maxOccupancy << ", " << stats.fullWaits << " waits for space" << endl;
+	}
+	double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cout << "Propagated and written " << writer.getNRecords() << " records in " << time << " s" << endl;
+
+	TrajectoryReader reader;
+	if(!reader.open("trajectories.dat"))
+	{
+		cout << "Could not read trajectories.dat" << endl;
+		return 1;
+	}
+	cout << "File: M = " << reader.getMass() << ", a = " << reader.getAngMomentum() << ", " << reader.getNCharts() << " charts, "
+		<< reader.getNRecords() << " records in " << reader.getNRuns() << " runs" << endl;
+
+	//the records are read in place - the drift of the normalization and of the radius of every orbit
+	start = std::chrono::steady_clock::now();
+	std::vector<uint64_t> ids = reader.getTrajectories();
+	double worstNorm = 0.0, worstRadius = 0.0;
+	uint64_t worstId = 0;
+	unsigned j;
+	for(j = 0; j < ids.size(); j++)
+	{
+		std::vector<TrajectoryRun> runs = reader.findRuns(ids[j]);
+		const TrajectoryRecord* first = &reader.getRecord(runs[0].first);
+		double r0 = schw.convertPointTo(TrajectoryReader::getPos(*first), EF)[1];
+
+		unsigned k;
+		uint64_t l;
+		for(k = 0; k < runs.size(); k++)
+			for(l = runs[k].first; l < runs[k].first + runs[k].count; l++)
+			{
+				const TrajectoryRecord& rec = reader.getRecord(l);
+				Point pos = TrajectoryReader::getPos(rec);
+				vector4 vel = TrajectoryReader::getVel(rec);
+				double norm = fabs(schw.getMetric(rec.chart)->g(vel, vel, pos) - 1.0);
+				double dr = fabs(schw.convertPointTo(pos, EF)[1]/r0 - 1.0);
+				if(norm > worstNorm) worstNorm = norm;
+				if(dr > worstRadius)
+				{
+					worstRadius = dr;
+					worstId = ids[j];
+				}
+			}
+	}
+	time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cout << "Analysed " << ids.size() << " trajectories in " << time << " s" << endl;
+	cout << "Largest |g(u,u) - 1|: " << worstNorm << endl;
+	cout << "Largest relative drift of the radius: " << worstRadius << " (trajectory " << worstId << ")" << endl;
+	if(tolerance <= 0.0) return 0;
+
+	//the archive - only the samples needed to reconstruct the positions within the tolerance
+	start = std::chrono::steady_clock::now();
+	TrajectoryCompressor compressor("trajectories.grtc", reader.getMass(), reader.getAngMomentum(), reader.getNCharts(), tolerance);
+	uint64_t l;
+	for(l = 0; l < reader.getNRecords(); l++)
+		compressor.write(reader.getRecord(l));
+	if(!compressor.close())
+	{
+		cout << "Could not write trajectories.grtc" << endl;
+		return 1;
+	}
+	time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t rawBytes = reader.getNRecords()*sizeof(TrajectoryRecord);
+	cout << "Compressed in " << time << " s: " << compressor.getNSamples() << " of " << compressor.getNRecords() << " samples kept, "
+		<< compressor.getNBytes() << " bytes (" << (double)rawBytes/compressor.getNBytes() << "x smaller than the records)" << endl;
+
+	CompressedTrajectoryReader archive;
+	if(!archive.open("trajectories.grtc"))
+	{
+		cout << "Could not read trajectories.grtc" << endl;
+		return 1;
+	}
+	double worstError = 0.0;
+	for(j = 0; j < ids.size(); j++)
+	{
+		std::vector<TrajectoryRecord> samples;
+		if(!archive.decode(ids[j], samples))
+		{
+			cout << "Could not decode trajectory " << ids[j] << endl;
+			return 1;
+		}
+		std::vector<TrajectoryRun> runs = reader.findRuns(ids[j]);
+		unsigned k;
+		int c;
+		for(k = 0; k < runs.size(); k++)
+			for(l = runs[k].first; l < runs[k].first + runs[k].count; l++)
+			{
+				const TrajectoryRecord& rec = reader.getRecord(l);
+				TrajectoryRecord r = CompressedTrajectoryReader::interpolate(samples, rec.tau);
+				for(c = 0; c < 4; c++)
+					if(fabs(r.x[c] - rec.x[c]) > worstError) worstError = fabs(r.x[c] - rec.x[c]);
+			}
+	}
+	cout << "Largest error of the reconstructed coordinates: " << worstError << " (tolerance " << tolerance << ")" << endl;
+	return 0;
+}
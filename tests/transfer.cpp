@@ -0,0 +1,93 @@
+#include "../engine/transfer.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <fstream>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+int main(int argc, char** argv)
+{
+	double a = 0.9;
+	int n = 64;
+	int threads = 0;
+	int i, j;
+
+	cout << "The program computes the transfer functions of a thin disk around a Kerr black hole and the line profiles." << endl;
+	cout << "Usage: transfer [a [n [threads [inclination ...]]]]" << endl;
+	cout << "a - the angular momentum parameter of the black hole (M = 1)" << endl;
+	cout << "n - the size of the image-plane grid" << endl;
+	cout << "inclination - inclinations of the observer in degrees" << endl;
+	cout << "Defaults: a = 0.9, n = 64, threads = number of cores, inclinations 30, 60, 85" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) n = atoi(argv[2]);
+	if(argc >= 4) threads = atoi(argv[3]);
+
+	KerrManifold kerr(1.0, a);
+	double rIn = kerr.getISCORadius();
+
+	TransferFunction tf(&kerr, rIn, 20.0, n, 22.0);
+	tf.setThreads(threads);
+	if(argc >= 5)
+		for(i = 4; i < argc; i++)
+			tf.addInclination(atof(argv[i]));
+	else
+	{
+		tf.addInclination(30.0);
+		tf.addInclination(60.0);
+		tf.addInclination(85.0);
+	}
+
+	cout << "Disk: r = " << rIn << " .. 20" << endl;
+	cout << "Computing..." << endl;
+	tf.compute();
+	cout << "Time: " << tf.getTotalTime() << " s, " << tf.getTotalSteps() << " steps" << endl;
+
+	if(!tf.save("transfer.dat"))
+	{
+		cout << "Could not write transfer.dat" << endl;
+		return 1;
+	}
+	cout << "Tables written to transfer.dat" << endl;
+
+	//the profiles are computed from the file, as they would be by a fitting program
+	TransferFunction table(NULL, 0.0, 0.0);
+	if(!table.load("transfer.dat"))
+	{
+		cout << "Could not read transfer.dat" << endl;
+		return 1;
+	}
+
+	const int nBins = 60;
+	const double gMin = 0.3, gMax = 1.5;
+	PowerLawEmissivity emissivity(3.0);
+	vector<vector<double> > profiles(table.getNInclinations(), vector<double>(nBins));
+	for(i = 0; i < table.getNInclinations(); i++)
+		table.lineProfile(i, emissivity, gMin, gMax, nBins, &profiles[i][0]);
+
+	ofstream out("line.txt");
+	out << "# E/E0";
+	for(i = 0; i < table.getNInclinations(); i++)
+		out << " i=" << table.getInclination(i);
+	out << endl;
+	for(j = 0; j < nBins; j++)
+	{
+		out << gMin + (j + 0.5)*(gMax - gMin)/nBins;
+		for(i = 0; i < table.getNInclinations(); i++)
+			out << " " << profiles[i][j]/((gMax - gMin)/nBins);
+		out << endl;
+	}
+	cout << "Line profiles (emissivity r^-3) written to line.txt" << endl;
+
+	//position of the blue peak of every profile
+	for(i = 0; i < table.getNInclinations(); i++)
+	{
+		int peak = 0;
+		for(j = 1; j < nBins; j++)
+			if(profiles[i][j] > profiles[i][peak]) peak = j;
+		cout << "i = " << table.getInclination(i) << ": peak at E/E0 = " << gMin + (peak + 0.5)*(gMax - gMin)/nBins << endl;
+	}
+
+	return 0;
+}
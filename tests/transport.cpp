@@ -0,0 +1,87 @@
+#include "../engine/transport.h"
+#include "../engine/rk4integrator.h"
+#include "../engine/schw.h"
+#include <iostream>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	double r = 10.0;
+	double orbits = 3.0;
+	double h = 0.5;
+	int nExtra = 32;
+	int i, n;
+
+	cout << "The program transports a gyroscope spin along a circular orbit around a Schwarzschild black hole, and compares" << endl;
+	cout << "its radial component with the geodetic precession. Then it measures the cost of transporting more vectors." << endl;
+	cout << "Usage: transport [r [orbits [h [vectors]]]]" << endl;
+	cout << "r - radius of the orbit" << endl;
+	cout << "orbits - number of orbits" << endl;
+	cout << "h - the step of the RK4 integrator" << endl;
+	cout << "vectors - number of the additional transported vectors" << endl;
+	cout << "Defaults: r = 10, orbits = 3, h = 0.5, vectors = 32" << endl << endl;
+
+	if(argc >= 2) r = atof(argv[1]);
+	if(argc >= 3) orbits = atof(argv[2]);
+	if(argc >= 4) h = atof(argv[3]);
+	if(argc >= 5) nExtra = atoi(argv[4]);
+
+	SchwManifold schw(1.0);
+	Metric* g = schw.getMetric(EF);
+	double f = 1.0 - 2.0/r;
+	double Omega = sqrt(1.0/(r*r*r));
+	double ut = 1.0/sqrt(1.0 - 3.0/r);
+	Point p0(EF, 0.0, r, M_PI/2, 0.0);
+	vector4 u0(ut, 0.0, 0.0, Omega*ut);
+	//unit radial vector of the static frame - dv/dr = 1/f at constant t
+	vector4 s0(1.0/sqrt(f), sqrt(f), 0.0, 0.0);
+	int steps = (int)(orbits*2*M_PI/(Omega*ut)/h);
+
+	RK4Integrator rk4(h);
+	TransportParticle gyro(&schw, p0, u0);
+	gyro.setIntegrator(&rk4);
+	gyro.addVector(s0);
+	double maxDiff = 0.0;
+	for(i = 0; i < steps; i++)
+	{
+		gyro.propagate();
+		//s^r = sqrt(f) cos(Omega sqrt(1 - 3M/r) t)
+		double t = gyro.getProperTime()*ut;
+		double diff = fabs(gyro.getVector(0)[1]/sqrt(f) - cos(Omega*sqrt(1.0 - 3.0/r)*t));
+		if(diff > maxDiff) maxDiff = diff;
+	}
+	vector4 s = gyro.getVector(0), u = gyro.getVel();
+	Point p = gyro.getPos();
+	cout << "Geodetic precession " << 2*M_PI*(1.0 - sqrt(1.0 - 3.0/r)) << " rad per orbit" << endl;
+	cout << "Largest difference of the radial component from the prediction over " << orbits << " orbits: " << maxDiff << endl;
+	cout << "s.s + 1 = " << g->g(s, s, p) + 1.0 << ", s.u = " << g->g(s, u, p) << endl << endl;
+
+	//the cost of the additional vectors - rotated copies of the spin
+	int counts[3] = { 0, 1, nExtra };
+	double base = 0.0;
+	for(n = 0; n < 3; n++)
+	{
+		TransportParticle particle(&schw, p0, u0);
+		particle.setIntegrator(&rk4);
+		for(i = 0; i < counts[n]; i++)
+		{
+			double a = 2*M_PI*i/(counts[n] + 1);
+			particle.addVector(cos(a)*s0 + sin(a)*vector4(0.0, 0.0, 1.0/r, 0.0));
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(i = 0; i < steps; i++)
+			particle.propagate();
+		double t = elapsed(start)/steps;
+		if(n == 0) base = t;
+		cout << counts[n] << " vectors: " << t*1e6 << " us per step (" << t/base << "x the geodesic alone)" << endl;
+	}
+	return 0;
+}
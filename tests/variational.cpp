@@ -0,0 +1,130 @@
+#include "../engine/variational.h"
+#include "../engine/rk4integrator.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+using namespace std;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//propagates a particle with fixed steps and returns its final state (coordinates first) in the given coordinate system (-1 - the current one)
+static void finalState(Particle& particle, double T, double h, int chart, double* y)
+{
+	RK4Integrator rk4(h);
+	particle.setIntegrator(&rk4);
+	while(particle.getProperTime() < T - h/2)
+		particle.propagate();
+	Manifold* m = particle.getManifold();
+	Point p = particle.getPos();
+	if(chart < 0) chart = p.getCoordSystem();
+	vector4 u = m->convertVectorTo(particle.getVel(), p, chart);
+	p = m->convertPointTo(p, chart);
+	int i;
+	for(i = 0; i < 4; i++)
+	{
+		y[i] = p[i];
+		y[i + 4] = u[i];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double a = 0.5;
+	double r = 20.0;
+	double orbits = 1.0;
+	double h = 0.5;
+	double delta = 1e-6;
+	int i, j;
+
+	cout << "The program propagates an eccentric polar orbit around a Kerr black hole together with its variational equations," << endl;
+	cout << "and compares the state transition matrix and the sensitivities to M and a with central differences of whole runs." << endl;
+	cout << "Usage: variational [a [r [orbits [h]]]]" << endl;
+	cout << "a - angular momentum per unit mass of the black hole" << endl;
+	cout << "r - the initial (largest) radius of the orbit" << endl;
+	cout << "orbits - the approximate number of orbits" << endl;
+	cout << "h - the step of the RK4 integrator" << endl;
+	cout << "Defaults: a = 0.5, r = 20, orbits = 1, h = 0.5" << endl << endl;
+
+	if(argc >= 2) a = atof(argv[1]);
+	if(argc >= 3) r = atof(argv[2]);
+	if(argc >= 4) orbits = atof(argv[3]);
+	if(argc >= 5) h = atof(argv[4]);
+
+	KerrManifold kerr(1.0, a);
+	Point p0(EF, 0.0, r, M_PI/2, 0.0);
+	double Omega = 0.9/sqrt(r*r*r);
+	vector4 dir(1.0, 0.0, -Omega, 0.0);
+	vector4 u0 = dir/sqrt(kerr.getMetric(EF)->g(dir, dir, p0));
+	double T = orbits*2*M_PI/Omega;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	VariationalParticle particle(&kerr, p0, u0);
+	double y[8];
+	finalState(particle, T, h, -1, y);
+	double tVar = elapsed(start);
+	int chart = particle.getPos().getCoordSystem();
+
+	//the same by central differences - 2 runs per initial component and per parameter
+	start = std::chrono::steady_clock::now();
+	double fd[8][10];
+	for(j = 0; j < 10; j++)
+	{
+		double y1[8], y2[8], d;
+		if(j < 8)
+		{
+			Point p1 = p0, p2 = p0;
+			vector4 u1 = u0, u2 = u0;
+			if(j < 4)
+			{
+				d = delta*(1.0 + fabs(p0[j]));
+				p1[j] += d;
+				p2[j] -= d;
+			}
+			else
+			{
+				d = delta*(1.0 + fabs(u0[j - 4]));
+				u1[j - 4] += d;
+				u2[j - 4] -= d;
+			}
+			Particle q1(&kerr, p1, u1), q2(&kerr, p2, u2);
+			finalState(q1, T, h, chart, y1);
+			finalState(q2, T, h, chart, y2);
+		}
+		else
+		{
+			double value = kerr.getParameter(j - 8);
+			d = delta*(1.0 + fabs(value));
+			KerrManifold m1(1.0, a), m2(1.0, a);
+			m1.setParameter(j - 8, value + d);
+			m2.setParameter(j - 8, value - d);
+			Particle q1(&m1, p0, u0), q2(&m2, p0, u0);
+			finalState(q1, T, h, chart, y1);
+			finalState(q2, T, h, chart, y2);
+		}
+		for(i = 0; i < 8; i++)
+			fd[i][j] = (y1[i] - y2[i])/(2*d);
+	}
+	double tFd = elapsed(start);
+
+	const char* names[10] = { "x0", "x1", "x2", "x3", "u0", "u1", "u2", "u3", "M", "a" };
+	cout << "Final radius " << y[1] << ", time " << T << endl;
+	cout << "Derivatives of the final state - largest element and largest difference from central differences:" << endl;
+	for(j = 0; j < 10; j++)
+	{
+		double largest = 0.0, diff = 0.0;
+		for(i = 0; i < 8; i++)
+		{
+			double value = (j < 8) ? particle.getTransition(i, j) : particle.getSensitivity(i, j - 8);
+			if(fabs(value) > largest) largest = fabs(value);
+			if(fabs(value - fd[i][j]) > diff) diff = fabs(value - fd[i][j]);
+		}
+		cout << "  d/d" << names[j] << ": " << largest << ", " << diff << " (" << diff/largest << " relative)" << endl;
+	}
+	cout << "Variational equations " << tVar << " s, central differences " << tFd << " s (" << tFd/tVar << "x)" << endl;
+	return 0;
+}
@@ -0,0 +1,282 @@
+#include "../engine/particle.h"
+#include "../engine/rk4integrator.h"
+#include "../engine/dpintegrator.h"
+#include "../engine/schw.h"
+#include "../engine/kerr.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+//particle counting the evaluations of the right-hand side
+class CountingParticle : public Particle
+{
+public:
+	long evals;
+	long steps;
+
+	CountingParticle(Manifold* m, Point p, vector4 u)
+		: Particle(m, p, u), evals(0), steps(0) {}
+
+	StateVector derivative(StateVector v)
+	{
+		evals++;
+		return Particle::derivative(v);
+	}
+
+	void propagate(double dt = 0.0)
+	{
+		steps++;
+		Particle::propagate(dt);
+	}
+
+	//propagates until the coordinate u reaches uEnd - the last step is shortened to end there (exactly if u^0 is constant)
+	void propagateTo(double uEnd)
+	{
+		while(true)
+		{
+			double rest = (uEnd - getPos()[0])/getVel()[0];
+			if(rest <= integrator->getStepSize())
+			{
+				if(rest > 0.0) propagate(rest);
+				return;
+			}
+			propagate();
+		}
+	}
+};
+
+/*
+ * Reference problems - every one returns the error of the numerical solution
+ */
+
+class Problem
+{
+public:
+	string name;
+	double M;
+	double scale;	//typical step size of the affine parameter - the RK4 steps are multiples of it
+
+	Problem(string _name, double _M, double _scale)
+		: name(_name), M(_M), scale(_scale) {}
+	virtual ~Problem() {}
+
+	virtual double solve(Manifold* m, Integrator* integrator, long& evals, long& steps) = 0;
+};
+
+//relative error of the Shapiro delay (the setup of tests/shapiro.cpp) against the first-order analytic formula
+//the second-order terms limit the accuracy of the reference to the order of 1e-6
+class ShapiroProblem : public Problem
+{
+	double d, yE, yV;
+
+	double t(double u, double r)
+	{
+		return u - r - 2*M*log(0.5*(r-2*M)/M);
+	}
+
+	//coordinate time of flight from the perihelion to r, to the first order in M
+	double flightTime(double r)
+	{
+		double y = sqrt(r*r - d*d);
+		return y + 2*M*log((r + y)/d) + M*sqrt((r - d)/(r + d));
+	}
+
+	double flight(CountingParticle& photon, double rMax)
+	{
+		vector4 lastPos, pos;
+		while(photon.getPos()[1] < rMax)
+		{
+			lastPos = photon.getPos().toVector4();
+			photon.propagate();
+		}
+		pos = photon.getPos().toVector4();
+		lastPos += (pos - lastPos)/(pos[1] - lastPos[1])*(rMax - lastPos[1]);
+		return t(lastPos[0], lastPos[1]);
+	}
+public:
+	ShapiroProblem()
+		: Problem("shapiro", 4.9e-6, 0.1), d(2.33), yE(498.67), yV(370.7) {}
+
+	double solve(Manifold* m, Integrator* integrator, long& evals, long& steps)
+	{
+		double u0 = sqrt(d*d*d/(d-2*M));
+		double u = 2*M*log(0.5*(d-2*M)/M) + d;
+		double rE = sqrt(d*d + yE*yE);
+		double rV = sqrt(d*d + yV*yV);
+
+		CountingParticle photon1(m, Point(EF, u, d, M_PI/2, 0.0), vector4(u0, 0.0, 0.0, 1.0));
+		CountingParticle photon2(m, Point(EF, u, d, M_PI/2, 0.0), vector4(-u0, 0.0, 0.0, -1.0));	//backwards in time
+		photon1.setIntegrator(integrator);
+		photon2.setIntegrator(integrator);
+
+		integrator->resetStepSize();
+		double t1 = flight(photon1, rE);
+		integrator->resetStepSize();
+		double t2 = flight(photon2, rV);
+
+		evals = photon1.evals + photon2.evals;
+		steps = photon1.steps + photon2.steps;
+
+		double dilation = sqrt(1.0 - 2*M/rE);
+		double delay = 2*(t1 - t2)*dilation - 2*(yE + yV);
+		double exact = 2*(flightTime(rE) + flightTime(rV))*dilation - 2*(yE + yV);
+		return fabs(delay/exact - 1.0);
+	}
+};
+
+//circular orbit inclined by 80 degrees to the equator (so that it passes through the near-pole charts)
+class OrbitProblem : public Problem
+{
+protected:
+	double r;
+	double orbits;
+	bool null;
+
+	//propagates the orbit for the given number of periods and returns the final position
+	Point propagate(Manifold* m, Integrator* integrator, long& evals, long& steps)
+	{
+		double Omega = sqrt(M/(r*r*r));
+		double ut = null ? 1.0 : 1.0/sqrt(1.0 - 3*M/r);
+		double incl = 80*M_PI/180;
+		CountingParticle p(m, Point(EF, 0.0, r, M_PI/2, 0.0), vector4(ut, 0.0, -Omega*ut*sin(incl), Omega*ut*cos(incl)));
+		p.setIntegrator(integrator);
+		integrator->resetStepSize();
+
+		p.propagateTo(orbits*2*M_PI/Omega);
+		evals = p.evals;
+		steps = p.steps;
+		return m->convertPointTo(p.getPos(), EF);
+	}
+public:
+	OrbitProblem(string name, double _r, double _orbits, bool _null)
+		: Problem(name, 1.0, 1.0), r(_r), orbits(_orbits), null(_null) {}
+
+	//relative error of the orbital period - the angle between the final and the initial position over the total angle
+	double solve(Manifold* m, Integrator* integrator, long& evals, long& steps)
+	{
+		Point end = propagate(m, integrator, evals, steps);
+		double x = sin(end[2])*cos(end[3]);
+		double y = sin(end[2])*sin(end[3]);
+		double z = cos(end[2]);
+		return atan2(sqrt(y*y + z*z), x)/(orbits*2*M_PI);
+	}
+};
+
+//drift of the radius of a circular orbit - marginally stable at the ISCO, unstable at the photon sphere
+class DriftProblem : public OrbitProblem
+{
+public:
+	DriftProblem(string name, double _r, double _orbits, bool _null)
+		: OrbitProblem(name, _r, _orbits, _null) {}
+
+	double solve(Manifold* m, Integrator* integrator, long& evals, long& steps)
+	{
+		Point end = propagate(m, integrator, evals, steps);
+		return fabs(end[1] - r)/M;
+	}
+};
+
+/*
+ * Sweep
+ */
+
+void run(ofstream& out, Problem* problem, const char* backend, Manifold* m, const char* name, Integrator* integrator, double tol, double maxStep)
+{
+	long evals = 0, steps = 0;
+	double error;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	try
+	{
+		error = problem->solve(m, integrator, evals, steps);
+	}
+	catch(...)
+	{
+		error = HUGE_VAL;
+	}
+	double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	out << problem->name << "," << backend << "," << name << "," << tol << "," << maxStep << ","
+		<< error << "," << evals << "," << steps << "," << time << endl;
+	cout << problem->name << " " << backend << " " << name << " " << tol << " " << maxStep << ": error " << error
+		<< ", " << evals << " evaluations, " << time << " s" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	const char* filename = "workprecision.csv";
+	bool quick = false;
+	int i, j, k;
+
+	cout << "The program measures the error of reference problems against the cost of the integration." << endl;
+	cout << "Usage: workprecision [--quick] [file]" << endl;
+	cout << "--quick - fewer tolerances" << endl;
+	cout << "file - output CSV file (default workprecision.csv)" << endl;
+	cout << "Problems: shapiro (relative error of the delay), period (relative error of the period of an inclined circular orbit at 10M)," << endl;
+	cout << "isco (drift of the radius of the circular orbit at 6M), photon (drift of the circular photon orbit at 3M)" << endl << endl;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--quick")) quick = true;
+		else filename = argv[i];
+	}
+
+	ofstream out(filename);
+	if(!out)
+	{
+		cout << "Could not open " << filename << endl;
+		return 1;
+	}
+	out.precision(10);
+	out << "problem,backend,integrator,tolerance,max_step,error,rhs_evals,steps,time_s" << endl;
+
+	vector<Problem*> problems;
+	problems.push_back(new ShapiroProblem());
+	problems.push_back(new OrbitProblem("period", 10.0, 3.0, false));
+	problems.push_back(new DriftProblem("isco", 6.0, 3.0, false));
+	problems.push_back(new DriftProblem("photon", 3.0, 1.0, true));
+
+	//RK4 steps in units of the problem scale, DP error margins
+	double rk4Steps[] = { 1.0, 0.3, 0.1, 0.03, 0.01 };
+	double dpErrors[] = { 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9, 1e-10, 1e-11, 1e-12 };
+	int nRK4 = quick ? 3 : 5;
+	int nDP = quick ? 5 : 9;
+	int step = quick ? 2 : 1;
+
+	for(i = 0; i < (int)problems.size(); i++)
+		for(j = 0; j < 2; j++)
+		{
+			//the Schwarzschild spacetime through both metric implementations
+			SchwManifold schw(problems[i]->M);
+			KerrManifold kerr(problems[i]->M, 0.0);
+			Manifold* m = j ? (Manifold*)&kerr : (Manifold*)&schw;
+			const char* backend = j ? "kerr" : "schw";
+
+			for(k = 0; k < nRK4; k++)
+			{
+				double h = rk4Steps[k]*problems[i]->scale;
+				RK4Integrator rk4(h);
+				run(out, problems[i], backend, m, "rk4", &rk4, h, h);
+			}
+			for(k = 0; k < nDP*step; k += step)
+			{
+				//the default maximal step and one large enough not to matter
+				DPIntegrator dp1(dpErrors[k], 0.01, 1e-10);
+				run(out, problems[i], backend, m, "dp", &dp1, dpErrors[k], dp1.getMaxStep());
+				DPIntegrator dp2(dpErrors[k], 0.01, 1e-10, 100*problems[i]->scale);
+				run(out, problems[i], backend, m, "dp", &dp2, dpErrors[k], dp2.getMaxStep());
+			}
+		}
+
+	for(i = 0; i < (int)problems.size(); i++)
+		delete problems[i];
+
+	cout << "Results written to " << filename << endl;
+	return 0;
+}